@@ -0,0 +1,56 @@
+#pragma once
+
+#include "acquisition_result.hpp"
+#include "../common.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+namespace ugsdr {
+	constexpr inline double speed_of_light = 299792458.0;
+
+	// Satellite expected to be visible, with its predicted line-of-sight velocity. The Doppler is derived for the carrier
+	// of the acquired signal, so a single prediction serves every band of the satellite
+	struct AcquisitionAid {
+		Sv sv;
+		double range_rate = 0.0;	// m/s, positive for the receding satellite
+		double elevation = 0.0;		// rad
+	};
+
+	inline double GetAcquisitionCarrierFrequency(Sv sv) {
+		switch (sv.signal) {
+		case Signal::GpsCoarseAcquisition_L1:
+		case Signal::Galileo_E1b:
+		case Signal::QzssCoarseAcquisition_L1:
+			return 1575.42e6;
+		case Signal::GlonassCivilFdma_L1:
+			return 1602e6 + static_cast<std::int32_t>(sv) * 0.5625e6;
+		case Signal::BeiDou_B1I:
+			return 1561.098e6;
+		case Signal::Gps_L5I:
+		case Signal::Gps_L5Q:
+		case Signal::NavIC_L5:
+		case Signal::Sbas_L5Q:
+			return 1176.45e6;
+		default:
+			throw std::runtime_error("Unexpected acquisition signal");
+		}
+	}
+
+	inline double GetAidedDoppler(const AcquisitionAid& aid, double carrier_frequency) {
+		return -aid.range_rate * carrier_frequency / speed_of_light;
+	}
+
+	// Aids from the previous session of the same site. The acquired Dopplers already include the oscillator offset
+	template <typename T>
+	auto MakeAcquisitionAids(const std::vector<AcquisitionResult<T>>& acquisition_results) {
+		std::vector<AcquisitionAid> dst;
+		dst.reserve(acquisition_results.size());
+		for (auto& el : acquisition_results) {
+			auto& aid = dst.emplace_back();
+			aid.sv = el.sv_number;
+			aid.range_rate = -(el.doppler - el.intermediate_frequency) * speed_of_light / GetAcquisitionCarrierFrequency(el.sv_number);
+		}
+		return dst;
+	}
+}
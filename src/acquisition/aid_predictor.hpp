@@ -0,0 +1,149 @@
+#pragma once
+
+#include "acquisition_aid.hpp"
+#include "../helpers/rtklib_helpers.hpp"
+
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace ugsdr {
+	// Visible satellites and their range rates for the prior receiver position and time. The closest broadcast ephemeris of every
+	// satellite is propagated even if it has expired, like an almanac: the orbit of the previous day is good to tens of Hz
+	class AcquisitionAidPredictor final {
+	private:
+		// range rate is the central difference of the ranges over this interval, s
+		constexpr static inline double range_rate_interval = 1.0;
+
+		std::unique_ptr<nav_t, void(*)(nav_t*)> owned_nav{ nullptr, FreeNav };
+		const nav_t* nav = nullptr;
+
+		static void FreeNav(nav_t* ptr) {
+			if (!ptr)
+				return;
+			freenav(ptr, 0xFF);
+			delete ptr;
+		}
+
+		static std::optional<Sv> ConvertSat(int sat, int glonass_frequency = 0) {
+			auto prn = 0;
+			switch (satsys(sat, &prn)) {
+			case SYS_GPS:
+				return Sv(prn - 1, System::Gps, Signal::GpsCoarseAcquisition_L1);
+			case SYS_GLO:
+				return Sv(glonass_frequency, System::Glonass, Signal::GlonassCivilFdma_L1);
+			case SYS_GAL:
+				return Sv(prn - 1, System::Galileo, Signal::Galileo_E1b);
+			case SYS_CMP:
+				return Sv(prn - 1, System::BeiDou, Signal::BeiDou_B1I);
+			case SYS_IRN:
+				return Sv(prn - 1, System::NavIC, Signal::NavIC_L5);
+			case SYS_QZS:
+				return Sv(prn - MINPRNQZS, System::Qzss, Signal::QzssCoarseAcquisition_L1);
+			default:
+				return std::nullopt;
+			}
+		}
+
+		// healthy ephemeris with the closest reference time for every satellite
+		template <typename EphemerisType>
+		static auto SelectEphemerides(gtime_t time, const EphemerisType* ephemerides, int count) {
+			std::map<int, const EphemerisType*> dst;
+			for (int i = 0; i < count; ++i) {
+				const auto& ephemeris = ephemerides[i];
+				if (ephemeris.svh != 0)
+					continue;
+
+				auto& selected = dst[ephemeris.sat];
+				if (!selected || std::abs(timediff(time, ephemeris.toe)) < std::abs(timediff(time, selected->toe)))
+					selected = &ephemeris;
+			}
+			return dst;
+		}
+
+		template <typename PositionFn>
+		static std::optional<AcquisitionAid> PredictAid(Sv sv, gtime_t time, const std::array<double, 3>& receiver_position,
+			double elevation_mask, PositionFn&& get_position) {
+			std::array<double, 3> los{};
+			std::array<double, 2> azel{};
+			std::array<double, 3> geodetic_position{};
+			ecef2pos(receiver_position.data(), geodetic_position.data());
+
+			std::array<double, 3> satellite_position{};
+			get_position(time, satellite_position.data());
+			if (geodist(satellite_position.data(), receiver_position.data(), los.data()) <= 0.0)
+				return std::nullopt;
+			if (satazel(geodetic_position.data(), los.data(), azel.data()) < elevation_mask)
+				return std::nullopt;
+
+			std::array<double, 2> ranges{};
+			for (std::size_t i = 0; i < ranges.size(); ++i) {
+				get_position(timeadd(time, (static_cast<double>(i) - 0.5) * range_rate_interval), satellite_position.data());
+				ranges[i] = geodist(satellite_position.data(), receiver_position.data(), los.data());
+			}
+
+			auto dst = AcquisitionAid{};
+			dst.sv = sv;
+			dst.range_rate = (ranges[1] - ranges[0]) / range_rate_interval;
+			dst.elevation = azel[1];
+			return dst;
+		}
+
+	public:
+		constexpr static inline double default_elevation_mask = 5.0 * std::numbers::pi / 180.0;
+
+		// e.g. MeasurementEngine::nav of the previous session, it has to outlive the predictor
+		explicit AcquisitionAidPredictor(const nav_t* navigation_data) : nav(navigation_data) {
+			if (!nav)
+				throw std::runtime_error("Unexpected nullptr");
+		}
+
+		// e.g. the navigation stored by MeasurementEngine::WriteNavigation in the previous session
+		explicit AcquisitionAidPredictor(const std::filesystem::path& rinex_nav_path) : owned_nav(new nav_t{}, FreeNav) {
+			if (readrnx(rinex_nav_path.string().c_str(), 0, "", nullptr, owned_nav.get(), nullptr) <= 0)
+				throw std::runtime_error("Unable to read RINEX navigation file");
+			nav = owned_nav.get();
+		}
+
+		// receiver_position is ECEF, m
+		std::vector<AcquisitionAid> Predict(gtime_t time, const std::array<double, 3>& receiver_position, double elevation_mask = default_elevation_mask) const {
+			std::vector<AcquisitionAid> dst;
+
+			for (auto [sat, ephemeris] : SelectEphemerides(time, nav->eph, nav->n)) {
+				auto sv = ConvertSat(sat);
+				if (!sv.has_value())
+					continue;
+
+				auto aid = PredictAid(*sv, time, receiver_position, elevation_mask, [ephemeris](gtime_t t, double* position) {
+					auto clock_bias = 0.0;
+					auto variance = 0.0;
+					eph2pos(t, ephemeris, position, &clock_bias, &variance);
+				});
+				if (aid.has_value())
+					dst.push_back(*aid);
+			}
+
+			for (auto [sat, ephemeris] : SelectEphemerides(time, nav->geph, nav->ng)) {
+				auto sv = ConvertSat(sat, ephemeris->frq);
+				if (!sv.has_value())
+					continue;
+
+				auto aid = PredictAid(*sv, time, receiver_position, elevation_mask, [ephemeris](gtime_t t, double* position) {
+					auto clock_bias = 0.0;
+					auto variance = 0.0;
+					geph2pos(t, ephemeris, position, &clock_bias, &variance);
+				});
+				if (aid.has_value())
+					dst.push_back(*aid);
+			}
+
+			return dst;
+		}
+	};
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../prn_codes/codegen_wrapper.hpp"
+
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <execution>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ugsdr {
+	template <typename UpsamplerT, typename MatchedFilterT, typename UnderlyingType>
+	class CodeSpectrumBank final {
+	private:
+		using CodeType = std::remove_cvref_t<decltype(UpsamplerT::Transform(std::declval<const std::vector<UnderlyingType>&>(), std::size_t{}))>;
+
+	public:
+		using SpectrumType = std::remove_cvref_t<decltype(MatchedFilterT::PrepareCodeSpectrum(std::declval<const CodeType&>()))>;
+
+		struct Key {
+			Signal signal = Signal::GpsCoarseAcquisition_L1;
+			std::int32_t id = 0;
+			double sampling_rate = 0.0;
+			std::size_t ms_to_process = 0;
+			std::size_t sign_permutation = 0;
+
+			bool operator<(const Key& rhs) const {
+				return std::tie(signal, id, sampling_rate, ms_to_process, sign_permutation) <
+					std::tie(rhs.signal, rhs.id, rhs.sampling_rate, rhs.ms_to_process, rhs.sign_permutation);
+			}
+		};
+
+		// Galileo E1B spans 4 ms, so every millisecond of the code may carry its own sign
+		constexpr static inline std::array galileo_sign_permutations{
+			std::array<int, 4>{	1,	1,	1,	1	},
+			std::array<int, 4>{	1,	1,	1,	-1	},
+			std::array<int, 4>{	1,	1,	-1,	-1	},
+			std::array<int, 4>{	1,	-1,	-1,	-1	}
+		};
+
+		constexpr static std::size_t GetSignPermutationsCount(Signal signal) {
+			return signal == Signal::Galileo_E1b ? galileo_sign_permutations.size() : 1;
+		}
+
+	private:
+		std::map<Key, SpectrumType> spectra;
+		mutable std::shared_mutex m;
+
+		template <Signal signal>
+		static auto GenerateCode(std::int32_t id, double sampling_rate, std::size_t ms_to_process, std::size_t sign_permutation) {
+			const auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
+			const auto code_period_ms = static_cast<std::size_t>(PrnGenerator<signal>::GetNumberOfMilliseconds());
+			const auto repeats = std::max<std::size_t>(1, ms_to_process / code_period_ms);
+
+			auto code = UpsamplerT::Transform(RepeatCodeNTimes(PrnGenerator<signal>::template Get<UnderlyingType>(id), repeats),
+				ms_to_process * samples_per_ms);
+
+			if constexpr (signal == Signal::Galileo_E1b) {
+				const auto& permutation = galileo_sign_permutations[sign_permutation];
+				for (std::size_t i = 0; i < permutation.size() && i < ms_to_process; ++i) {
+					std::transform(code.begin() + i * samples_per_ms, code.begin() + (i + 1) * samples_per_ms, code.begin() + i * samples_per_ms,
+						[cur_mul = permutation[i]](auto& val) {return val * cur_mul; });
+				}
+			}
+
+			return code;
+		}
+
+		const SpectrumType* Find(const Key& key) const {
+			auto lock = std::shared_lock(m);
+			auto it = spectra.find(key);
+			return it == spectra.end() ? nullptr : &it->second;
+		}
+
+	public:
+		template <Signal signal>
+		const auto& Get(std::int32_t id, double sampling_rate, std::size_t ms_to_process, std::size_t sign_permutation = 0) {
+			auto key = Key{ signal, id, sampling_rate, ms_to_process, sign_permutation };
+			if (auto spectrum = Find(key))
+				return *spectrum;
+
+			auto spectrum = MatchedFilterT::PrepareCodeSpectrum(GenerateCode<signal>(id, sampling_rate, ms_to_process, sign_permutation));
+			auto lock = std::unique_lock(m);
+			return spectra.try_emplace(key, std::move(spectrum)).first->second;
+		}
+
+		template <Signal signal, typename ExecutionPolicy = decltype(std::execution::par_unseq)>
+		void Build(const std::vector<std::int32_t>& ids, double sampling_rate, std::size_t ms_to_process, ExecutionPolicy&& policy = std::execution::par_unseq) {
+			std::vector<std::pair<std::int32_t, std::size_t>> codes;
+			for (auto id : ids)
+				for (std::size_t i = 0; i < GetSignPermutationsCount(signal); ++i)
+					codes.emplace_back(id, i);
+
+			std::for_each(policy, codes.begin(), codes.end(), [&](auto& code) {
+				static_cast<void>(Get<signal>(code.first, sampling_rate, ms_to_process, code.second));
+			});
+		}
+
+		auto size() const {
+			auto lock = std::shared_lock(m);
+			return spectra.size();
+		}
+
+		void Clear() {
+			auto lock = std::unique_lock(m);
+			spectra.clear();
+		}
+	};
+}
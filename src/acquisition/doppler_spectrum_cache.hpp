@@ -0,0 +1,232 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../helpers/af_array_proxy.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <execution>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ugsdr {
+	template <typename MixerT, typename ResamplerT, typename MatchedFilterT, typename UnderlyingType>
+	class DopplerSpectrumCache final {
+	private:
+		using InputType = std::vector<std::complex<UnderlyingType>>;
+		using TranslatedType = std::remove_cvref_t<decltype(MixerT::Translate(std::declval<const InputType&>(), 0.0, 0.0))>;
+
+	public:
+		using SignalType = std::remove_cvref_t<decltype(ResamplerT::Transform(std::declval<const TranslatedType&>(), std::size_t{}, std::size_t{}))>;
+		using SpectrumType = std::remove_cvref_t<decltype(MatchedFilterT::PrepareSignalSpectrum(std::declval<const SignalType&>()))>;
+
+		struct Key {
+			const void* subband = nullptr;
+			double intermediate_frequency = 0.0;
+			double sampling_rate = 0.0;
+			double doppler_range = 0.0;
+			double doppler_step = 0.0;
+			std::size_t segment = 0;
+			std::size_t segments = 1;
+
+			bool operator<(const Key& rhs) const {
+				return std::tie(subband, intermediate_frequency, sampling_rate, doppler_range, doppler_step, segment, segments) <
+					std::tie(rhs.subband, rhs.intermediate_frequency, rhs.sampling_rate, rhs.doppler_range, rhs.doppler_step, rhs.segment, rhs.segments);
+			}
+		};
+
+		// Downsampled signal with the spectra for every distinct sub-bin residual of the Doppler grid,
+		// whole DFT bins are applied as circular shifts of these spectra by the matched filter
+		struct Entry {
+			SignalType signal;
+			double sampling_rate = 0.0;
+			double doppler_step = 0.0;
+			std::vector<double> residuals;
+			std::vector<std::vector<std::ptrdiff_t>> bin_shifts;
+			std::vector<std::vector<double>> doppler_frequencies;
+			// spectra for the first spectra.size() residuals, the rest didn't fit into the memory budget
+			std::vector<SpectrumType> spectra;
+
+			auto GetSpectrum(std::size_t residual_index) const {
+				const auto translated_signal = MixerT::Translate(signal, sampling_rate, -residuals[residual_index]);
+				return MatchedFilterT::PrepareSignalSpectrum(translated_signal);
+			}
+
+			template <typename Fn>
+			void ForEachSpectrum(Fn&& fn) const {
+				for (std::size_t i = 0; i < residuals.size(); ++i) {
+					if (i < spectra.size())
+						fn(spectra[i], bin_shifts[i], doppler_frequencies[i]);
+					else
+						fn(GetSpectrum(i), bin_shifts[i], doppler_frequencies[i]);
+				}
+			}
+
+			// same as above, restricted to the Doppler hypotheses within [min_frequency, max_frequency]
+			template <typename Fn>
+			void ForEachSpectrum(Fn&& fn, double min_frequency, double max_frequency) const {
+				std::vector<std::ptrdiff_t> selected_shifts;
+				std::vector<double> selected_frequencies;
+				for (std::size_t i = 0; i < residuals.size(); ++i) {
+					selected_shifts.clear();
+					selected_frequencies.clear();
+					for (std::size_t j = 0; j < doppler_frequencies[i].size(); ++j) {
+						if (doppler_frequencies[i][j] < min_frequency || doppler_frequencies[i][j] > max_frequency)
+							continue;
+						selected_shifts.push_back(bin_shifts[i][j]);
+						selected_frequencies.push_back(doppler_frequencies[i][j]);
+					}
+					if (selected_shifts.empty())
+						continue;
+
+					if (i < spectra.size())
+						fn(spectra[i], selected_shifts, selected_frequencies);
+					else
+						fn(GetSpectrum(i), selected_shifts, selected_frequencies);
+				}
+			}
+
+			auto GetSpectrumBytes() const {
+				return static_cast<std::size_t>(signal.size()) * sizeof(std::complex<UnderlyingType>);
+			}
+
+			// the downsampled signal is kept for the spectra beyond the budget, it's the size of a spectrum
+			auto GetBytes() const {
+				return (spectra.size() + 1) * GetSpectrumBytes();
+			}
+		};
+
+	private:
+		std::size_t memory_budget = 0;
+		std::size_t memory_used = 0;
+		struct Slot {
+			std::once_flag built;
+			Entry entry;
+		};
+		std::map<Key, std::unique_ptr<Slot>> entries;
+		std::mutex m;
+
+	public:
+		constexpr static inline std::size_t default_memory_budget = std::size_t{ 256 } << 20;
+
+		DopplerSpectrumCache(std::size_t budget = default_memory_budget) : memory_budget(budget) {}
+
+		static SignalType Slice(const SignalType& signal, std::size_t segment, std::size_t segments) {
+			const auto length = static_cast<std::size_t>(signal.size()) / segments;
+#ifdef HAS_ARRAYFIRE
+			if constexpr (std::is_same_v<SignalType, ArrayProxy>) {
+				const af::array& array = signal;
+				return ArrayProxy(array(af::seq(static_cast<double>(segment * length), static_cast<double>((segment + 1) * length - 1))));
+			}
+			else
+#endif
+				return SignalType(signal.begin() + segment * length, signal.begin() + (segment + 1) * length);
+		}
+
+		// Doppler grid of the signal without the spectra
+		static auto MakeGrid(SignalType signal, double sampling_rate, double doppler_range, double doppler_step) {
+			Entry dst;
+			dst.signal = std::move(signal);
+			dst.sampling_rate = sampling_rate;
+			dst.doppler_step = doppler_step;
+
+			const auto bin_width = sampling_rate / static_cast<double>(dst.signal.size());
+			const auto tolerance = bin_width * 1e-9;
+			const auto doppler_bins = static_cast<std::size_t>(std::floor(2 * doppler_range / doppler_step + 1e-9)) + 1;
+
+			for (std::size_t i = 0; i < doppler_bins; ++i) {
+				const auto doppler_frequency = -doppler_range + static_cast<double>(i) * doppler_step;
+				auto bin_shift = static_cast<std::ptrdiff_t>(std::floor(doppler_frequency / bin_width));
+				auto residual = doppler_frequency - static_cast<double>(bin_shift) * bin_width;
+				if (bin_width - residual < tolerance) {
+					residual = 0.0;
+					++bin_shift;
+				}
+
+				auto it = std::find_if(dst.residuals.begin(), dst.residuals.end(), [residual, tolerance](auto val) {
+					return std::abs(val - residual) < tolerance;
+				});
+				auto index = static_cast<std::size_t>(std::distance(dst.residuals.begin(), it));
+				if (it == dst.residuals.end()) {
+					dst.residuals.push_back(residual);
+					dst.bin_shifts.emplace_back();
+					dst.doppler_frequencies.emplace_back();
+				}
+				dst.bin_shifts[index].push_back(bin_shift);
+				dst.doppler_frequencies[index].push_back(doppler_frequency);
+			}
+
+			return dst;
+		}
+
+		static std::size_t GetSpectraToCache(const Entry& entry, std::size_t budget) {
+			const auto signal_bytes = entry.GetSpectrumBytes();
+			const auto spectra_budget = budget > signal_bytes ? budget - signal_bytes : 0;
+			return std::min(entry.residuals.size(), spectra_budget / std::max(signal_bytes, std::size_t{ 1 }));
+		}
+
+		static void PrepareSpectra(Entry& entry, std::size_t spectra_to_cache) {
+			entry.spectra.resize(spectra_to_cache);
+			std::vector<std::size_t> indices(spectra_to_cache);
+			std::iota(indices.begin(), indices.end(), 0);
+			std::for_each(std::execution::par_unseq, indices.begin(), indices.end(), [&entry](auto i) {
+				entry.spectra[i] = entry.GetSpectrum(i);
+			});
+		}
+
+		static auto MakeEntry(SignalType signal, double sampling_rate, double doppler_range, double doppler_step, std::size_t budget) {
+			auto dst = MakeGrid(std::move(signal), sampling_rate, doppler_range, doppler_step);
+			PrepareSpectra(dst, GetSpectraToCache(dst, budget));
+			return dst;
+		}
+
+		// The entries of different keys are built concurrently, only the budget is taken under the lock.
+		// The callers of the same key wait for the first one
+		template <typename Fn>
+		const Entry& Get(const Key& key, Fn&& get_signal) {
+			Slot* slot = nullptr;
+			{
+				auto lock = std::unique_lock(m);
+				auto& dst = entries[key];
+				if (!dst)
+					dst = std::make_unique<Slot>();
+				slot = dst.get();
+			}
+
+			std::call_once(slot->built, [&]() {
+				auto entry = MakeGrid(get_signal(), key.sampling_rate, key.doppler_range, key.doppler_step);
+				auto spectra_to_cache = std::size_t{ 0 };
+				{
+					auto lock = std::unique_lock(m);
+					spectra_to_cache = GetSpectraToCache(entry, memory_budget > memory_used ? memory_budget - memory_used : 0);
+					memory_used += (spectra_to_cache + 1) * entry.GetSpectrumBytes();
+				}
+				PrepareSpectra(entry, spectra_to_cache);
+				slot->entry = std::move(entry);
+			});
+			return slot->entry;
+		}
+
+		void Clear() {
+			auto lock = std::unique_lock(m);
+			entries.clear();
+			memory_used = 0;
+		}
+
+		void SetMemoryBudget(std::size_t budget) {
+			auto lock = std::unique_lock(m);
+			memory_budget = budget;
+		}
+
+		auto GetMemoryBudget() const {
+			return memory_budget;
+		}
+	};
+}
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "acquisition_aid.hpp"
+#include "aid_predictor.hpp"
 #include "acquisition_result.hpp"
+#include "code_spectrum_bank.hpp"
+#include "doppler_spectrum_cache.hpp"
 #include "../common.hpp"
 #include "../signal_parameters.hpp"
 #include "../dfe/dfe.hpp"
@@ -22,17 +26,40 @@
 #include "../resample/af_upsampler.hpp"
 #include "../resample/af_resampler.hpp"
 #include "../resample/ipp_resampler.hpp"
+#include "../resample/polyphase_resampler.hpp"
 #include "../mixer/af_mixer.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <concepts>
 #include <cstring>
+#include <execution>
 #include <functional>
-#include <mutex>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
 #include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace ugsdr {
+	enum class AcquisitionMode {
+		SinglePass,
+		TwoStage
+	};
+
+	// Combining of the coherent blocks in the long integration
+	enum class IntegrationMode {
+		NonCoherent,	// sum of the correlation magnitudes
+		Differential	// magnitude of the sum of the products of the consecutive blocks, their noise is uncorrelated and averages out
+	};
+
 	template <
 		auto target_sampling_rate,
 		typename MixerT,
@@ -42,10 +69,12 @@ namespace ugsdr {
 		typename ReshapeAndSumT,
 		typename MaxIndexT,
 		typename MeanStdDevT,
-		typename ResamplerT
+		typename ResamplerT,
+		AcquisitionMode SearchMode = AcquisitionMode::SinglePass
 	>
 	struct FseConfig {
 		constexpr static double acquisition_sampling_rate = target_sampling_rate;
+		constexpr static inline auto acquisition_mode = SearchMode;
 
 		using MixerType = MixerT;
 		using UpsamplerType = UpsamplerT;
@@ -67,7 +96,7 @@ namespace ugsdr {
 	};
 
 #ifdef HAS_IPP
-	template <auto acquisition_sampling_rate>
+	template <auto acquisition_sampling_rate, AcquisitionMode mode = AcquisitionMode::SinglePass>
 	using ParametricIppFseConfig = FseConfig <
 		acquisition_sampling_rate,
 		IppMixer,
@@ -77,11 +106,12 @@ namespace ugsdr {
 		IppReshapeAndSum,
 		IppMaxIndex,
 		IppMeanStdDev,
-		IppResampler>;
+		IppResampler,
+		mode>;
 #endif
 
 #ifdef HAS_ARRAYFIRE
-	template <auto acquisition_sampling_rate>
+	template <auto acquisition_sampling_rate, AcquisitionMode mode = AcquisitionMode::SinglePass>
 	using ParametricAfFseConfig = FseConfig<
 		acquisition_sampling_rate,
 		AfMixer,
@@ -91,11 +121,12 @@ namespace ugsdr {
 		AfReshapeAndSum,
 		AfMaxIndex,
 		AfMeanStdDev,
-		AfResampler
+		AfResampler,
+		mode
 	>;
 #endif
 
-	template <auto acquisition_sampling_rate>
+	template <auto acquisition_sampling_rate, AcquisitionMode mode = AcquisitionMode::SinglePass>
 	using ParametricCpuFseConfig = FseConfig <
 		acquisition_sampling_rate,
 		TableMixer,
@@ -105,17 +136,18 @@ namespace ugsdr {
 		SequentialReshapeAndSum,
 		SequentialMaxIndex,
 		SequentialMeanStdDev,
-		SequentialResampler
+		PolyphaseResampler,
+		mode
 	> ;
 
-	template <auto acquisition_sampling_rate>
+	template <auto acquisition_sampling_rate, AcquisitionMode mode = AcquisitionMode::SinglePass>
 	using ParametricFseConfig =
 #ifdef HAS_IPP
 		ParametricIppFseConfig<
 #else
 		ParametricCpuFseConfig<
 #endif
-		acquisition_sampling_rate>;
+		acquisition_sampling_rate, mode>;
 
 	using DefaultFseConfig = ParametricFseConfig<8192000>;
 	
@@ -123,8 +155,9 @@ namespace ugsdr {
 	constexpr bool IsFseConfig(T val) {
 		return false;
 	}
-	template <auto rate, typename ... Args>
-	constexpr bool IsFseConfig(FseConfig<rate, Args...> val) {
+	template <auto rate, typename MixerT, typename UpsamplerT, typename MatchedFilterT, typename AbsT, typename ReshapeAndSumT,
+		typename MaxIndexT, typename MeanStdDevT, typename ResamplerT, AcquisitionMode mode>
+	constexpr bool IsFseConfig(FseConfig<rate, MixerT, UpsamplerT, MatchedFilterT, AbsT, ReshapeAndSumT, MaxIndexT, MeanStdDevT, ResamplerT, mode> val) {
 		return true;
 	}
 	template <typename T>
@@ -136,6 +169,11 @@ namespace ugsdr {
 	class FastSearchEngineBase final {
 	private:
 		constexpr static std::size_t ms_to_process = 4;
+		constexpr static std::size_t doppler_batch_size = 8;
+		// two-stage mode: coarse grid of coarse_ms-long coherent segments, accumulated non-coherently over ms_to_process
+		constexpr static std::size_t coarse_ms = 1;
+		constexpr static inline double coarse_doppler_step = 500.0;
+		constexpr static inline double sbas_doppler_step = 10.0;
 
 		DigitalFrontend<ChConfig, UnderlyingType>& digital_frontend;
 		double doppler_range = 5e3;
@@ -148,11 +186,48 @@ namespace ugsdr {
 		std::vector<Sv> sbas_sv;
 		std::vector<Sv> qzss_sv;
 		constexpr static inline double peak_threshold = 3.3;
+		// non-coherent 1 ms segments peak lower than the coherent search, the threshold only rejects the obvious noise
+		constexpr static inline double coarse_peak_threshold = 2.5;
 		constexpr static inline double acquisition_sampling_rate = Config::acquisition_sampling_rate;
 		constexpr static inline double acquisition_sampling_rate_L5 = 20.46e6;
 
-		std::mutex m;
-		
+		// long integration: integration_blocks consecutive blocks of coherent_ms, see ProcessLongIntegration
+		std::size_t coherent_ms = ms_to_process;
+		std::size_t integration_blocks = 1;
+		IntegrationMode integration_mode = IntegrationMode::NonCoherent;
+		std::size_t integration_memory_budget = std::size_t{ 512 } << 20;
+		// the statistics are the deflections (peak - mean) / sigma, independent of the number of blocks. The products of the
+		// differential mode have the heavier noise tails
+		constexpr static inline double non_coherent_threshold = 7.0;
+		constexpr static inline double differential_threshold = 10.0;
+
+		using DopplerCacheType = DopplerSpectrumCache<typename Config::MixerType, typename Config::ResamplerType,
+			typename Config::MatchedFilterType, UnderlyingType>;
+		DopplerCacheType doppler_cache;
+		using CodeBankType = CodeSpectrumBank<typename Config::UpsamplerType, typename Config::MatchedFilterType, UnderlyingType>;
+		CodeBankType code_bank;
+
+		// Search of one satellite. Everything the task needs is captured by value, or refers to the data that outlives the pool:
+		// the epoch, the cached Doppler spectra and the code bank
+		using AcquisitionTask = std::function<std::optional<AcquisitionResult<UnderlyingType>>()>;
+
+		// Doppler spectra of a subband or a GLONASS litera, filled by a preparation task before the searches that read them
+		struct PreparedSpectra {
+			const typename DopplerCacheType::Entry* doppler_spectra = nullptr;
+			std::vector<const typename DopplerCacheType::Entry*> coarse_spectra;
+		};
+
+		// The pool runs all the preparations first, then all the searches
+		struct AcquisitionTasks {
+			std::vector<std::function<void()>> preparations;
+			std::vector<AcquisitionTask> searches;
+
+			void clear() {
+				preparations.clear();
+				searches.clear();
+			}
+		};
+
 		void InitSatellites() {
 			gps_sv.resize(ugsdr::gps_sv_count);
 			for(std::size_t i = 0; i < gps_sv.size(); ++i) {
@@ -239,44 +314,222 @@ namespace ugsdr {
 			return signal_sampling_rate;
 		}
 
-		template <bool reshape = true, bool coherent = true, Container T1 = std::vector<UnderlyingType>, Container T2 = std::vector<UnderlyingType>>
-		void ProcessBpsk(const T1& signal, const T2& code, Sv sv, double signal_sampling_rate, 
-			double new_sampling_rate, double intermediate_frequency, 
-			std::vector<AcquisitionResult<UnderlyingType>>& dst) {
-			AcquisitionResult<UnderlyingType> tmp, max_result;
-			auto ratio = signal_sampling_rate / new_sampling_rate;
-			auto code_spectrum = Config::MatchedFilterType::PrepareCodeSpectrum(code);
-			
-			for (double doppler_frequency = -doppler_range;
-						doppler_frequency <= doppler_range;
-						doppler_frequency += doppler_step) {
-				const auto translated_signal = Config::MixerType::Translate(signal, new_sampling_rate, -doppler_frequency);
+		const auto& GetDopplerSpectra(const std::vector<std::complex<UnderlyingType>>& signal, double signal_sampling_rate,
+			double new_sampling_rate, double intermediate_frequency, double step) {
+			auto key = typename DopplerCacheType::Key{ signal.data(), intermediate_frequency, new_sampling_rate, doppler_range, step };
+
+			return doppler_cache.Get(key, [&]() {
+				const auto translated_signal = Config::MixerType::Translate(signal, signal_sampling_rate, -intermediate_frequency);
+				return Config::ResamplerType::Transform(translated_signal, static_cast<std::size_t>(new_sampling_rate),
+					static_cast<std::size_t>(signal_sampling_rate));
+			});
+		}
+
+		const auto& GetDopplerSpectra(const std::vector<std::complex<UnderlyingType>>& signal, double signal_sampling_rate,
+			double new_sampling_rate, double intermediate_frequency) {
+			return GetDopplerSpectra(signal, signal_sampling_rate, new_sampling_rate, intermediate_frequency, doppler_step);
+		}
+
+		auto GetCoarseDopplerSpectra(const typename DopplerCacheType::Entry& doppler_spectra, const std::vector<std::complex<UnderlyingType>>& signal,
+			double new_sampling_rate, double intermediate_frequency) {
+			std::vector<const typename DopplerCacheType::Entry*> dst;
+			if constexpr (Config::acquisition_mode == AcquisitionMode::TwoStage) {
+				const auto segments = ms_to_process / coarse_ms;
+				for (std::size_t segment = 0; segment < segments; ++segment) {
+					auto key = typename DopplerCacheType::Key{ signal.data(), intermediate_frequency, new_sampling_rate, doppler_range, coarse_doppler_step, segment, segments };
+					dst.push_back(&doppler_cache.Get(key, [&]() {
+						return DopplerCacheType::Slice(doppler_spectra.signal, segment, segments);
+					}));
+				}
+			}
+			return dst;
+		}
 
-				auto matched_output = Config::MatchedFilterType::FilterOptimized(translated_signal, code_spectrum);
-				auto peak_one_ms = GetOneMsPeak<reshape, coherent>(matched_output, new_sampling_rate);
+		std::shared_ptr<const PreparedSpectra> PrepareDopplerSpectra(const std::vector<std::complex<UnderlyingType>>& signal, double signal_sampling_rate,
+			double new_sampling_rate, double intermediate_frequency, double step, bool coarse, AcquisitionTasks& tasks) {
+			auto dst = std::make_shared<PreparedSpectra>();
+			tasks.preparations.push_back([=, this, &signal] {
+				dst->doppler_spectra = &GetDopplerSpectra(signal, signal_sampling_rate, new_sampling_rate, intermediate_frequency, step);
+				if (coarse)
+					dst->coarse_spectra = GetCoarseDopplerSpectra(*dst->doppler_spectra, signal, new_sampling_rate, intermediate_frequency);
+			});
+			return dst;
+		}
+
+		static auto ParabolicOffset(double left, double center, double right) {
+			auto denominator = left - 2 * center + right;
+			if (denominator >= 0.0)
+				return 0.0;
 
-				auto max_index = Config::MaxIndexType::Transform(peak_one_ms);
-				auto mean_sigma = Config::MeanStdDevType::Calculate(peak_one_ms);
+			return std::clamp(0.5 * (left - right) / denominator, -0.5, 0.5);
+		}
+
+		// Non-coherent sum of the coarse_ms-long segments over the coarse Doppler grid.
+		// Returns the Doppler frequency of the strongest hypothesis if it passes the threshold
+		std::optional<double> SearchCoarse(const std::vector<const typename DopplerCacheType::Entry*>& coarse_spectra,
+			const typename CodeBankType::SpectrumType& code_spectrum) {
+			const auto size = static_cast<std::size_t>(code_spectrum.size());
+
+			static thread_local std::vector<std::complex<UnderlyingType>> matched_output_batch;
+			static thread_local std::vector<std::complex<UnderlyingType>> matched_output;
+			static thread_local std::vector<std::vector<UnderlyingType>> accumulated_peaks;
+			std::vector<double> doppler_frequencies;
+
+			for (std::size_t segment = 0; segment < coarse_spectra.size(); ++segment) {
+				std::size_t hypothesis = 0;
+				coarse_spectra[segment]->ForEachSpectrum([&](const auto& spectrum, const auto& bin_shifts, const auto& frequencies) {
+					for (std::size_t j = 0; j < bin_shifts.size(); j += doppler_batch_size) {
+						auto current_shifts = std::span(bin_shifts).subspan(j, std::min(doppler_batch_size, bin_shifts.size() - j));
+						Config::MatchedFilterType::FilterShiftedBatch(spectrum, code_spectrum, current_shifts, matched_output_batch);
+
+						for (std::size_t k = 0; k < current_shifts.size(); ++k, ++hypothesis) {
+							matched_output.assign(matched_output_batch.begin() + k * size, matched_output_batch.begin() + (k + 1) * size);
+							auto abs_value = static_cast<std::vector<UnderlyingType>>(Config::AbsType::Transform(matched_output));
+							if (segment == 0) {
+								doppler_frequencies.push_back(frequencies[j + k]);
+								CheckResize(accumulated_peaks, hypothesis + 1);
+								accumulated_peaks[hypothesis] = std::move(abs_value);
+							}
+							else
+								std::transform(abs_value.begin(), abs_value.end(), accumulated_peaks[hypothesis].begin(), accumulated_peaks[hypothesis].begin(), std::plus<UnderlyingType>{});
+						}
+					}
+				});
+			}
+
+			AcquisitionResult<UnderlyingType> tmp, max_result;
+			for (std::size_t i = 0; i < doppler_frequencies.size(); ++i) {
+				auto max_index = Config::MaxIndexType::Transform(accumulated_peaks[i]);
+				auto mean_sigma = Config::MeanStdDevType::Calculate(accumulated_peaks[i]);
 				tmp.level = max_index.value;
 				tmp.sigma = mean_sigma.sigma + mean_sigma.mean;
-				tmp.code_offset = ratio * max_index.index;
-				tmp.doppler = doppler_frequency + intermediate_frequency;
-
-				if (max_result < tmp) {
+				tmp.doppler = doppler_frequencies[i];
+				if (max_result < tmp)
 					max_result = tmp;
-					max_result.output_peak = std::move(peak_one_ms);
+			}
+
+			if (max_result.GetSnr() < coarse_peak_threshold)
+				return std::nullopt;
+
+			return max_result.doppler;
+		}
+
+		// Search over the Doppler hypotheses within [min_doppler, max_doppler]. The two-stage mode additionally
+		// refines the Doppler and code offset with the parabolic interpolation over the neighbouring hypotheses.
+		// The peak below the threshold is only returned without the reshape, the caller compares it to the other sign permutations
+		template <bool reshape = true, bool coherent = true>
+		std::optional<AcquisitionResult<UnderlyingType>> ProcessBpsk(const typename DopplerCacheType::Entry& doppler_spectra,
+			const typename CodeBankType::SpectrumType& code_spectrum, Sv sv, double signal_sampling_rate,
+			double new_sampling_rate, double intermediate_frequency,
+			double min_doppler = -std::numeric_limits<double>::infinity(), double max_doppler = std::numeric_limits<double>::infinity()) {
+			AcquisitionResult<UnderlyingType> tmp, max_result;
+			auto ratio = signal_sampling_rate / new_sampling_rate;
+			const auto size = static_cast<std::size_t>(code_spectrum.size());
+			std::size_t peak_index = 0;
+			std::vector<std::pair<double, double>> doppler_levels;
+
+			static thread_local std::vector<std::complex<UnderlyingType>> matched_output_batch;
+			static thread_local std::vector<std::complex<UnderlyingType>> matched_output;
+
+			doppler_spectra.ForEachSpectrum([&](const auto& spectrum, const auto& bin_shifts, const auto& doppler_frequencies) {
+				for (std::size_t j = 0; j < bin_shifts.size(); j += doppler_batch_size) {
+					auto current_shifts = std::span(bin_shifts).subspan(j, std::min(doppler_batch_size, bin_shifts.size() - j));
+					Config::MatchedFilterType::FilterShiftedBatch(spectrum, code_spectrum, current_shifts, matched_output_batch);
+
+					for (std::size_t k = 0; k < current_shifts.size(); ++k) {
+						matched_output.assign(matched_output_batch.begin() + k * size, matched_output_batch.begin() + (k + 1) * size);
+						auto peak_one_ms = GetOneMsPeak<reshape, coherent>(matched_output, new_sampling_rate);
+
+						auto max_index = Config::MaxIndexType::Transform(peak_one_ms);
+						auto mean_sigma = Config::MeanStdDevType::Calculate(peak_one_ms);
+						tmp.level = max_index.value;
+						tmp.sigma = mean_sigma.sigma + mean_sigma.mean;
+						tmp.code_offset = ratio * max_index.index;
+						tmp.doppler = doppler_frequencies[j + k] + intermediate_frequency;
+						if constexpr (Config::acquisition_mode == AcquisitionMode::TwoStage)
+							doppler_levels.emplace_back(doppler_frequencies[j + k], tmp.level);
+
+						if (max_result < tmp) {
+							max_result = tmp;
+							max_result.output_peak = std::move(peak_one_ms);
+							peak_index = static_cast<std::size_t>(max_index.index);
+						}
+					}
+				}
+			}, min_doppler, max_doppler);
+
+			if constexpr (Config::acquisition_mode == AcquisitionMode::TwoStage) {
+				const auto step = doppler_spectra.doppler_step;
+				auto get_level = [&doppler_levels, step](double frequency) -> std::optional<double> {
+					auto it = std::find_if(doppler_levels.begin(), doppler_levels.end(), [frequency, step](auto& el) {
+						return std::abs(el.first - frequency) < 1e-6 * step;
+					});
+					return it == doppler_levels.end() ? std::nullopt : std::optional<double>(it->second);
+				};
+				auto peak_doppler = max_result.doppler - intermediate_frequency;
+				auto left = get_level(peak_doppler - step);
+				auto right = get_level(peak_doppler + step);
+				if (left.has_value() && right.has_value())
+					max_result.doppler += step * ParabolicOffset(*left, max_result.level, *right);
+
+				const auto& peak = max_result.output_peak;
+				if (peak.size() > 2) {
+					auto left_sample = peak[(peak_index + peak.size() - 1) % peak.size()];
+					auto right_sample = peak[(peak_index + 1) % peak.size()];
+					max_result.code_offset = ratio * (static_cast<double>(peak_index) + ParabolicOffset(left_sample, peak[peak_index], right_sample));
 				}
 			}
+
 			max_result.intermediate_frequency = intermediate_frequency;
 			max_result.sv_number = sv;
-			if (!reshape || max_result.GetSnr() > peak_threshold) {
-				auto lock = std::unique_lock(m);
-				dst.push_back(std::move(max_result));
+			if (!reshape || max_result.GetSnr() > peak_threshold)
+				return max_result;
+
+			return std::nullopt;
+		}
+
+		template <Signal signal_to_acquire, bool reshape = true, bool coherent = true>
+		std::optional<AcquisitionResult<UnderlyingType>> AcquireBpsk(const typename DopplerCacheType::Entry& doppler_spectra,
+			const std::vector<const typename DopplerCacheType::Entry*>& coarse_spectra,
+			Sv sv, std::int32_t code_id, double signal_sampling_rate, double new_sampling_rate, double intermediate_frequency) {
+			const auto& code_spectrum = code_bank.template Get<signal_to_acquire>(code_id, new_sampling_rate, ms_to_process);
+			if constexpr (Config::acquisition_mode == AcquisitionMode::TwoStage) {
+				const auto& coarse_code_spectrum = code_bank.template Get<signal_to_acquire>(code_id, new_sampling_rate, coarse_ms);
+				auto coarse_doppler = SearchCoarse(coarse_spectra, coarse_code_spectrum);
+				if (!coarse_doppler.has_value())
+					return std::nullopt;
+
+				return ProcessBpsk<reshape, coherent>(doppler_spectra, code_spectrum, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency,
+					*coarse_doppler - coarse_doppler_step, *coarse_doppler + coarse_doppler_step);
 			}
+			else
+				return ProcessBpsk<reshape, coherent>(doppler_spectra, code_spectrum, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency);
+		}
+
+		// Single work-stealing pool over the satellites of every system, each task writes into its own slot
+		static void RunTasks(const std::vector<AcquisitionTask>& tasks, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
+			std::vector<std::optional<AcquisitionResult<UnderlyingType>>> results(tasks.size());
+			std::vector<std::size_t> indices(tasks.size());
+			std::iota(indices.begin(), indices.end(), 0);
+			std::for_each(std::execution::par_unseq, indices.begin(), indices.end(), [&](auto i) {
+				results[i] = tasks[i]();
+			});
+
+			for (auto& result : results)
+				if (result.has_value())
+					dst.push_back(std::move(*result));
+		}
+
+		// the subbands and the literas are prepared concurrently, the cache takes a lock for the budget
+		static void RunTasks(const AcquisitionTasks& tasks, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
+			std::for_each(std::execution::par, tasks.preparations.begin(), tasks.preparations.end(), [](auto& preparation) {
+				preparation();
+			});
+			RunTasks(tasks.searches, dst);
 		}
 
 		template <Signal signal_to_acquire>
-		void AcquireGoldCodesL1(const SignalEpoch<UnderlyingType>& epoch, const std::vector<Sv>& satellites, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
+		void ScheduleGoldCodesL1(const SignalEpoch<UnderlyingType>& epoch, const std::vector<Sv>& satellites, AcquisitionTasks& tasks) {
 			if (!digital_frontend.HasSignal(signal_to_acquire))
 				return;
 
@@ -286,21 +539,17 @@ namespace ugsdr {
 
 			auto intermediate_frequency = -(central_frequency - 1575.42e6);
 
-			const auto translated_signal = Config::MixerType::Translate(signal, signal_sampling_rate, -intermediate_frequency);
 			auto new_sampling_rate = AdjustSamplingRate(signal_sampling_rate);
-			auto downsampled_signal = Config::ResamplerType::Transform(translated_signal, static_cast<std::size_t>(new_sampling_rate),
-				static_cast<std::size_t>(signal_sampling_rate));
+			const auto spectra = PrepareDopplerSpectra(signal, signal_sampling_rate, new_sampling_rate, intermediate_frequency, doppler_step, true, tasks);
 
-			std::for_each(std::execution::par_unseq, satellites.begin(), satellites.end(), [&](auto sv) {
-				const auto code = Config::UpsamplerType::Transform(RepeatCodeNTimes(PrnGenerator<signal_to_acquire>::template Get<UnderlyingType>(sv.id), ms_to_process),
-					static_cast<std::size_t>(ms_to_process * new_sampling_rate / 1e3));
-
-				ProcessBpsk(downsampled_signal, code, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency, dst);
-			});
+			for (auto sv : satellites)
+				tasks.searches.push_back([=, this] {
+					return AcquireBpsk<signal_to_acquire>(*spectra->doppler_spectra, spectra->coarse_spectra, sv, sv.id, signal_sampling_rate, new_sampling_rate, intermediate_frequency);
+				});
 		}
 
 		template <Signal signal_to_acquire, bool coherent = true>
-		void AcquireL5(const SignalEpoch<UnderlyingType>& epoch, const std::vector<Sv>& satellites, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
+		void ScheduleL5(const SignalEpoch<UnderlyingType>& epoch, const std::vector<Sv>& satellites, AcquisitionTasks& tasks, double step) {
 			if (!digital_frontend.HasSignal(signal_to_acquire))
 				return;
 
@@ -310,140 +559,369 @@ namespace ugsdr {
 
 			auto intermediate_frequency = -(central_frequency - 1176.45e6);
 
-			const auto translated_signal = Config::MixerType::Translate(signal, signal_sampling_rate, -intermediate_frequency);
 			auto new_sampling_rate = AdjustSamplingRate(signal_sampling_rate, acquisition_sampling_rate_L5);
-			auto downsampled_signal = Config::ResamplerType::Transform(translated_signal, static_cast<std::size_t>(new_sampling_rate),
-				static_cast<std::size_t>(signal_sampling_rate));
+			const auto spectra = PrepareDopplerSpectra(signal, signal_sampling_rate, new_sampling_rate, intermediate_frequency, step, true, tasks);
 
-			std::for_each(std::execution::par_unseq, satellites.begin(), satellites.end(), [&](Sv sv) {
+			for (auto sv : satellites) {
 				sv.signal = signal_to_acquire;
-				const auto code = Config::UpsamplerType::Transform(RepeatCodeNTimes(PrnGenerator<signal_to_acquire>::template Get<UnderlyingType>(sv.id), ms_to_process),
-					static_cast<std::size_t>(ms_to_process * new_sampling_rate / 1e3));
+				tasks.searches.push_back([=, this] {
+					return AcquireBpsk<signal_to_acquire, true, coherent>(*spectra->doppler_spectra, spectra->coarse_spectra, sv, sv.id, signal_sampling_rate, new_sampling_rate, intermediate_frequency);
+				});
+			}
+		}
 
-				ProcessBpsk<true, coherent>(downsampled_signal, code, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency, dst);
-			});
+		template <Signal signal_to_acquire, bool coherent = true>
+		void ScheduleL5(const SignalEpoch<UnderlyingType>& epoch, const std::vector<Sv>& satellites, AcquisitionTasks& tasks) {
+			ScheduleL5<signal_to_acquire, coherent>(epoch, satellites, tasks, doppler_step);
 		}
 
-		void ProcessGps(const SignalEpoch<UnderlyingType>& epoch, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
-			AcquireGoldCodesL1<Signal::GpsCoarseAcquisition_L1>(epoch, gps_sv, dst);
-			if (!dst.empty())
+		template <Signal signal>
+		void BuildCodeSpectra(const std::vector<Sv>& satellites, double target_sampling_rate, bool parallel) {
+			if (!digital_frontend.HasSignal(signal))
 				return;
-			AcquireL5<Signal::Gps_L5I, false>(epoch, gps_sv, dst);
-			if (!dst.empty())
-				return;			
-			AcquireL5<Signal::Gps_L5Q, false>(epoch, gps_sv, dst);
+
+			std::vector<std::int32_t> ids;
+			for (auto& sv : satellites)
+				ids.push_back(static_cast<std::int32_t>(sv.id));
+			auto new_sampling_rate = AdjustSamplingRate(digital_frontend.GetSamplingRate(signal), target_sampling_rate);
+
+			std::vector<std::size_t> durations{ ms_to_process };
+			if constexpr (Config::acquisition_mode == AcquisitionMode::TwoStage)
+				if (signal != Signal::Galileo_E1b)
+					durations.push_back(coarse_ms);
+
+			for (auto duration : durations) {
+				if (parallel)
+					code_bank.template Build<signal>(ids, new_sampling_rate, duration, std::execution::par_unseq);
+				else
+					code_bank.template Build<signal>(ids, new_sampling_rate, duration, std::execution::seq);
+			}
+		}
+
+		// GPS L5 is searched only when L1 found nothing, see Process
+		void ScheduleGps(const SignalEpoch<UnderlyingType>& epoch, AcquisitionTasks& tasks) {
+			if (digital_frontend.HasSignal(Signal::GpsCoarseAcquisition_L1))
+				ScheduleGoldCodesL1<Signal::GpsCoarseAcquisition_L1>(epoch, gps_sv, tasks);
+			else if (digital_frontend.HasSignal(Signal::Gps_L5I))
+				ScheduleL5<Signal::Gps_L5I, false>(epoch, gps_sv, tasks);
+			else
+				ScheduleL5<Signal::Gps_L5Q, false>(epoch, gps_sv, tasks);
 		}
 
-		void ProcessGlonass(const SignalEpoch<UnderlyingType>& epoch, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
+		void ScheduleGlonass(const SignalEpoch<UnderlyingType>& epoch, AcquisitionTasks& tasks) {
 			const auto& signal = epoch.GetSubband(Signal::GlonassCivilFdma_L1);
 			auto signal_sampling_rate = digital_frontend.GetSamplingRate(Signal::GlonassCivilFdma_L1);
 			auto central_frequency = digital_frontend.GetCentralFrequency(Signal::GlonassCivilFdma_L1);
 			auto new_sampling_rate = AdjustSamplingRate(signal_sampling_rate);
+			const auto budget = doppler_cache.GetMemoryBudget() / gln_sv.size();
 
-			const auto code = Config::UpsamplerType::Transform(RepeatCodeNTimes(PrnGenerator<Signal::GlonassCivilFdma_L1>::Get<UnderlyingType>(0), ms_to_process),
-				static_cast<std::size_t>(ms_to_process * new_sampling_rate / 1e3));
+			// every litera is translated and resampled within its own task
+			for (auto litera_number : gln_sv) {
+				tasks.searches.push_back([=, this, &signal] {
+					auto intermediate_frequency = -(central_frequency - (1602e6 + static_cast<std::int32_t>(litera_number) * 0.5625e6));
+					const auto translated_signal = Config::MixerType::Translate(signal, signal_sampling_rate, -intermediate_frequency);
+					auto downsampled_signal = Config::ResamplerType::Transform(translated_signal, static_cast<std::size_t>(new_sampling_rate),
+						static_cast<std::size_t>(signal_sampling_rate));
+					const auto doppler_spectra = DopplerCacheType::MakeEntry(std::move(downsampled_signal), new_sampling_rate,
+						doppler_range, doppler_step, budget);
 
-			std::for_each(std::execution::par_unseq, gln_sv.begin(), gln_sv.end(), [&](Sv litera_number) {
-				auto intermediate_frequency = -(central_frequency - (1602e6 + static_cast<std::int32_t>(litera_number) * 0.5625e6));
-				const auto translated_signal = Config::MixerType::Translate(signal, signal_sampling_rate, -intermediate_frequency);
-				auto downsampled_signal = Config::ResamplerType::Transform(translated_signal, static_cast<std::size_t>(new_sampling_rate),
-					static_cast<std::size_t>(signal_sampling_rate));
+					std::vector<typename DopplerCacheType::Entry> coarse_entries;
+					std::vector<const typename DopplerCacheType::Entry*> coarse_spectra;
+					if constexpr (Config::acquisition_mode == AcquisitionMode::TwoStage) {
+						const auto segments = ms_to_process / coarse_ms;
+						for (std::size_t segment = 0; segment < segments; ++segment)
+							coarse_entries.push_back(DopplerCacheType::MakeEntry(DopplerCacheType::Slice(doppler_spectra.signal, segment, segments),
+								new_sampling_rate, doppler_range, coarse_doppler_step, budget / segments));
+						for (auto& entry : coarse_entries)
+							coarse_spectra.push_back(&entry);
+					}
 
-				ProcessBpsk(downsampled_signal, code, litera_number, signal_sampling_rate, new_sampling_rate, intermediate_frequency, dst);
-			});
+					return AcquireBpsk<Signal::GlonassCivilFdma_L1>(doppler_spectra, coarse_spectra, litera_number, 0, signal_sampling_rate, new_sampling_rate, intermediate_frequency);
+				});
+			}
 		}
 
-		void ProcessGalileo(const SignalEpoch<UnderlyingType>& epoch, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
+		void ScheduleGalileo(const SignalEpoch<UnderlyingType>& epoch, AcquisitionTasks& tasks) {
 			const auto& signal = epoch.GetSubband(Signal::Galileo_E1b);
 			auto signal_sampling_rate = digital_frontend.GetSamplingRate(Signal::Galileo_E1b);
 			auto central_frequency = digital_frontend.GetCentralFrequency(Signal::Galileo_E1b);
 
 			auto intermediate_frequency = -(central_frequency - 1575.42e6);
 
-			const auto translated_signal = Config::MixerType::Translate(signal, signal_sampling_rate, -intermediate_frequency);
 			auto new_sampling_rate = AdjustSamplingRate(signal_sampling_rate);
-			auto downsampled_signal = Config::ResamplerType::Transform(translated_signal, static_cast<std::size_t>(new_sampling_rate),
-				static_cast<std::size_t>(signal_sampling_rate));
-
-			std::for_each(std::execution::par_unseq, galileo_sv.begin(), galileo_sv.end(), [&](auto sv) {
-				auto samples_per_ms = static_cast<std::size_t>(new_sampling_rate / 1e3);
-				const auto ref_code = Config::UpsamplerType::Transform(PrnGenerator<Signal::Galileo_E1b>::Get<UnderlyingType>(sv.id),
-					ms_to_process * samples_per_ms);
-	
-				std::vector<AcquisitionResult<UnderlyingType>> temporary_dst;
-				std::array sign_permutations{
-					std::array<int, 4>{	1,	1,	1,	1	},
-					std::array<int, 4>{	1,	1,	1,	-1	},
-					std::array<int, 4>{	1,	1,	-1,	-1	},
-					std::array<int, 4>{	1,	-1,	-1,	-1	}
-				};
+			const auto spectra = PrepareDopplerSpectra(signal, signal_sampling_rate, new_sampling_rate, intermediate_frequency, doppler_step, false, tasks);
 
-				for (auto& sign_permutation : sign_permutations) {
-					auto code = ref_code;
-					for (std::size_t i = 0; i < sign_permutation.size(); ++i) {
-						std::transform(code.begin() + i * samples_per_ms, code.begin() + (i + 1) * samples_per_ms, code.begin() + i * samples_per_ms,
-							[cur_mul = sign_permutation[i]](auto& val) {return val * cur_mul; });
+			for (auto sv : galileo_sv) {
+				tasks.searches.push_back([=, this]() -> std::optional<AcquisitionResult<UnderlyingType>> {
+					std::optional<AcquisitionResult<UnderlyingType>> max_result;
+					for (std::size_t i = 0; i < CodeBankType::GetSignPermutationsCount(Signal::Galileo_E1b); ++i) {
+						const auto& code_spectrum = code_bank.template Get<Signal::Galileo_E1b>(sv.id, new_sampling_rate, ms_to_process, i);
+						auto result = ProcessBpsk<false>(*spectra->doppler_spectra, code_spectrum, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency);
+						if (!max_result.has_value() || *max_result < *result)
+							max_result = std::move(result);
 					}
-					ProcessBpsk<false>(downsampled_signal, code, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency, temporary_dst);
-				}
-				auto it = std::max_element(temporary_dst.begin(), temporary_dst.end());
 
-				if (it->GetSnr() > peak_threshold) {
-					auto lock = std::unique_lock(m);
-					dst.push_back(std::move(*it));
-				}
-			});
+					if (max_result.has_value() && max_result->GetSnr() > peak_threshold)
+						return max_result;
+					return std::nullopt;
+				});
+			}
 		}
 
-		void ProcessBeiDou(const SignalEpoch<UnderlyingType>& epoch, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
+		void ScheduleBeiDou(const SignalEpoch<UnderlyingType>& epoch, AcquisitionTasks& tasks) {
 			const auto& signal = epoch.GetSubband(Signal::BeiDou_B1I);
 			auto signal_sampling_rate = digital_frontend.GetSamplingRate(Signal::BeiDou_B1I);
 			auto central_frequency = digital_frontend.GetCentralFrequency(Signal::BeiDou_B1I);
 
 			auto intermediate_frequency = -(central_frequency - 1561.098e6);
 
-			const auto translated_signal = Config::MixerType::Translate(signal, signal_sampling_rate, -intermediate_frequency);
 			auto new_sampling_rate = AdjustSamplingRate(signal_sampling_rate);
-			auto downsampled_signal = Config::ResamplerType::Transform(translated_signal, static_cast<std::size_t>(new_sampling_rate),
-				static_cast<std::size_t>(signal_sampling_rate));
+			const auto spectra = PrepareDopplerSpectra(signal, signal_sampling_rate, new_sampling_rate, intermediate_frequency, doppler_step, true, tasks);
+
+			for (auto sv : beidou_sv)
+				tasks.searches.push_back([=, this] {
+					return AcquireBpsk<Signal::BeiDou_B1I>(*spectra->doppler_spectra, spectra->coarse_spectra, sv, sv.id, signal_sampling_rate, new_sampling_rate, intermediate_frequency);
+				});
+		}
+
+		void ScheduleNavIC(const SignalEpoch<UnderlyingType>& epoch, AcquisitionTasks& tasks) {
+			ScheduleL5<Signal::NavIC_L5>(epoch, navic_sv, tasks);
+		}
+
+		// finer Doppler grid of its own, the spectra are cached separately from the NavIC ones of the same subband
+		void ScheduleSbas(const SignalEpoch<UnderlyingType>& epoch, AcquisitionTasks& tasks) {
+			ScheduleL5<Signal::Sbas_L5Q, false>(epoch, sbas_sv, tasks, sbas_doppler_step);
+		}
 
-			std::for_each(std::execution::par_unseq, beidou_sv.begin(), beidou_sv.end(), [&](auto sv) {
-				const auto code = Config::UpsamplerType::Transform(RepeatCodeNTimes(PrnGenerator<Signal::BeiDou_B1I>::Get<UnderlyingType>(sv.id), ms_to_process),
-					static_cast<std::size_t>(ms_to_process * new_sampling_rate / 1e3));
+		void ScheduleQzss(const SignalEpoch<UnderlyingType>& epoch, AcquisitionTasks& tasks) {
+			ScheduleGoldCodesL1<Signal::QzssCoarseAcquisition_L1>(epoch, qzss_sv, tasks);
+		}
 
-				ProcessBpsk(downsampled_signal, code, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency, dst);
+		// Predicted satellites only: the Doppler window around the prediction first, the whole range if the satellite isn't there
+		template <Signal signal_to_acquire, bool coherent = true>
+		void ScheduleAided(const SignalEpoch<UnderlyingType>& epoch, const std::vector<AcquisitionAid>& aids, double target_sampling_rate,
+			double doppler_window, AcquisitionTasks& tasks) {
+			if (!digital_frontend.HasSignal(signal_to_acquire))
+				return;
+
+			std::vector<AcquisitionAid> system_aids;
+			std::copy_if(aids.begin(), aids.end(), std::back_inserter(system_aids), [](auto& aid) {
+				return aid.sv.system == GetSystemBySignal(signal_to_acquire);
 			});
+			if (system_aids.empty())
+				return;
+
+			const auto& signal = epoch.GetSubband(signal_to_acquire);
+			auto signal_sampling_rate = digital_frontend.GetSamplingRate(signal_to_acquire);
+			auto central_frequency = digital_frontend.GetCentralFrequency(signal_to_acquire);
+			auto new_sampling_rate = AdjustSamplingRate(signal_sampling_rate, target_sampling_rate);
+
+			// GLONASS literas have their own spectra, the other satellites share the subband ones
+			std::map<double, std::shared_ptr<const PreparedSpectra>> prepared_spectra;
+			for (auto aid : system_aids) {
+				aid.sv.signal = signal_to_acquire;
+				const auto carrier_frequency = GetAcquisitionCarrierFrequency(aid.sv);
+				const auto intermediate_frequency = carrier_frequency - central_frequency;
+				auto& spectra = prepared_spectra[intermediate_frequency];
+				if (!spectra)
+					spectra = PrepareDopplerSpectra(signal, signal_sampling_rate, new_sampling_rate, intermediate_frequency, doppler_step, false, tasks);
+
+				tasks.searches.push_back([=, this]() -> std::optional<AcquisitionResult<UnderlyingType>> {
+					const auto sv = aid.sv;
+					const auto& doppler_spectra = *spectra->doppler_spectra;
+					const auto code_id = signal_to_acquire == Signal::GlonassCivilFdma_L1 ? 0 : static_cast<std::int32_t>(sv.id);
+
+					auto search = [&](double min_doppler, double max_doppler) -> std::optional<AcquisitionResult<UnderlyingType>> {
+						if constexpr (signal_to_acquire == Signal::Galileo_E1b) {
+							std::optional<AcquisitionResult<UnderlyingType>> max_result;
+							for (std::size_t j = 0; j < CodeBankType::GetSignPermutationsCount(signal_to_acquire); ++j) {
+								const auto& code_spectrum = code_bank.template Get<signal_to_acquire>(code_id, new_sampling_rate, ms_to_process, j);
+								auto result = ProcessBpsk<false>(doppler_spectra, code_spectrum, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency,
+									min_doppler, max_doppler);
+								if (!max_result.has_value() || *max_result < *result)
+									max_result = std::move(result);
+							}
+							if (max_result.has_value() && max_result->GetSnr() > peak_threshold)
+								return max_result;
+							return std::nullopt;
+						}
+						else {
+							const auto& code_spectrum = code_bank.template Get<signal_to_acquire>(code_id, new_sampling_rate, ms_to_process);
+							return ProcessBpsk<true, coherent>(doppler_spectra, code_spectrum, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency,
+								min_doppler, max_doppler);
+						}
+					};
+
+					const auto predicted_doppler = GetAidedDoppler(aid, carrier_frequency);
+					auto result = search(predicted_doppler - doppler_window, predicted_doppler + doppler_window);
+					if (!result.has_value())
+						result = search(-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity());
+					return result;
+				});
+			}
 		}
 
-		void ProcessNavIC(const SignalEpoch<UnderlyingType>& epoch, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
-			AcquireL5<Signal::NavIC_L5>(epoch, navic_sv, dst);
+		// Per satellite state of the long integration, one millisecond of the combined statistic for every Doppler
+		// hypothesis. The size doesn't depend on the number of blocks
+		struct IntegrationJob {
+			Sv sv;
+			bool coherent = true;
+			double signal_sampling_rate = 0.0;
+			double new_sampling_rate = 0.0;
+			double intermediate_frequency = 0.0;
+			const typename CodeBankType::SpectrumType* code_spectrum = nullptr;
+			std::vector<double> doppler_frequencies;
+			std::vector<UnderlyingType> accumulated;
+			std::vector<std::complex<UnderlyingType>> previous;
+			std::vector<std::complex<UnderlyingType>> differential;
+		};
+
+		auto GetIntegrationBytes(const IntegrationJob& job) const {
+			const auto hypotheses = static_cast<std::size_t>(std::floor(2 * doppler_range / doppler_step + 1e-9)) + 1;
+			const auto samples_per_ms = static_cast<std::size_t>(job.new_sampling_rate / 1e3);
+			const auto bytes_per_sample = integration_mode == IntegrationMode::NonCoherent ? sizeof(UnderlyingType) : 2 * sizeof(std::complex<UnderlyingType>);
+			return hypotheses * samples_per_ms * bytes_per_sample;
 		}
 
-		void ProcessSbas(const SignalEpoch<UnderlyingType>& epoch, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
-			const auto& signal = epoch.GetSubband(Signal::Sbas_L5Q);
-			auto signal_sampling_rate = digital_frontend.GetSamplingRate(Signal::Sbas_L5Q);
-			auto central_frequency = digital_frontend.GetCentralFrequency(Signal::Sbas_L5Q);
+		template <Signal signal_to_acquire, bool coherent = true>
+		void AddIntegrationJobs(const std::vector<Sv>& satellites, double carrier_frequency, double target_sampling_rate, std::vector<IntegrationJob>& jobs,
+			std::optional<std::int32_t> shared_code_id = std::nullopt) {
+			auto signal_sampling_rate = digital_frontend.GetSamplingRate(signal_to_acquire);
+			auto central_frequency = digital_frontend.GetCentralFrequency(signal_to_acquire);
+			auto new_sampling_rate = AdjustSamplingRate(signal_sampling_rate, target_sampling_rate);
 
-			auto intermediate_frequency = -(central_frequency - 1176.45e6);
+			// GLONASS literas share the code, every other satellite has its own
+			std::vector<std::int32_t> ids;
+			for (auto& sv : satellites)
+				ids.push_back(shared_code_id.value_or(static_cast<std::int32_t>(sv.id)));
+			code_bank.template Build<signal_to_acquire>(ids, new_sampling_rate, coherent_ms, std::execution::par_unseq);
 
-			const auto translated_signal = Config::MixerType::Translate(signal, signal_sampling_rate, -intermediate_frequency);
-			auto new_sampling_rate = AdjustSamplingRate(signal_sampling_rate, acquisition_sampling_rate_L5);
-			auto downsampled_signal = Config::ResamplerType::Transform(translated_signal, static_cast<std::size_t>(new_sampling_rate),
-				static_cast<std::size_t>(signal_sampling_rate));
+			for (std::size_t i = 0; i < satellites.size(); ++i) {
+				auto& job = jobs.emplace_back();
+				job.sv = satellites[i];
+				job.sv.signal = signal_to_acquire;
+				job.coherent = coherent;
+				job.signal_sampling_rate = signal_sampling_rate;
+				job.new_sampling_rate = new_sampling_rate;
+				job.intermediate_frequency = -(central_frequency - carrier_frequency);
+				if constexpr (signal_to_acquire == Signal::GlonassCivilFdma_L1)
+					job.intermediate_frequency += static_cast<std::int32_t>(satellites[i]) * 0.5625e6;
+				job.code_spectrum = &code_bank.template Get<signal_to_acquire>(ids[i], new_sampling_rate, coherent_ms);
+			}
+		}
 
-			auto sbas_doppler_step = 10.0;
-			std::swap(sbas_doppler_step, doppler_step);
-			std::for_each(std::execution::par_unseq, sbas_sv.begin(), sbas_sv.end(), [&](auto sv) {
-				const auto code = Config::UpsamplerType::Transform(RepeatCodeNTimes(PrnGenerator<Signal::Sbas_L5Q>::Get<UnderlyingType>(sv.id), ms_to_process),
-					static_cast<std::size_t>(ms_to_process * new_sampling_rate / 1e3));
+		auto GetIntegrationJobs() {
+			std::vector<IntegrationJob> jobs;
+			if (digital_frontend.HasSignal(Signal::GpsCoarseAcquisition_L1))
+				AddIntegrationJobs<Signal::GpsCoarseAcquisition_L1>(gps_sv, 1575.42e6, acquisition_sampling_rate, jobs);
+			else if (digital_frontend.HasSignal(Signal::Gps_L5I))
+				AddIntegrationJobs<Signal::Gps_L5I, false>(gps_sv, 1176.45e6, acquisition_sampling_rate_L5, jobs);
+			else if (digital_frontend.HasSignal(Signal::Gps_L5Q))
+				AddIntegrationJobs<Signal::Gps_L5Q, false>(gps_sv, 1176.45e6, acquisition_sampling_rate_L5, jobs);
+			if (digital_frontend.HasSignal(Signal::GlonassCivilFdma_L1))
+				AddIntegrationJobs<Signal::GlonassCivilFdma_L1>(gln_sv, 1602e6, acquisition_sampling_rate, jobs, 0);
+			if (digital_frontend.HasSignal(Signal::BeiDou_B1I))
+				AddIntegrationJobs<Signal::BeiDou_B1I>(beidou_sv, 1561.098e6, acquisition_sampling_rate, jobs);
+			if (digital_frontend.HasSignal(Signal::NavIC_L5))
+				AddIntegrationJobs<Signal::NavIC_L5>(navic_sv, 1176.45e6, acquisition_sampling_rate_L5, jobs);
+			if (digital_frontend.HasSignal(Signal::Sbas_L5Q))
+				AddIntegrationJobs<Signal::Sbas_L5Q, false>(sbas_sv, 1176.45e6, acquisition_sampling_rate_L5, jobs);
+			if (digital_frontend.HasSignal(Signal::QzssCoarseAcquisition_L1))
+				AddIntegrationJobs<Signal::QzssCoarseAcquisition_L1>(qzss_sv, 1575.42e6, acquisition_sampling_rate, jobs);
+			return jobs;
+		}
 
-				ProcessBpsk<true, false>(downsampled_signal, code, sv, signal_sampling_rate, new_sampling_rate, intermediate_frequency, dst);
+		// Correlation of one coherent block over every Doppler hypothesis, folded to one millisecond and combined with the previous blocks
+		void IntegrateBlock(IntegrationJob& job, const typename DopplerCacheType::Entry& doppler_spectra, std::size_t block) {
+			const auto size = static_cast<std::size_t>(job.code_spectrum->size());
+			const auto samples_per_ms = static_cast<std::size_t>(job.new_sampling_rate / 1e3);
+
+			static thread_local std::vector<std::complex<UnderlyingType>> matched_output_batch;
+			static thread_local std::vector<std::complex<UnderlyingType>> matched_output;
+
+			if (block == 0) {
+				std::size_t hypotheses = 0;
+				for (auto& shifts : doppler_spectra.bin_shifts)
+					hypotheses += shifts.size();
+
+				job.doppler_frequencies.clear();
+				if (integration_mode == IntegrationMode::NonCoherent)
+					job.accumulated.assign(hypotheses * samples_per_ms, 0);
+				else {
+					job.previous.assign(hypotheses * samples_per_ms, 0);
+					job.differential.assign(hypotheses * samples_per_ms, 0);
+				}
+			}
+
+			std::size_t hypothesis = 0;
+			doppler_spectra.ForEachSpectrum([&](const auto& spectrum, const auto& bin_shifts, const auto& doppler_frequencies) {
+				for (std::size_t j = 0; j < bin_shifts.size(); j += doppler_batch_size) {
+					auto current_shifts = std::span(bin_shifts).subspan(j, std::min(doppler_batch_size, bin_shifts.size() - j));
+					Config::MatchedFilterType::FilterShiftedBatch(spectrum, *job.code_spectrum, current_shifts, matched_output_batch);
+
+					for (std::size_t k = 0; k < current_shifts.size(); ++k, ++hypothesis) {
+						matched_output.assign(matched_output_batch.begin() + k * size, matched_output_batch.begin() + (k + 1) * size);
+						if (block == 0)
+							job.doppler_frequencies.push_back(doppler_frequencies[j + k]);
+
+						const auto offset = hypothesis * samples_per_ms;
+						if (integration_mode == IntegrationMode::NonCoherent) {
+							auto peak_one_ms = job.coherent ?
+								static_cast<std::vector<UnderlyingType>>(GetOneMsPeak<true, true>(matched_output, job.new_sampling_rate)) :
+								static_cast<std::vector<UnderlyingType>>(GetOneMsPeak<true, false>(matched_output, job.new_sampling_rate));
+							std::transform(peak_one_ms.begin(), peak_one_ms.end(), job.accumulated.begin() + offset, job.accumulated.begin() + offset, std::plus<UnderlyingType>{});
+						}
+						else {
+							auto folded = static_cast<std::vector<std::complex<UnderlyingType>>>(Config::ReshapeAndSumType::Transform(std::as_const(matched_output), samples_per_ms));
+							if (block != 0)
+								for (std::size_t i = 0; i < samples_per_ms; ++i)
+									job.differential[offset + i] += folded[i] * std::conj(job.previous[offset + i]);
+							std::copy(folded.begin(), folded.end(), job.previous.begin() + offset);
+						}
+					}
+				}
 			});
-			std::swap(sbas_doppler_step, doppler_step);
 		}
 
-		void ProcessQzss(const SignalEpoch<UnderlyingType>& epoch, std::vector<AcquisitionResult<UnderlyingType>>& dst) {
-			AcquireGoldCodesL1<Signal::QzssCoarseAcquisition_L1>(epoch, qzss_sv, dst);
+		std::optional<AcquisitionResult<UnderlyingType>> FinalizeIntegration(IntegrationJob& job) {
+			const auto samples_per_ms = static_cast<std::size_t>(job.new_sampling_rate / 1e3);
+			const auto ratio = job.signal_sampling_rate / job.new_sampling_rate;
+
+			static thread_local std::vector<std::complex<UnderlyingType>> differential_one_ms;
+			std::vector<UnderlyingType> statistic;
+
+			AcquisitionResult<UnderlyingType> tmp, max_result;
+			for (std::size_t i = 0; i < job.doppler_frequencies.size(); ++i) {
+				if (integration_mode == IntegrationMode::NonCoherent)
+					statistic.assign(job.accumulated.begin() + i * samples_per_ms, job.accumulated.begin() + (i + 1) * samples_per_ms);
+				else {
+					differential_one_ms.assign(job.differential.begin() + i * samples_per_ms, job.differential.begin() + (i + 1) * samples_per_ms);
+					statistic = static_cast<std::vector<UnderlyingType>>(Config::AbsType::Transform(differential_one_ms));
+				}
+
+				auto max_index = Config::MaxIndexType::Transform(statistic);
+				auto mean_sigma = Config::MeanStdDevType::Calculate(statistic);
+				tmp.level = max_index.value - mean_sigma.mean;
+				tmp.sigma = mean_sigma.sigma;
+				tmp.code_offset = ratio * max_index.index;
+				tmp.doppler = job.doppler_frequencies[i] + job.intermediate_frequency;
+				if (max_result < tmp) {
+					max_result = tmp;
+					max_result.output_peak = std::move(statistic);
+				}
+			}
+
+			job.accumulated = {};
+			job.previous = {};
+			job.differential = {};
+
+			max_result.intermediate_frequency = job.intermediate_frequency;
+			max_result.sv_number = job.sv;
+			const auto threshold = integration_mode == IntegrationMode::NonCoherent ? non_coherent_threshold : differential_threshold;
+			if (max_result.GetSnr() > threshold)
+				return max_result;
+
+			return std::nullopt;
 		}
 		
 	public:
@@ -454,10 +932,132 @@ namespace ugsdr {
 			InitSatellites();
 		}
 
+		// Spectra of the Doppler-translated signal are shared between all PRNs (and systems) acquired from the same subband within one epoch.
+		// Residual spectra exceeding the budget are recomputed by each PRN instead
+		void SetDopplerCacheMemoryBudget(std::size_t bytes) {
+			doppler_cache.SetMemoryBudget(bytes);
+		}
+
+		// Code spectra are kept between the Process() calls anyway, prebuilding them moves the code generation and FFTs out of the first acquisition
+		void BuildCodeSpectrumBank(bool parallel = true) {
+			BuildCodeSpectra<Signal::GpsCoarseAcquisition_L1>(gps_sv, acquisition_sampling_rate, parallel);
+			BuildCodeSpectra<Signal::Gps_L5I>(gps_sv, acquisition_sampling_rate_L5, parallel);
+			BuildCodeSpectra<Signal::Gps_L5Q>(gps_sv, acquisition_sampling_rate_L5, parallel);
+			BuildCodeSpectra<Signal::GlonassCivilFdma_L1>({ Sv{ 0, System::Glonass, Signal::GlonassCivilFdma_L1 } }, acquisition_sampling_rate, parallel);
+			BuildCodeSpectra<Signal::Galileo_E1b>(galileo_sv, acquisition_sampling_rate, parallel);
+			BuildCodeSpectra<Signal::BeiDou_B1I>(beidou_sv, acquisition_sampling_rate, parallel);
+			BuildCodeSpectra<Signal::NavIC_L5>(navic_sv, acquisition_sampling_rate_L5, parallel);
+			BuildCodeSpectra<Signal::Sbas_L5Q>(sbas_sv, acquisition_sampling_rate_L5, parallel);
+			BuildCodeSpectra<Signal::QzssCoarseAcquisition_L1>(qzss_sv, acquisition_sampling_rate, parallel);
+		}
+
+		// Coherent length and number of the blocks combined by ProcessLongIntegration. The Doppler step has to be
+		// reduced for the longer blocks, the coherent gain vanishes for the frequency errors beyond 1 / (2 * coherent_ms)
+		void SetIntegration(std::size_t coherent_length_ms, std::size_t blocks, IntegrationMode mode = IntegrationMode::NonCoherent) {
+			if (coherent_length_ms == 0 || blocks == 0)
+				throw std::runtime_error("Integration requires at least one non-empty block");
+			if (mode == IntegrationMode::Differential && blocks < 2)
+				throw std::runtime_error("Differential integration requires at least two blocks");
+
+			coherent_ms = coherent_length_ms;
+			integration_blocks = blocks;
+			integration_mode = mode;
+		}
+
+		// Satellites whose statistics don't fit into the budget are integrated in the additional passes over the same blocks
+		void SetIntegrationMemoryBudget(std::size_t bytes) {
+			integration_memory_budget = bytes;
+		}
+
+		// Acquisition of the weak signals. The blocks are taken from the front end one at a time and combined with the statistics
+		// of the previous ones, so the memory doesn't grow with the integration time. Galileo E1B is only acquired by Process(),
+		// its secondary code signs are searched within the 4 ms coherent block
+		auto ProcessLongIntegration(std::size_t ms_offset = 0) {
+			std::vector<AcquisitionResult<UnderlyingType>> dst;
+			auto jobs = GetIntegrationJobs();
+
+			for (std::size_t pass_begin = 0; pass_begin < jobs.size();) {
+				auto pass_end = pass_begin + 1;
+				auto pass_bytes = GetIntegrationBytes(jobs[pass_begin]);
+				for (; pass_end < jobs.size() && pass_bytes + GetIntegrationBytes(jobs[pass_end]) <= integration_memory_budget; ++pass_end)
+					pass_bytes += GetIntegrationBytes(jobs[pass_end]);
+				auto pass = std::span(jobs).subspan(pass_begin, pass_end - pass_begin);
+
+				std::vector<const typename DopplerCacheType::Entry*> doppler_spectra(pass.size());
+				for (std::size_t block = 0; block < integration_blocks; ++block) {
+					auto& epoch_data = digital_frontend.GetSeveralEpochs(ms_offset + block * coherent_ms, coherent_ms);
+					doppler_cache.Clear();
+
+					// satellites of the same subband share the spectra, the cache computes them once
+					std::for_each(std::execution::par, pass.begin(), pass.end(), [&](auto& job) {
+						doppler_spectra[static_cast<std::size_t>(&job - pass.data())] = &GetDopplerSpectra(epoch_data.GetSubband(job.sv.signal),
+							job.signal_sampling_rate, job.new_sampling_rate, job.intermediate_frequency);
+					});
+
+					std::for_each(std::execution::par_unseq, pass.begin(), pass.end(), [&](auto& job) {
+						IntegrateBlock(job, *doppler_spectra[static_cast<std::size_t>(&job - pass.data())], block);
+					});
+				}
+
+				std::vector<AcquisitionTask> tasks;
+				for (auto& job : pass)
+					tasks.push_back([this, &job] {
+						return FinalizeIntegration(job);
+					});
+				RunTasks(tasks, dst);
+				pass_begin = pass_end;
+			}
+
+			std::sort(dst.begin(), dst.end(), [](auto& lhs, auto& rhs) {
+				return lhs.sv_number < rhs.sv_number;
+			});
+			doppler_cache.Clear();
+
+			return dst;
+		}
+
+		// Warm start from the predicted satellites, e.g. AcquisitionAidPredictor or MakeAcquisitionAids of the previous session.
+		// doppler_window has to cover the prediction error and the oscillator offset, the satellites missing from the aids aren't searched
+		auto ProcessWarmStart(const std::vector<AcquisitionAid>& aids, double doppler_window, std::size_t ms_offset = 0) {
+			std::vector<AcquisitionResult<UnderlyingType>> dst;
+			dst.reserve(aids.size());
+			auto& epoch_data = digital_frontend.GetSeveralEpochs(ms_offset, ms_to_process);
+			doppler_cache.Clear();
+
+			AcquisitionTasks tasks;
+			if (digital_frontend.HasSignal(Signal::GpsCoarseAcquisition_L1))
+				ScheduleAided<Signal::GpsCoarseAcquisition_L1>(epoch_data, aids, acquisition_sampling_rate, doppler_window, tasks);
+			else if (digital_frontend.HasSignal(Signal::Gps_L5I))
+				ScheduleAided<Signal::Gps_L5I, false>(epoch_data, aids, acquisition_sampling_rate_L5, doppler_window, tasks);
+			else
+				ScheduleAided<Signal::Gps_L5Q, false>(epoch_data, aids, acquisition_sampling_rate_L5, doppler_window, tasks);
+			ScheduleAided<Signal::GlonassCivilFdma_L1>(epoch_data, aids, acquisition_sampling_rate, doppler_window, tasks);
+			ScheduleAided<Signal::Galileo_E1b>(epoch_data, aids, acquisition_sampling_rate, doppler_window, tasks);
+			ScheduleAided<Signal::BeiDou_B1I>(epoch_data, aids, acquisition_sampling_rate, doppler_window, tasks);
+			ScheduleAided<Signal::NavIC_L5>(epoch_data, aids, acquisition_sampling_rate_L5, doppler_window, tasks);
+			ScheduleAided<Signal::Sbas_L5Q, false>(epoch_data, aids, acquisition_sampling_rate_L5, doppler_window, tasks);
+			ScheduleAided<Signal::QzssCoarseAcquisition_L1>(epoch_data, aids, acquisition_sampling_rate, doppler_window, tasks);
+			RunTasks(tasks, dst);
+
+			std::sort(dst.begin(), dst.end(), [](auto& lhs, auto& rhs) {
+				return lhs.sv_number < rhs.sv_number;
+			});
+			doppler_cache.Clear();
+
+			return dst;
+		}
+
+		// receiver_position is the prior ECEF position, m; time is the approximate GPS time of the record
+		auto ProcessWarmStart(const AcquisitionAidPredictor& predictor, gtime_t time, const std::array<double, 3>& receiver_position,
+			double doppler_window, std::size_t ms_offset = 0) {
+			return ProcessWarmStart(predictor.Predict(time, receiver_position), doppler_window, ms_offset);
+		}
+
 		auto Process(bool plot_results = false, std::size_t ms_offset = 0) {
 			std::vector<AcquisitionResult<UnderlyingType>> dst;
 			dst.reserve(gps_sv.size() + gln_sv.size());
 			auto& epoch_data = digital_frontend.GetSeveralEpochs(ms_offset, ms_to_process);
+			doppler_cache.Clear();
 
 			if (plot_results) {
 				if (digital_frontend.HasSignal(Signal::GpsCoarseAcquisition_L1))
@@ -480,24 +1080,45 @@ namespace ugsdr {
 					ugsdr::Add(L"QZSS acquisition input signal", epoch_data.GetSubband(Signal::QzssCoarseAcquisition_L1), digital_frontend.GetSamplingRate(Signal::QzssCoarseAcquisition_L1));
 			}
 				
+			// the satellites of all the systems are searched by the same pool
+			AcquisitionTasks tasks;
 			if (digital_frontend.HasSignal(Signal::GpsCoarseAcquisition_L1) || digital_frontend.HasSignal(Signal::Gps_L5I) || digital_frontend.HasSignal(Signal::Gps_L5Q))
-				ProcessGps(epoch_data, dst);
+				ScheduleGps(epoch_data, tasks);
 			if (digital_frontend.HasSignal(Signal::GlonassCivilFdma_L1))
-				ProcessGlonass(epoch_data, dst);
+				ScheduleGlonass(epoch_data, tasks);
 			if (digital_frontend.HasSignal(Signal::Galileo_E1b))
-				ProcessGalileo(epoch_data, dst);
+				ScheduleGalileo(epoch_data, tasks);
 			if (digital_frontend.HasSignal(Signal::BeiDou_B1I))
-				ProcessBeiDou(epoch_data, dst);
+				ScheduleBeiDou(epoch_data, tasks);
 			if (digital_frontend.HasSignal(Signal::NavIC_L5))
-				ProcessNavIC(epoch_data, dst);
+				ScheduleNavIC(epoch_data, tasks);
 			if (digital_frontend.HasSignal(Signal::Sbas_L5Q))
-				ProcessSbas(epoch_data, dst);
+				ScheduleSbas(epoch_data, tasks);
 			if (digital_frontend.HasSignal(Signal::QzssCoarseAcquisition_L1))
-				ProcessQzss(epoch_data, dst);
+				ScheduleQzss(epoch_data, tasks);
+			RunTasks(tasks, dst);
+
+			// GPS signals after the first one are searched only if the preceding ones found nothing, as ScheduleGps starts with L1
+			auto has_gps = [&dst] {
+				return std::any_of(dst.begin(), dst.end(), [](auto& el) {
+					return el.sv_number.system == System::Gps;
+				});
+			};
+			if (!has_gps() && digital_frontend.HasSignal(Signal::GpsCoarseAcquisition_L1)) {
+				tasks.clear();
+				ScheduleL5<Signal::Gps_L5I, false>(epoch_data, gps_sv, tasks);
+				RunTasks(tasks, dst);
+			}
+			if (!has_gps() && (digital_frontend.HasSignal(Signal::GpsCoarseAcquisition_L1) || digital_frontend.HasSignal(Signal::Gps_L5I))) {
+				tasks.clear();
+				ScheduleL5<Signal::Gps_L5Q, false>(epoch_data, gps_sv, tasks);
+				RunTasks(tasks, dst);
+			}
 		
 			std::sort(dst.begin(), dst.end(), [](auto& lhs, auto& rhs) {
 				return lhs.sv_number < rhs.sv_number;
 			});
+			doppler_cache.Clear();
 
 			if (plot_results)
 				for (auto& acquisition_result : dst)
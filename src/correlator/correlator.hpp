@@ -5,19 +5,76 @@
 #include <complex>
 #include <numeric>
 #include <span>
+#include <stdexcept>
 #include <vector>
 
 namespace ugsdr {
+	// One correlator output: the code is read from code_offset and the sum is split at the sample
+	// where the code period ends, so the caller is able to account for the navigation bit transition
+	struct CorrelatorTap {
+		std::size_t code_offset = 0;
+		std::size_t split = 0;
+	};
+
+	template <typename T>
+	struct SplitCorrelation {
+		std::complex<T> first{};
+		std::complex<T> second{};
+	};
+
+	// code container read by the correlator, the ones working on the packed codes declare their own CodeType
+	template <typename CorrelatorType, typename T>
+	struct CorrelatorCode {
+		using Type = std::vector<T>;
+	};
+	template <typename CorrelatorType, typename T> requires requires { typename CorrelatorType::CodeType; }
+	struct CorrelatorCode<CorrelatorType, T> {
+		using Type = typename CorrelatorType::CodeType;
+	};
+	template <typename CorrelatorType, typename T>
+	using CorrelatorCodeType = typename CorrelatorCode<CorrelatorType, T>::Type;
+
 	template <typename CorrelatorImpl>
 	class Correlator {
 	protected:
-	public:
+		static void CheckTaps(std::size_t signal_size, std::size_t code_size, std::span<const CorrelatorTap> taps, std::size_t dst_size) {
+			if (taps.size() != dst_size)
+				throw std::runtime_error("Size mismatch");
+			for (const auto& tap : taps)
+				if (tap.split > signal_size || tap.code_offset + signal_size > code_size)
+					throw std::runtime_error("Correlator tap is out of the code range");
+		}
 
+		template <typename UnderlyingType, typename T>
+		static void ProcessMultipleByTap(std::span<const std::complex<UnderlyingType>> signal, std::span<const T> code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst) {
+			for (std::size_t i = 0; i < taps.size(); ++i) {
+				const auto split = taps[i].split;
+				const auto code_begin = code.begin() + taps[i].code_offset;
+
+				dst[i].first = CorrelatorImpl::Process(signal.first(split), std::span<const T>(code_begin, split));
+				dst[i].second = CorrelatorImpl::Process(signal.subspan(split), std::span<const T>(code_begin + split, signal.size() - split));
+			}
+		}
+
+	public:
 		template <Container T1, Container T2>
 		[[nodiscard]]
 		static auto Correlate(const T1& signal, const T2& code) {
 			return CorrelatorImpl::Process(signal, code);
 		}
+
+		// correlates the signal with several shifted replicas of the same code, e.g. early, prompt and late
+		template <typename UnderlyingType, typename T>
+		static void CorrelateMultiple(std::span<const std::complex<UnderlyingType>> signal, std::span<const T> code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst) {
+			CheckTaps(signal.size(), code.size(), taps, dst.size());
+
+			if constexpr (requires { CorrelatorImpl::ProcessMultiple(signal, code, taps, dst); })
+				CorrelatorImpl::ProcessMultiple(signal, code, taps, dst);
+			else
+				ProcessMultipleByTap(signal, code, taps, dst);
+		}
 	};
 
 	class SequentialCorrelator : public Correlator<SequentialCorrelator> {
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "correlator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace ugsdr {
+	// Computes up to max_taps_per_pass correlator outputs (VE/E/P/L/VL etc.) in a single pass over the signal.
+	// Splits of the taps cut the signal into segments, within a segment every tap accumulates into the same half,
+	// so the inner loop has no branches and reads each sample once for all the shifted code pointers
+	class FusedCorrelator : public Correlator<FusedCorrelator> {
+	public:
+		// carrier replica exp(j * (phase + phase_step * n)), it's generated on the fly by CorrelateMultipleWithCarrier
+		struct Carrier {
+			double phase = 0.0;
+			double phase_step = 0.0;
+		};
+
+	private:
+		constexpr static inline std::size_t max_taps_per_pass = 8;
+
+		// samples per step, each tap keeps independent interleaved (re, im) partial sums for them, so the additions
+		// don't wait for each other and the sums map directly onto the SIMD registers
+		constexpr static inline std::size_t lanes = 8;
+
+		template <std::size_t taps_count, bool wipe_off, typename UnderlyingType, typename T>
+		static void Accumulate(const UnderlyingType* signal, const std::array<const T*, taps_count>& codes, std::size_t begin, std::size_t end,
+			const Carrier& carrier, std::array<UnderlyingType, taps_count>& re, std::array<UnderlyingType, taps_count>& im) {
+			std::array<std::array<UnderlyingType, 2 * lanes>, taps_count> partial_sums{};
+
+			// the carrier of every lane is rotated by lanes samples per step and restarted from the exact phase in each segment
+			std::array<UnderlyingType, lanes> carrier_re{};
+			std::array<UnderlyingType, lanes> carrier_im{};
+			auto rotation = std::complex<UnderlyingType>{};
+			std::array<UnderlyingType, 2 * lanes> wiped_off{};
+			if constexpr (wipe_off) {
+				for (std::size_t k = 0; k < lanes; ++k) {
+					const auto lane_carrier = std::polar(1.0, carrier.phase + carrier.phase_step * static_cast<double>(begin + k));
+					carrier_re[k] = static_cast<UnderlyingType>(lane_carrier.real());
+					carrier_im[k] = static_cast<UnderlyingType>(lane_carrier.imag());
+				}
+				rotation = std::complex<UnderlyingType>(std::polar(1.0, carrier.phase_step * static_cast<double>(lanes)));
+			}
+
+			auto i = begin;
+			for (; i + lanes <= end; i += lanes) {
+				auto current_signal = signal + 2 * i;
+				if constexpr (wipe_off) {
+					for (std::size_t k = 0; k < lanes; ++k) {
+						wiped_off[2 * k] = current_signal[2 * k] * carrier_re[k] - current_signal[2 * k + 1] * carrier_im[k];
+						wiped_off[2 * k + 1] = current_signal[2 * k] * carrier_im[k] + current_signal[2 * k + 1] * carrier_re[k];
+
+						const auto rotated_re = carrier_re[k] * rotation.real() - carrier_im[k] * rotation.imag();
+						carrier_im[k] = carrier_re[k] * rotation.imag() + carrier_im[k] * rotation.real();
+						carrier_re[k] = rotated_re;
+					}
+					current_signal = wiped_off.data();
+				}
+
+				for (std::size_t j = 0; j < taps_count; ++j) {
+					const auto current_code = codes[j] + i;
+					for (std::size_t k = 0; k < lanes; ++k) {
+						const auto code = static_cast<UnderlyingType>(current_code[k]);
+						partial_sums[j][2 * k] += current_signal[2 * k] * code;
+						partial_sums[j][2 * k + 1] += current_signal[2 * k + 1] * code;
+					}
+				}
+			}
+			for (; i < end; ++i) {
+				auto sample = std::complex<UnderlyingType>(signal[2 * i], signal[2 * i + 1]);
+				if constexpr (wipe_off)
+					sample *= std::complex<UnderlyingType>(std::polar(1.0, carrier.phase + carrier.phase_step * static_cast<double>(i)));
+
+				for (std::size_t j = 0; j < taps_count; ++j) {
+					const auto code = static_cast<UnderlyingType>(codes[j][i]);
+					partial_sums[j][0] += sample.real() * code;
+					partial_sums[j][1] += sample.imag() * code;
+				}
+			}
+
+			for (std::size_t j = 0; j < taps_count; ++j) {
+				for (std::size_t k = 0; k < lanes; ++k) {
+					re[j] += partial_sums[j][2 * k];
+					im[j] += partial_sums[j][2 * k + 1];
+				}
+			}
+		}
+
+		template <std::size_t taps_count, bool wipe_off, typename UnderlyingType, typename T>
+		static void ProcessPass(std::span<const std::complex<UnderlyingType>> signal, std::span<const T> code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst, const Carrier& carrier) {
+			std::array<const T*, taps_count> codes{};
+			std::array<std::size_t, taps_count + 2> bounds{};
+			for (std::size_t i = 0; i < taps_count; ++i) {
+				codes[i] = code.data() + taps[i].code_offset;
+				bounds[i + 1] = taps[i].split;
+			}
+			bounds.back() = signal.size();
+			std::sort(bounds.begin(), bounds.end());
+
+			const auto signal_ptr = reinterpret_cast<const UnderlyingType*>(signal.data());
+			for (std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+				if (bounds[i] == bounds[i + 1])
+					continue;
+
+				std::array<UnderlyingType, taps_count> re{};
+				std::array<UnderlyingType, taps_count> im{};
+				Accumulate<taps_count, wipe_off>(signal_ptr, codes, bounds[i], bounds[i + 1], carrier, re, im);
+
+				for (std::size_t j = 0; j < taps_count; ++j) {
+					auto& half = bounds[i] < taps[j].split ? dst[j].first : dst[j].second;
+					half += std::complex<UnderlyingType>(re[j], im[j]);
+				}
+			}
+		}
+
+		template <bool wipe_off, std::size_t taps_count = max_taps_per_pass, typename UnderlyingType, typename T>
+		static void DispatchPass(std::span<const std::complex<UnderlyingType>> signal, std::span<const T> code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst, const Carrier& carrier) {
+			if (taps.size() == taps_count)
+				ProcessPass<taps_count, wipe_off>(signal, code, taps, dst, carrier);
+			else if constexpr (taps_count > 1)
+				DispatchPass<wipe_off, taps_count - 1>(signal, code, taps, dst, carrier);
+		}
+
+		template <bool wipe_off, typename UnderlyingType, typename T>
+		static void ProcessAllPasses(std::span<const std::complex<UnderlyingType>> signal, std::span<const T> code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst, const Carrier& carrier) {
+			std::fill(dst.begin(), dst.end(), SplitCorrelation<UnderlyingType>{});
+
+			for (std::size_t i = 0; i < taps.size(); i += max_taps_per_pass) {
+				const auto taps_in_pass = std::min(max_taps_per_pass, taps.size() - i);
+				DispatchPass<wipe_off>(signal, code, taps.subspan(i, taps_in_pass), dst.subspan(i, taps_in_pass), carrier);
+			}
+		}
+
+	protected:
+		friend class Correlator<FusedCorrelator>;
+
+		template <typename UnderlyingType, typename T>
+		[[nodiscard]]
+		static auto Process(const std::span<const std::complex<UnderlyingType>>& signal, const std::span<const T>& code) {
+			if (signal.size() != code.size())
+				throw std::runtime_error("Size mismatch");
+
+			return std::inner_product(signal.begin(), signal.end(), code.begin(), std::complex<UnderlyingType>{});
+		}
+
+		template <typename UnderlyingType, typename T>
+		static void ProcessMultiple(std::span<const std::complex<UnderlyingType>> signal, std::span<const T> code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst) {
+			ProcessAllPasses<false>(signal, code, taps, dst, Carrier{});
+		}
+
+	public:
+		// same as CorrelateMultiple for the signal multiplied by the carrier, without materializing the translated signal
+		template <typename UnderlyingType, typename T>
+		static void CorrelateMultipleWithCarrier(std::span<const std::complex<UnderlyingType>> signal, std::span<const T> code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst, const Carrier& carrier) {
+			CheckTaps(signal.size(), code.size(), taps, dst.size());
+			ProcessAllPasses<true>(signal, code, taps, dst, carrier);
+		}
+	};
+}
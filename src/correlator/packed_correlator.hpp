@@ -0,0 +1,219 @@
+#pragma once
+
+#include "correlator.hpp"
+#include "../prn_codes/packed_code.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace ugsdr {
+	// Correlates the bit-packed code with the quantized signal: the carrier is wiped off and the signal is quantized
+	// to the sign (and magnitude) bit planes once per call, then every tap costs an XOR and a popcount per 64 samples.
+	// The quantization loses about 2 dB of SNR with 1 bit and 0.5 dB with 2 bits, the latter matches the 2-bit front ends
+	template <std::size_t bits = 2>
+	class PackedCorrelatorBase : public Correlator<PackedCorrelatorBase<bits>> {
+		static_assert(bits == 1 || bits == 2, "Only the sign and sign-magnitude quantization is supported");
+
+		using BaseType = Correlator<PackedCorrelatorBase<bits>>;
+		using WordType = PackedCode::WordType;
+		constexpr static inline auto word_bits = PackedCode::word_bits;
+
+	public:
+		using CodeType = PackedCode;
+
+		// carrier replica exp(j * (phase + phase_step * n)), same as FusedCorrelator::Carrier
+		struct Carrier {
+			double phase = 0.0;
+			double phase_step = 0.0;
+		};
+
+	private:
+		// levels are +-1 (and +-3 beyond the magnitude threshold) in the units of the scale: sigma for the sign and sigma / 2
+		// for the sign-magnitude quantization, close to the conditional means of the noise within the levels
+		struct QuantizedSignal {
+			std::vector<WordType> re_signs;
+			std::vector<WordType> im_signs;
+			std::vector<WordType> re_magnitudes;
+			std::vector<WordType> im_magnitudes;
+			double scale = 0.0;
+		};
+
+		// the carrier of every lane is rotated by lanes samples per step, see FusedCorrelator
+		constexpr static inline std::size_t lanes = 8;
+
+		template <typename UnderlyingType>
+		static void Quantize(std::span<const std::complex<UnderlyingType>> signal, const Carrier& carrier, QuantizedSignal& dst) {
+			// the power doesn't depend on the carrier, so the levels are known before the wipe-off. The signal is below
+			// the noise, the optimal 2-bit threshold is close to the noise sigma
+			const auto signal_ptr = reinterpret_cast<const UnderlyingType*>(signal.data());
+			std::array<UnderlyingType, 2 * lanes> partial_power{};
+			auto i = std::size_t{ 0 };
+			for (; i + 2 * lanes <= 2 * signal.size(); i += 2 * lanes)
+				for (std::size_t k = 0; k < 2 * lanes; ++k)
+					partial_power[k] += signal_ptr[i + k] * signal_ptr[i + k];
+			for (; i < 2 * signal.size(); ++i)
+				partial_power[0] += signal_ptr[i] * signal_ptr[i];
+			const auto power = std::accumulate(partial_power.begin(), partial_power.end(), 0.0);
+			const auto sigma = std::sqrt(power / static_cast<double>(2 * std::max<std::size_t>(signal.size(), 1)));
+			const auto threshold = static_cast<UnderlyingType>(sigma);
+			dst.scale = bits == 1 ? sigma : sigma / 2;
+
+			const auto words = (signal.size() + word_bits - 1) / word_bits;
+			dst.re_signs.assign(words, 0);
+			dst.im_signs.assign(words, 0);
+			dst.re_magnitudes.assign(words, 0);
+			dst.im_magnitudes.assign(words, 0);
+
+			std::array<std::complex<double>, lanes> lane_offsets{};
+			for (std::size_t k = 0; k < lanes; ++k)
+				lane_offsets[k] = std::polar(1.0, carrier.phase_step * static_cast<double>(k));
+			const auto rotation = std::complex<UnderlyingType>(std::polar(1.0, carrier.phase_step * static_cast<double>(lanes)));
+			// the lanes restart from the word carrier, it's rotated in double precision and doesn't drift within the call
+			const auto word_rotation = std::polar(1.0, carrier.phase_step * static_cast<double>(word_bits));
+			auto word_carrier = std::polar(1.0, carrier.phase);
+
+			for (std::size_t word = 0; word < words; ++word) {
+				const auto begin = word * word_bits;
+				const auto end = std::min(begin + word_bits, signal.size());
+
+				// the last word is padded with zeros, the correlation masks them
+				auto word_ptr = signal_ptr + 2 * begin;
+				std::array<UnderlyingType, 2 * word_bits> padded_word;
+				if (end - begin < word_bits) {
+					padded_word.fill(0);
+					std::copy(word_ptr, word_ptr + 2 * (end - begin), padded_word.begin());
+					word_ptr = padded_word.data();
+				}
+
+				std::array<UnderlyingType, lanes> carrier_re{};
+				std::array<UnderlyingType, lanes> carrier_im{};
+				for (std::size_t k = 0; k < lanes; ++k) {
+					const auto lane_carrier = word_carrier * lane_offsets[k];
+					carrier_re[k] = static_cast<UnderlyingType>(lane_carrier.real());
+					carrier_im[k] = static_cast<UnderlyingType>(lane_carrier.imag());
+				}
+				word_carrier *= word_rotation;
+
+				// wipe-off and the packing are separate loops, each of them is vectorized
+				std::array<UnderlyingType, word_bits> wiped_off_re;
+				std::array<UnderlyingType, word_bits> wiped_off_im;
+				for (std::size_t i = 0; i < word_bits; i += lanes) {
+					for (std::size_t k = 0; k < lanes; ++k) {
+						const auto sample_re = word_ptr[2 * (i + k)];
+						const auto sample_im = word_ptr[2 * (i + k) + 1];
+						wiped_off_re[i + k] = sample_re * carrier_re[k] - sample_im * carrier_im[k];
+						wiped_off_im[i + k] = sample_re * carrier_im[k] + sample_im * carrier_re[k];
+
+						const auto rotated_re = carrier_re[k] * rotation.real() - carrier_im[k] * rotation.imag();
+						carrier_im[k] = carrier_re[k] * rotation.imag() + carrier_im[k] * rotation.real();
+						carrier_re[k] = rotated_re;
+					}
+				}
+
+				WordType re_signs = 0, im_signs = 0, re_magnitudes = 0, im_magnitudes = 0;
+				for (std::size_t i = 0; i < word_bits; ++i) {
+					re_signs |= static_cast<WordType>(wiped_off_re[i] < 0) << i;
+					im_signs |= static_cast<WordType>(wiped_off_im[i] < 0) << i;
+				}
+				if constexpr (bits == 2) {
+					for (std::size_t i = 0; i < word_bits; ++i) {
+						re_magnitudes |= static_cast<WordType>(std::abs(wiped_off_re[i]) > threshold) << i;
+						im_magnitudes |= static_cast<WordType>(std::abs(wiped_off_im[i]) > threshold) << i;
+					}
+				}
+				dst.re_signs[word] = re_signs;
+				dst.im_signs[word] = im_signs;
+				dst.re_magnitudes[word] = re_magnitudes;
+				dst.im_magnitudes[word] = im_magnitudes;
+			}
+		}
+
+		// sum of the products of the masked samples, the product is negative where the sign bits differ
+		static auto Accumulate(WordType differences, WordType magnitudes, WordType mask) {
+			auto sum = [differences](WordType current_mask) {
+				return static_cast<std::int64_t>(std::popcount(current_mask)) - 2 * static_cast<std::int64_t>(std::popcount(differences & current_mask));
+			};
+			if constexpr (bits == 1)
+				return sum(mask);
+			else
+				return sum(mask & ~magnitudes) + 3 * sum(mask & magnitudes);
+		}
+
+		static auto GetLowMask(std::size_t count) {
+			return count >= word_bits ? ~WordType{ 0 } : (WordType{ 1 } << count) - 1;
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessAllTaps(std::span<const std::complex<UnderlyingType>> signal, const PackedCode& code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst, const Carrier& carrier) {
+			static thread_local QuantizedSignal quantized_signal;
+			Quantize(signal, carrier, quantized_signal);
+
+			for (std::size_t i = 0; i < taps.size(); ++i) {
+				std::int64_t first_re = 0, first_im = 0, second_re = 0, second_im = 0;
+				for (std::size_t word = 0; word < quantized_signal.re_signs.size(); ++word) {
+					const auto begin = word * word_bits;
+					const auto valid = GetLowMask(signal.size() - begin) & code.GetNonZero(taps[i].code_offset + begin);
+					const auto first_half = taps[i].split > begin ? GetLowMask(taps[i].split - begin) : WordType{ 0 };
+					const auto code_signs = code.GetSigns(taps[i].code_offset + begin);
+
+					const auto re_differences = quantized_signal.re_signs[word] ^ code_signs;
+					const auto im_differences = quantized_signal.im_signs[word] ^ code_signs;
+					first_re += Accumulate(re_differences, quantized_signal.re_magnitudes[word], valid & first_half);
+					first_im += Accumulate(im_differences, quantized_signal.im_magnitudes[word], valid & first_half);
+					second_re += Accumulate(re_differences, quantized_signal.re_magnitudes[word], valid & ~first_half);
+					second_im += Accumulate(im_differences, quantized_signal.im_magnitudes[word], valid & ~first_half);
+				}
+
+				const auto scale = quantized_signal.scale;
+				dst[i].first = std::complex<UnderlyingType>(static_cast<UnderlyingType>(scale * static_cast<double>(first_re)),
+					static_cast<UnderlyingType>(scale * static_cast<double>(first_im)));
+				dst[i].second = std::complex<UnderlyingType>(static_cast<UnderlyingType>(scale * static_cast<double>(second_re)),
+					static_cast<UnderlyingType>(scale * static_cast<double>(second_im)));
+			}
+		}
+
+	protected:
+		friend class Correlator<PackedCorrelatorBase<bits>>;
+
+		// the unpacked codes are correlated without the quantization
+		template <typename UnderlyingType, typename T>
+		[[nodiscard]]
+		static auto Process(const std::span<const std::complex<UnderlyingType>>& signal, const std::span<const T>& code) {
+			if (signal.size() != code.size())
+				throw std::runtime_error("Size mismatch");
+
+			return std::inner_product(signal.begin(), signal.end(), code.begin(), std::complex<UnderlyingType>{});
+		}
+
+	public:
+		using BaseType::CorrelateMultiple;
+
+		template <typename UnderlyingType>
+		static void CorrelateMultiple(std::span<const std::complex<UnderlyingType>> signal, const PackedCode& code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst) {
+			BaseType::CheckTaps(signal.size(), code.size(), taps, dst.size());
+			ProcessAllTaps(signal, code, taps, dst, Carrier{});
+		}
+
+		// same as CorrelateMultiple for the signal multiplied by the carrier, the wipe-off precedes the quantization
+		template <typename UnderlyingType>
+		static void CorrelateMultipleWithCarrier(std::span<const std::complex<UnderlyingType>> signal, const PackedCode& code,
+			std::span<const CorrelatorTap> taps, std::span<SplitCorrelation<UnderlyingType>> dst, const Carrier& carrier) {
+			BaseType::CheckTaps(signal.size(), code.size(), taps, dst.size());
+			ProcessAllTaps(signal, code, taps, dst, carrier);
+		}
+	};
+
+	using PackedCorrelator = PackedCorrelatorBase<2>;
+	using SignCorrelator = PackedCorrelatorBase<1>;
+}
@@ -5,13 +5,20 @@
 #include "../mixer/ipp_mixer.hpp"
 #include "../resample/ipp_resampler.hpp"
 #include "../mixer/table_mixer.hpp"
+#include "../resample/polyphase_resampler.hpp"
 #include "../resample/resampler.hpp"
 #include "../antijamming/additional_signal_generator.hpp"
 #include "../antijamming/jse.hpp"
+#include "epoch_prefetcher.hpp"
+#include "fixed_point_frontend.hpp"
 
 #include <algorithm>
+#include <array>
 #include <execution>
-#include <map>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 namespace ugsdr {
@@ -20,13 +27,22 @@ namespace ugsdr {
 		Enabled
 	};
 
+	// fixed point channels decode, mix and decimate the samples in the integer domain when the decimation ratio is integer,
+	// otherwise they fall back to the floating point mixer and resampler
+	enum class FrontendPrecision {
+		FloatingPoint,
+		FixedPoint
+	};
+
 	template <
 		InterferenceMitigation MitigationState,
 		typename MixerT,
-		typename ResamplerT
+		typename ResamplerT,
+		FrontendPrecision Precision = FrontendPrecision::FloatingPoint
 	>
 	struct ChannelConfig {
 		constexpr static inline auto interference_mitigation = MitigationState;
+		constexpr static inline auto precision = Precision;
 		using MixerType = MixerT;
 		using ResamplerType = ResamplerT;
 
@@ -36,18 +52,23 @@ namespace ugsdr {
 		constexpr static bool IsMitigationEnabled() {
 			return MitigationState == InterferenceMitigation::Enabled;
 		}
+
+		constexpr static bool IsFixedPoint() {
+			return Precision == FrontendPrecision::FixedPoint;
+		}
 	};
 
-	template <InterferenceMitigation MitigationType>
+	template <InterferenceMitigation MitigationType, FrontendPrecision Precision = FrontendPrecision::FloatingPoint>
 	using ParametricChannelConfig = ChannelConfig <
 		MitigationType,
 #ifdef HAS_IPP
 		IppMixer,
-		IppResampler
+		IppResampler,
 #else
 		TableMixer,
-		SequentialResampler
+		PolyphaseResampler,
 #endif
+		Precision
 	>;
 
 	using DefaultChannelConfig = ParametricChannelConfig<InterferenceMitigation::Disabled>;
@@ -56,45 +77,72 @@ namespace ugsdr {
 	constexpr bool IsChannelConfig(T val) {
 		return false;
 	}
-	template <InterferenceMitigation interfernece_mitigation, typename ... Args>
-	constexpr bool IsChannelConfig(ChannelConfig<interfernece_mitigation, Args...> val) {
+	template <InterferenceMitigation interfernece_mitigation, typename MixerT, typename ResamplerT, FrontendPrecision precision>
+	constexpr bool IsChannelConfig(ChannelConfig<interfernece_mitigation, MixerT, ResamplerT, precision> val) {
 		return true;
 	}
 	template <typename T>
 	concept ChannelConfigConcept = IsChannelConfig(T{});
 
+	// Flat table of the subbands: every channel owns one preallocated buffer and the signals are mapped onto them
+	// by index, so the lookups are O(1) and the channels are able to fill their buffers concurrently
 	template <typename UnderlyingType>
 	struct SignalEpoch final {
 	private:
 		using VectorType = std::vector<std::complex<UnderlyingType>>;
-		
-		std::map<Signal, std::size_t> signal_map;
-		std::map<std::size_t, VectorType> epoch_data;
+
+		constexpr static inline std::size_t signals_count = static_cast<std::size_t>(Signal::Qzss_L5Q) + 1;
+		constexpr static inline std::size_t no_subband = std::numeric_limits<std::size_t>::max();
+		constexpr static inline std::size_t cache_line_size = 64;
+
+		// buffer headers of the different channels don't share a cache line
+		struct alignas(cache_line_size) Subband {
+			VectorType data;
+		};
+
+		std::array<std::size_t, signals_count> subband_indices = MakeSubbandIndices();
+		std::vector<Subband> subbands;
+
+		static constexpr auto MakeSubbandIndices() {
+			std::array<std::size_t, signals_count> dst{};
+			dst.fill(no_subband);
+			return dst;
+		}
+
+		auto GetSubbandIndex(Signal signal_type) const {
+			const auto signal_index = static_cast<std::size_t>(signal_type);
+			if (signal_index >= signals_count || subband_indices[signal_index] == no_subband)
+				throw std::runtime_error("Epoch doesn't contain requested signal");
+
+			return subband_indices[signal_index];
+		}
 
 	public:
 		const auto& GetSubband(Signal signal_type) const {
-			return epoch_data.at(signal_map.at(signal_type));
+			return subbands[GetSubbandIndex(signal_type)].data;
 		}
 		
 		auto& GetSubband(Signal signal_type) {
-			auto it = signal_map.find(signal_type);
-			if (it == signal_map.end()) {
-				auto dst = signal_map.insert({ signal_type, signal_map.size() });
-				it = dst.first;
-			}
-			
-			return epoch_data[it->second];
+			return subbands[GetSubbandIndex(signal_type)].data;
+		}
+
+		bool HasSignal(Signal signal_type) const {
+			const auto signal_index = static_cast<std::size_t>(signal_type);
+			return signal_index < signals_count && subband_indices[signal_index] != no_subband;
+		}
+
+		bool empty() const {
+			return subbands.empty();
 		}
 
 		void Initialize(const std::vector<Signal>& signals, std::size_t sz) {
-			auto current_size = epoch_data.size();
+			const auto current_index = subbands.size();
 			for (auto& signal_type : signals) {
-				auto it = signal_map.find(signal_type);
-				if (it == signal_map.end()) {
-					signal_map.insert({ signal_type, current_size });
-				}
+				auto& subband_index = subband_indices[static_cast<std::size_t>(signal_type)];
+				if (subband_index == no_subband)
+					subband_index = current_index;
 			}
-			epoch_data.insert({ current_size, VectorType(sz, 0) });
+			subbands.push_back(Subband{ VectorType(sz, 0) });
 		}
 	};
 
@@ -112,6 +160,22 @@ namespace ugsdr {
 		typename Config::ResamplerType resampler;
 		JammingSuppressionEngine<std::complex<UnderlyingType>> jamming_suppressor;
 		AdditionalSignalGenerator<UnderlyingType>* signal_generator_ptr = nullptr;
+		FixedPointFrontend<UnderlyingType> fixed_point_frontend;
+		std::vector<std::complex<std::int16_t>> fixed_point_samples;
+		// real valued samples are mixed straight into the complex signal, without the zero imaginary part
+		bool is_real_input = false;
+		std::vector<UnderlyingType> real_input_block;
+
+		// the polyphase resampler is streamed: consecutive requests continue the filter state, the first epoch of
+		// any other one is computed from the preceding samples, so the result doesn't depend on the order of requests
+		constexpr static inline bool is_streaming = std::is_same_v<typename Config::ResamplerType, PolyphaseResampler>;
+		constexpr static inline std::size_t no_epoch = std::numeric_limits<std::size_t>::max();
+		MultistageResampler<std::complex<UnderlyingType>> streaming_resampler;
+		std::size_t next_output_epoch = no_epoch;
+		std::size_t next_input_epoch = 0;
+		std::vector<std::complex<UnderlyingType>> input_block;
+		std::vector<std::complex<UnderlyingType>> resampled_block;
+		std::vector<std::complex<UnderlyingType>> output_queue;
 
 		[[nodiscard]]
 		static auto CentralFrequency(Signal signal) {
@@ -174,6 +238,64 @@ namespace ugsdr {
 			return signal_params.GetCentralFrequency() - CentralFrequency(signal);
 		}
 
+		// reads epoch_cnt epochs zero padded up to padded_samples and mixes them. The real valued samples are promoted
+		// only if the additional signals have to be added to them
+		void ReadAndTranslate(std::size_t epoch_offset, std::size_t epoch_cnt, std::size_t padded_samples, std::vector<std::complex<UnderlyingType>>& dst) {
+			const auto samples_per_ms = static_cast<std::uint64_t>(signal_parameters.GetSamplingRate() / 1e3);
+			if (is_real_input && !signal_generator_ptr) {
+				real_input_block.clear();
+				if (epoch_cnt)
+					signal_parameters.GetSeveralMs(epoch_offset, epoch_cnt, real_input_block);
+				real_input_block.resize(padded_samples);
+				mixer.Translate(real_input_block, samples_per_ms * epoch_offset, dst);
+				return;
+			}
+
+			dst.clear();
+			if (epoch_cnt) {
+				signal_parameters.GetSeveralMs(epoch_offset, epoch_cnt, dst);
+				if (signal_generator_ptr)
+					signal_generator_ptr->AddSignal(dst);
+			}
+			dst.resize(padded_samples);
+			mixer.Translate(dst, samples_per_ms * epoch_offset);
+		}
+
+		// mixes and resamples the input up to the lookahead of the filters, the outputs past the requested epochs
+		// are kept for the next request
+		void GetStreamingEpochs(std::size_t epoch_offset, std::size_t epoch_cnt, std::vector<std::complex<UnderlyingType>>& dst) {
+			const auto input_samples_per_ms = static_cast<std::size_t>(signal_parameters.GetSamplingRate() / 1e3);
+			const auto output_samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
+			if (epoch_offset + epoch_cnt > GetNumberOfEpochs())
+				throw std::runtime_error("Exceeding epoch requested");
+
+			if (epoch_offset != next_output_epoch) {
+				const auto first_output = static_cast<std::uint64_t>(epoch_offset * output_samples_per_ms);
+				next_input_epoch = static_cast<std::size_t>(streaming_resampler.GetFirstInput(first_output) / input_samples_per_ms);
+				streaming_resampler.Seek(first_output, static_cast<std::uint64_t>(next_input_epoch * input_samples_per_ms));
+				output_queue.clear();
+			}
+
+			const auto lookahead_epochs = (streaming_resampler.GetLookahead() + input_samples_per_ms - 1) / input_samples_per_ms;
+			const auto end_input_epoch = epoch_offset + epoch_cnt + lookahead_epochs;
+			if (next_input_epoch < end_input_epoch) {
+				const auto end_recorded_epoch = std::min(end_input_epoch, GetNumberOfEpochs());
+				// the filters are flushed with zeros past the end of the record
+				const auto recorded_epochs = next_input_epoch < end_recorded_epoch ? end_recorded_epoch - next_input_epoch : 0;
+				ReadAndTranslate(next_input_epoch, recorded_epochs, (end_input_epoch - next_input_epoch) * input_samples_per_ms, input_block);
+				streaming_resampler.Process(input_block, resampled_block);
+				output_queue.insert(output_queue.end(), resampled_block.begin(), resampled_block.end());
+				next_input_epoch = end_input_epoch;
+			}
+
+			const auto output_samples = epoch_cnt * output_samples_per_ms;
+			if (output_queue.size() < output_samples)
+				throw std::runtime_error("Resampler didn't produce the requested epochs");
+			dst.assign(output_queue.begin(), output_queue.begin() + static_cast<std::ptrdiff_t>(output_samples));
+			output_queue.erase(output_queue.begin(), output_queue.begin() + static_cast<std::ptrdiff_t>(output_samples));
+			next_output_epoch = epoch_offset + epoch_cnt;
+		}
+
 	public:
 		Channel(SignalParametersBase<UnderlyingType>& signal_params, Signal signal, double new_sampling_rate, 
 			AdditionalSignalGenerator<UnderlyingType>* generator_ptr = nullptr) : Channel(signal_params, std::vector{signal}, new_sampling_rate, generator_ptr) {}
@@ -183,7 +305,15 @@ namespace ugsdr {
 			subbands(signals.begin(), signals.end()), sampling_rate(new_sampling_rate), central_frequency(CentralFrequency(signals)), 
 			spectrum_inversion((signal_params.GetCentralFrequency() - central_frequency) > 1),	// to avoid -0.0
 			signal_parameters(signal_params), mixer(signal_parameters.GetSamplingRate(), signal_parameters.GetCentralFrequency() - central_frequency, 0),
-			jamming_suppressor(new_sampling_rate), signal_generator_ptr(generator_ptr) {}
+			jamming_suppressor(new_sampling_rate), signal_generator_ptr(generator_ptr) {
+			is_real_input = signal_parameters.IsDataReal();
+			if constexpr (Config::IsFixedPoint())
+				fixed_point_frontend = FixedPointFrontend<UnderlyingType>(signal_parameters.GetSamplingRate(), signal_parameters.GetCentralFrequency() - central_frequency,
+					sampling_rate, signal_parameters.GetSampleBits());
+			if constexpr (is_streaming)
+				streaming_resampler = MultistageResampler<std::complex<UnderlyingType>>(static_cast<std::size_t>(sampling_rate),
+					static_cast<std::size_t>(signal_parameters.GetSamplingRate()));
+		}
 		
 		auto GetNumberOfEpochs() const {
 			return signal_parameters.GetNumberOfEpochs();
@@ -191,13 +321,25 @@ namespace ugsdr {
 				
 		void GetSeveralEpochs(std::size_t epoch_offset, std::size_t epoch_cnt, SignalEpoch<UnderlyingType>& epoch_data) {
 			auto& current_vector = epoch_data.GetSubband(subbands[0]);
-			signal_parameters.GetSeveralMs(epoch_offset, epoch_cnt, current_vector);
-
-			if (signal_generator_ptr)
-				signal_generator_ptr->AddSignal(current_vector);
+			if constexpr (Config::IsFixedPoint()) {
+				// the additional signals are generated in the floating point
+				if (fixed_point_frontend.IsSupported() && !signal_generator_ptr) {
+					signal_parameters.GetSeveralMs(epoch_offset, epoch_cnt, fixed_point_samples);
+					const auto samples_per_ms = static_cast<std::uint64_t>(signal_parameters.GetSamplingRate() / 1e3);
+					fixed_point_frontend.Process(fixed_point_samples, samples_per_ms * epoch_offset, current_vector);
+					if constexpr (Config::IsMitigationEnabled())
+						jamming_suppressor.Process(current_vector);
+					return;
+				}
+			}
 
-			mixer.Translate(current_vector);
-			resampler.Transform(current_vector, static_cast<std::size_t>(sampling_rate), static_cast<std::size_t>(signal_parameters.GetSamplingRate()));
+			if constexpr (is_streaming)
+				GetStreamingEpochs(epoch_offset, epoch_cnt, current_vector);
+			else {
+				const auto samples_per_ms = static_cast<std::size_t>(signal_parameters.GetSamplingRate() / 1e3);
+				ReadAndTranslate(epoch_offset, epoch_cnt, samples_per_ms * epoch_cnt, current_vector);
+				resampler.Transform(current_vector, static_cast<std::size_t>(sampling_rate), static_cast<std::size_t>(signal_parameters.GetSamplingRate()));
+			}
 			if constexpr (Config::IsMitigationEnabled())
 				jamming_suppressor.Process(current_vector);
 		}
@@ -214,7 +356,10 @@ namespace ugsdr {
 	template <ChannelConfigConcept Config = DefaultChannelConfig, typename UnderlyingType = float>
 	class DigitalFrontend final {		
 	public:
-		DigitalFrontend(std::vector<Channel<Config, UnderlyingType>> input_channels) : channels(std::move(input_channels)) {}
+		DigitalFrontend(std::vector<Channel<Config, UnderlyingType>> input_channels) : channels(std::move(input_channels)) {
+			for (auto& el : channels)
+				signal_epoch.Initialize(el.subbands, static_cast<std::size_t>(el.sampling_rate / 1e3));
+		}
 
 		DigitalFrontend(Channel<Config, UnderlyingType> channel) {
 			channels.push_back(channel);
@@ -228,6 +373,28 @@ namespace ugsdr {
 			signal_epoch.Initialize(channels.back().subbands, static_cast<std::size_t>(channels.back().sampling_rate / 1e3));
 		}
 
+		// the producer thread reads through this, so the prefetching of both front ends is stopped before the move
+		DigitalFrontend(DigitalFrontend&& rhs) noexcept {
+			rhs.StopPrefetch();
+			channels = std::move(rhs.channels);
+			signal_epoch = std::move(rhs.signal_epoch);
+			current_epoch = rhs.current_epoch;
+			prefetch_depth = rhs.prefetch_depth;
+		}
+
+		DigitalFrontend& operator=(DigitalFrontend&& rhs) noexcept {
+			if (this == &rhs)
+				return *this;
+
+			StopPrefetch();
+			rhs.StopPrefetch();
+			channels = std::move(rhs.channels);
+			signal_epoch = std::move(rhs.signal_epoch);
+			current_epoch = rhs.current_epoch;
+			prefetch_depth = rhs.prefetch_depth;
+			return *this;
+		}
+
 		bool HasSignal(Signal signal) const {
 			auto it = GetChannelIt(signal);
 
@@ -235,9 +402,23 @@ namespace ugsdr {
 		}
 		
 		auto& GetSeveralEpochs(std::size_t epoch_offset, std::size_t epoch_cnt) {
-			std::for_each(std::execution::par_unseq, channels.begin(), channels.end(), [epoch_offset, epoch_cnt, this](Channel<Config, UnderlyingType>& channel) {
-				channel.GetSeveralEpochs(epoch_offset, epoch_cnt, signal_epoch);
-			});
+			if (prefetcher && epoch_cnt == 1) {
+				if (prefetcher->Get(epoch_offset, signal_epoch))
+					return signal_epoch;
+
+				// out of order request, the producer is restarted right after the requested epoch
+				const auto end_epoch = prefetcher->GetEndEpoch();
+				StopPrefetch();
+				ReadEpochs(epoch_offset, epoch_cnt, signal_epoch);
+				if (epoch_offset + 1 < end_epoch)
+					StartPrefetch(epoch_offset + 1, end_epoch - epoch_offset - 1, prefetch_depth);
+
+				return signal_epoch;
+			}
+
+			// channels are stateful, so they can't be read concurrently with the producer
+			StopPrefetch();
+			ReadEpochs(epoch_offset, epoch_cnt, signal_epoch);
 
 			return signal_epoch;
 		}
@@ -246,6 +427,31 @@ namespace ugsdr {
 			return GetSeveralEpochs(epoch_offset, 1);
 		}
 
+		// same as above without the copy: the epoch is swapped into dst and the previous content of dst is recycled
+		// by the front end, dst gets the layout of the epochs on the first call
+		void GetEpoch(std::size_t epoch_offset, SignalEpoch<UnderlyingType>& dst) {
+			if (dst.empty())
+				dst = signal_epoch;
+			std::swap(GetEpoch(epoch_offset), dst);
+		}
+
+		// Front end processing of the next epochs_count epochs runs in the background, while the consumer
+		// takes them with GetEpoch in order. Any other request stops or restarts the prefetching
+		void StartPrefetch(std::size_t first_epoch, std::size_t epochs_count, std::size_t depth = default_prefetch_depth) {
+			StopPrefetch();
+			if (epochs_count == 0)
+				return;
+
+			prefetch_depth = depth;
+			prefetcher = std::make_unique<EpochPrefetcher<SignalEpoch<UnderlyingType>>>([this](std::size_t epoch, SignalEpoch<UnderlyingType>& dst) {
+				ReadEpochs(epoch, 1, dst);
+			}, signal_epoch, first_epoch, epochs_count, depth);
+		}
+
+		void StopPrefetch() {
+			prefetcher.reset();
+		}
+
 		auto GetSamplingRate(Signal signal) const {
 			auto it = GetChannel(signal);
 			return it->sampling_rate;
@@ -279,6 +485,16 @@ namespace ugsdr {
 		SignalEpoch<UnderlyingType> signal_epoch;
 		std::size_t current_epoch = 0;
 
+		constexpr static inline std::size_t default_prefetch_depth = 4;
+		std::size_t prefetch_depth = default_prefetch_depth;
+		std::unique_ptr<EpochPrefetcher<SignalEpoch<UnderlyingType>>> prefetcher;
+
+		void ReadEpochs(std::size_t epoch_offset, std::size_t epoch_cnt, SignalEpoch<UnderlyingType>& dst) {
+			std::for_each(std::execution::par_unseq, channels.begin(), channels.end(), [epoch_offset, epoch_cnt, &dst](Channel<Config, UnderlyingType>& channel) {
+				channel.GetSeveralEpochs(epoch_offset, epoch_cnt, dst);
+			});
+		}
+
 		auto GetChannelIt(Signal signal) const {
 			return std::find_if(channels.begin(), channels.end(), [signal](auto& el) {
 				return std::find_if(el.subbands.begin(), el.subbands.end(), [signal](auto& subband) {
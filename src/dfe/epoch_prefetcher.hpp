@@ -0,0 +1,120 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ugsdr {
+	// Background producer of the consecutive epochs. A fixed pool of the buffers circulates between the producer
+	// and the consumer: ready buffers are swapped with the consumer's one, so the epochs are never allocated
+	template <typename EpochType>
+	class EpochPrefetcher final {
+	public:
+		using ProducerType = std::function<void(std::size_t, EpochType&)>;
+
+	private:
+		ProducerType producer;
+		std::vector<EpochType> buffers;
+		std::vector<EpochType*> free_buffers;
+		std::deque<std::pair<std::size_t, EpochType*>> ready_buffers;
+
+		std::size_t next_epoch = 0;
+		std::size_t end_epoch = 0;
+		std::size_t epochs_in_flight = 0;
+		bool stop = false;
+		std::exception_ptr producer_error;
+
+		std::mutex m;
+		std::condition_variable cv;
+		std::thread producer_thread;
+
+		void Produce() {
+			while (true) {
+				auto lock = std::unique_lock(m);
+				cv.wait(lock, [this] { return stop || !free_buffers.empty(); });
+				if (stop || next_epoch == end_epoch)
+					return;
+
+				auto buffer = free_buffers.back();
+				free_buffers.pop_back();
+				const auto epoch = next_epoch++;
+				++epochs_in_flight;
+				lock.unlock();
+
+				try {
+					producer(epoch, *buffer);
+				}
+				catch (...) {
+					lock.lock();
+					producer_error = std::current_exception();
+					cv.notify_all();
+					return;
+				}
+
+				lock.lock();
+				--epochs_in_flight;
+				ready_buffers.emplace_back(epoch, buffer);
+				cv.notify_all();
+			}
+		}
+
+	public:
+		// depth buffers are copied from the prototype, so they already have the required subbands and sizes
+		EpochPrefetcher(ProducerType producer_fn, const EpochType& prototype, std::size_t first_epoch, std::size_t epochs_count, std::size_t depth) :
+			producer(std::move(producer_fn)), buffers(depth, prototype), next_epoch(first_epoch), end_epoch(first_epoch + epochs_count) {
+			if (depth == 0)
+				throw std::runtime_error("Prefetch depth can't be zero");
+
+			for (auto& el : buffers)
+				free_buffers.push_back(&el);
+			producer_thread = std::thread(&EpochPrefetcher::Produce, this);
+		}
+
+		EpochPrefetcher(const EpochPrefetcher&) = delete;
+		EpochPrefetcher& operator=(const EpochPrefetcher&) = delete;
+
+		~EpochPrefetcher() {
+			{
+				auto lock = std::unique_lock(m);
+				stop = true;
+			}
+			cv.notify_all();
+			if (producer_thread.joinable())
+				producer_thread.join();
+		}
+
+		// swaps the epoch into dst and recycles the previous content of dst, returns false if epoch isn't the next one in the queue
+		bool Get(std::size_t epoch, EpochType& dst) {
+			auto lock = std::unique_lock(m);
+			cv.wait(lock, [this] { return !ready_buffers.empty() || producer_error || (next_epoch == end_epoch && epochs_in_flight == 0); });
+			if (ready_buffers.empty()) {
+				if (producer_error)
+					std::rethrow_exception(producer_error);
+				return false;
+			}
+
+			auto [ready_epoch, buffer] = ready_buffers.front();
+			if (ready_epoch != epoch)
+				return false;
+
+			ready_buffers.pop_front();
+			std::swap(*buffer, dst);
+			free_buffers.push_back(buffer);
+			cv.notify_all();
+			return true;
+		}
+
+		auto GetEndEpoch() const {
+			return end_epoch;
+		}
+	};
+}
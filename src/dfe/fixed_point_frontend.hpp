@@ -0,0 +1,103 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../mixer/nco.hpp"
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <vector>
+
+namespace ugsdr {
+	// Integer domain front end: the decoded integer samples are mixed with the integer carrier and integrated and
+	// dumped to the output rate in a single pass. Nothing is stored at the input rate except the 16-bit samples,
+	// the floating point conversion happens once per output sample
+	template <typename UnderlyingType>
+	class FixedPointFrontend final {
+	private:
+		constexpr static inline std::size_t nco_bits = 32;
+		constexpr static inline std::size_t max_carrier_bits = 14;
+		constexpr static inline std::size_t min_carrier_bits = 8;
+		// magnitude bits of the int32 sums, minus one for re * re - im * im
+		constexpr static inline std::size_t accumulator_bits = 30;
+
+		std::uint64_t adder = 0;
+		std::size_t samples_per_ms = 0;
+		std::size_t decimation_ratio = 0;
+		double carrier_scale = 0.0;
+		// carrier of the first millisecond with the zero initial phase, the other ones differ only by the rotation
+		// that is applied to the integrated samples
+		std::vector<std::complex<std::int16_t>> carrier;
+
+		auto GetRotation(std::uint64_t sample) const {
+			const auto phase = static_cast<double>(static_cast<std::uint32_t>(adder * sample)) / static_cast<double>(1ull << nco_bits);
+			return std::polar(1.0 / (carrier_scale * static_cast<double>(decimation_ratio)), 2 * std::numbers::pi * phase);
+		}
+
+	public:
+		FixedPointFrontend() = default;
+		// sample_bits is the width of the decoded samples including the sign, the carrier is as precise as the 32-bit
+		// accumulators allow: sum of decimation_ratio (re * re - im * im) products doesn't overflow
+		FixedPointFrontend(double sampling_rate, double frequency, double output_sampling_rate, std::size_t sample_bits) :
+			samples_per_ms(static_cast<std::size_t>(sampling_rate / 1e3)) {
+			if (frequency < 0)
+				frequency += sampling_rate;
+			adder = NumericallyControlledOscillator<nco_bits>(sampling_rate, frequency, 0).adder;
+
+			const auto ratio = sampling_rate / output_sampling_rate;
+			if (ratio < 1 || std::round(ratio) != ratio || samples_per_ms % static_cast<std::size_t>(ratio))
+				return;
+			decimation_ratio = static_cast<std::size_t>(ratio);
+
+			const auto ratio_bits = static_cast<std::size_t>(std::ceil(std::log2(ratio)));
+			if (sample_bits + ratio_bits + min_carrier_bits > accumulator_bits) {
+				decimation_ratio = 0;
+				return;
+			}
+			carrier_scale = static_cast<double>(1 << std::min(max_carrier_bits, accumulator_bits - sample_bits - ratio_bits));
+
+			carrier.resize(samples_per_ms);
+			for (std::size_t i = 0; i < carrier.size(); ++i) {
+				const auto phase = 2 * std::numbers::pi * static_cast<double>(static_cast<std::uint32_t>(adder * i)) / static_cast<double>(1ull << nco_bits);
+				carrier[i] = std::complex<std::int16_t>(static_cast<std::int16_t>(std::round(carrier_scale * std::cos(phase))),
+					static_cast<std::int16_t>(std::round(carrier_scale * std::sin(phase))));
+			}
+		}
+
+		// only the integer decimation within a millisecond is performed by the integrate-and-dump, provided the sums fit
+		bool IsSupported() const {
+			return decimation_ratio != 0;
+		}
+
+		// the carrier phase is derived from the absolute sample index, so the epochs may be processed in any order
+		void Process(std::span<const std::complex<std::int16_t>> src, std::uint64_t first_sample, std::vector<std::complex<UnderlyingType>>& dst) const {
+			const auto outputs_per_ms = samples_per_ms / decimation_ratio;
+			CheckResize(dst, src.size() / samples_per_ms * outputs_per_ms);
+
+			for (std::size_t ms = 0; ms < src.size() / samples_per_ms; ++ms) {
+				const auto rotation = std::complex<UnderlyingType>(GetRotation(first_sample + ms * samples_per_ms));
+				const auto ms_samples = src.data() + ms * samples_per_ms;
+				const auto ms_dst = dst.data() + ms * outputs_per_ms;
+				for (std::size_t i = 0; i < outputs_per_ms; ++i) {
+					std::int32_t re = 0;
+					std::int32_t im = 0;
+					for (std::size_t j = i * decimation_ratio; j < (i + 1) * decimation_ratio; ++j) {
+						const auto sample_re = static_cast<std::int32_t>(ms_samples[j].real());
+						const auto sample_im = static_cast<std::int32_t>(ms_samples[j].imag());
+						const auto carrier_re = static_cast<std::int32_t>(carrier[j].real());
+						const auto carrier_im = static_cast<std::int32_t>(carrier[j].imag());
+						re += sample_re * carrier_re - sample_im * carrier_im;
+						im += sample_re * carrier_im + sample_im * carrier_re;
+					}
+					// explicit product, std::complex multiplication handles inf/nan and isn't vectorized
+					const auto integrated_re = static_cast<UnderlyingType>(re);
+					const auto integrated_im = static_cast<UnderlyingType>(im);
+					ms_dst[i] = std::complex<UnderlyingType>(integrated_re * rotation.real() - integrated_im * rotation.imag(),
+						integrated_re * rotation.imag() + integrated_im * rotation.real());
+				}
+			}
+		}
+	};
+}
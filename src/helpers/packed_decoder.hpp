@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "is_complex.hpp"
+
+namespace ugsdr {
+	// Single pass decoders of the packed front end samples. There are no intrinsics, the loops are branchless
+	// so the compiler vectorizes them for any target (SSE/AVX/NEON)
+
+	// NT1065 grabber: one byte per sample, 4 channels with sign and magnitude bits, channel selected by the offset.
+	// The samples are real, complex destination gets the zero imaginary part
+	template <std::size_t offset, typename T>
+	void DecodeNtlabPacked(const std::byte* src, std::size_t samples, T* dst) {
+		static_assert(offset <= 6 && offset % 2 == 0, "Unexpected NT1065 channel offset");
+		using UnderlyingType = underlying_t<T>;
+		constexpr auto stride = is_complex_v<T> ? 2 : 1;
+
+		const auto src_ptr = reinterpret_cast<const std::uint8_t*>(src);
+		const auto dst_ptr = reinterpret_cast<UnderlyingType*>(dst);
+		for (std::size_t i = 0; i < samples; ++i) {
+			const auto sign = static_cast<int>((src_ptr[i] >> offset) & 0x1);
+			const auto magnitude = static_cast<int>((src_ptr[i] >> (offset + 1)) & 0x1);
+			dst_ptr[stride * i] = static_cast<UnderlyingType>((2 * sign - 1) * (1 + 2 * magnitude));
+			if constexpr (is_complex_v<T>)
+				dst_ptr[stride * i + 1] = static_cast<UnderlyingType>(0);
+		}
+	}
+
+	template <typename T>
+	void DecodeNtlabPacked(std::size_t offset, const std::byte* src, std::size_t samples, T* dst) {
+		switch (offset) {
+		case 0:
+			DecodeNtlabPacked<0>(src, samples, dst);
+			break;
+		case 2:
+			DecodeNtlabPacked<2>(src, samples, dst);
+			break;
+		case 4:
+			DecodeNtlabPacked<4>(src, samples, dst);
+			break;
+		case 6:
+			DecodeNtlabPacked<6>(src, samples, dst);
+			break;
+		default:
+			throw std::runtime_error("Unexpected NT1065 channel offset");
+		}
+	}
+
+	// BBP DDC: two complex samples per byte as signed 2-bit (im, re) fields, only the sign is meaningful.
+	// Every byte is looked up in a 256 entry table of the sample pairs
+	template <typename T>
+	void DecodeBbpPacked(const std::byte* src, std::size_t samples, std::complex<T>* dst) {
+		using PairType = std::array<std::complex<T>, 2>;
+		static const auto table = [] {
+			std::array<PairType, 256> dst{};
+			for (std::size_t i = 0; i < dst.size(); ++i) {
+				auto get_val = [i](std::size_t bit) {
+					return static_cast<T>(((i >> bit) & 0x1) ? -1 : 1);
+				};
+				dst[i] = PairType{ std::complex<T>(get_val(3), get_val(1)), std::complex<T>(get_val(7), get_val(5)) };
+			}
+			return dst;
+		}();
+
+		const auto src_ptr = reinterpret_cast<const std::uint8_t*>(src);
+		for (std::size_t i = 0; i < samples / 2; ++i)
+			std::memcpy(dst + 2 * i, table[src_ptr[i]].data(), sizeof(PairType));
+		if (samples % 2)
+			dst[samples - 1] = table[src_ptr[samples / 2]][0];
+	}
+}
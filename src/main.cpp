@@ -9,6 +9,8 @@
 #include "positioning/standalone_rtklib.hpp"
 
 #include <chrono>
+#include <cstdlib>
+#include <filesystem>
 
 #ifndef HAS_SIGNAL_PLOT
 void main_impl() {
@@ -69,8 +71,25 @@ void GenerateSignals(CSignalsViewer * sv) {
 }
 
 #ifndef HAS_SIGNAL_PLOT
-int main() {
+#ifdef HAS_FFTW
+// UGSDR_WISDOM overrides the default location next to the executable, so the runs from any directory share the wisdom
+static std::filesystem::path GetWisdomPath(const char* executable_path) {
+	if (auto path = std::getenv("UGSDR_WISDOM"))
+		return path;
+	return std::filesystem::absolute(executable_path).parent_path() / "ugsdr_wisdom";
+}
+#endif
+
+int main(int argc, char* argv[]) {
+#ifdef HAS_FFTW
+	// the measured plans of the previous runs
+	const auto wisdom_path = GetWisdomPath(argc > 0 ? argv[0] : "");
+	ugsdr::SequentialDft::ImportWisdom(wisdom_path);
+#endif
 	main_impl();
+#ifdef HAS_FFTW
+	ugsdr::SequentialDft::ExportWisdom(wisdom_path);
+#endif
 	return 0;
 }
 #endif
@@ -7,6 +7,8 @@
 #include "../helpers/ipp_complex_type_converter.hpp"
 #include "../math/af_dft.hpp"
 
+#include <span>
+
 namespace ugsdr {
 	class AfMatchedFilter : public MatchedFilter<AfMatchedFilter> {
 	private:
@@ -43,6 +45,50 @@ namespace ugsdr {
 			return ArrayProxy(af::conjg(ir_spectrum));
 		}
 
+		template <Container T>
+		[[nodiscard]]
+		static auto PrepareSignal(const T& signal) {
+			return ArrayProxy(DftImpl::Transform(signal));
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessShiftedBatch(const ArrayProxy& signal_spectrum, const ArrayProxy& code_spectrum,
+			std::span<const std::ptrdiff_t> bin_shifts, std::vector<std::complex<UnderlyingType>>& dst) {
+			const af::array& spectrum = signal_spectrum;
+			const af::array& code = code_spectrum;
+			auto batch = af::array(spectrum.elements(), static_cast<dim_t>(bin_shifts.size()), spectrum.type());
+			for (std::size_t i = 0; i < bin_shifts.size(); ++i)
+				batch(af::span, static_cast<int>(i)) = af::shift(spectrum, static_cast<int>(-bin_shifts[i])) * code;
+
+			af::ifftInPlace(batch);
+
+			auto batch_cpu_optional = ArrayProxy(af::flat(batch)).CopyFromGpu(dst);
+			if (batch_cpu_optional.has_value())
+				dst = std::move(batch_cpu_optional.value());
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessBatch(const ArrayProxy& signal_spectrum, std::span<const ArrayProxy* const> code_spectra,
+			std::vector<std::complex<UnderlyingType>>& dst) {
+			const af::array& spectrum = signal_spectrum;
+			if (code_spectra.empty()) {
+				dst.clear();
+				return;
+			}
+
+			// the codes are gathered into the columns, so the product is a single element-wise multiplication
+			auto batch = af::array(spectrum.elements(), static_cast<dim_t>(code_spectra.size()), spectrum.type());
+			for (std::size_t i = 0; i < code_spectra.size(); ++i)
+				batch(af::span, static_cast<int>(i)) = static_cast<const af::array&>(*code_spectra[i]);
+
+			batch *= af::tile(spectrum, 1, static_cast<unsigned>(code_spectra.size()));
+			af::ifftInPlace(batch);
+
+			auto batch_cpu_optional = ArrayProxy(af::flat(batch)).CopyFromGpu(dst);
+			if (batch_cpu_optional.has_value())
+				dst = std::move(batch_cpu_optional.value());
+		}
+
 		static void ProcessOptimized(ArrayProxy& src_dst, const ArrayProxy& impulse_response) {
 			DftImpl::Transform(src_dst);
 
@@ -8,6 +8,9 @@
 #include "../helpers/ipp_complex_type_converter.hpp"
 #include "../math/ipp_dft.hpp"
 
+#include <span>
+#include <stdexcept>
+
 namespace ugsdr {
 	class IppMatchedFilter : public MatchedFilter<IppMatchedFilter> {
 	private:
@@ -39,6 +42,15 @@ namespace ugsdr {
 			return mul_wrapper;
 		}
 		
+		[[nodiscard]]
+		static auto GetMulNotInPlaceWrapper() {
+			static auto mul_wrapper = plusifier::FunctionWrapper(
+				ippsMul_32fc, ippsMul_64fc
+			);
+
+			return mul_wrapper;
+		}
+
 		template <typename T>
 		static void MultiplyByConj(std::vector<std::complex<T>>& signal_spectrum, std::vector<std::complex<T>>& ir_spectrum) {
 			using IppType = typename IppTypeToComplex<T>::Type;
@@ -78,6 +90,54 @@ namespace ugsdr {
 			return ir_spectrum;
 		}
 
+		template <typename T>
+		[[nodiscard]]
+		static auto PrepareSignal(const std::vector<T>& signal) {
+			return DftImpl::Transform(signal);
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessShiftedBatch(const std::vector<std::complex<UnderlyingType>>& signal_spectrum, const std::vector<std::complex<UnderlyingType>>& code_spectrum,
+			std::span<const std::ptrdiff_t> bin_shifts, std::vector<std::complex<UnderlyingType>>& dst) {
+			const auto size = signal_spectrum.size();
+			CheckResize(dst, size * bin_shifts.size());
+
+			auto mul_wrapper = GetMulNotInPlaceWrapper();
+			using IppType = typename IppTypeToComplex<UnderlyingType>::Type;
+			auto signal_ptr = reinterpret_cast<const IppType*>(signal_spectrum.data());
+			auto code_ptr = reinterpret_cast<const IppType*>(code_spectrum.data());
+			for (std::size_t i = 0; i < bin_shifts.size(); ++i) {
+				auto shift = static_cast<std::size_t>((bin_shifts[i] % static_cast<std::ptrdiff_t>(size) + static_cast<std::ptrdiff_t>(size)) % static_cast<std::ptrdiff_t>(size));
+				auto row = reinterpret_cast<IppType*>(dst.data() + i * size);
+				mul_wrapper(signal_ptr + shift, code_ptr, row, static_cast<int>(size - shift));
+				if (shift != 0)
+					mul_wrapper(signal_ptr, code_ptr + (size - shift), row + (size - shift), static_cast<int>(shift));
+			}
+
+			DftImpl::TransformBatch(dst, size, true);
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessBatch(const std::vector<std::complex<UnderlyingType>>& signal_spectrum,
+			std::span<const std::vector<std::complex<UnderlyingType>>* const> code_spectra, std::vector<std::complex<UnderlyingType>>& dst) {
+			const auto size = signal_spectrum.size();
+			CheckResize(dst, size * code_spectra.size());
+
+			auto mul_wrapper = GetMulNotInPlaceWrapper();
+			using IppType = typename IppTypeToComplex<UnderlyingType>::Type;
+			auto signal_ptr = reinterpret_cast<const IppType*>(signal_spectrum.data());
+			for (std::size_t i = 0; i < code_spectra.size(); ++i) {
+				if (code_spectra[i]->size() != size)
+					throw std::runtime_error("Code spectrum size doesn't match the signal spectrum");
+
+				mul_wrapper(signal_ptr, reinterpret_cast<const IppType*>(code_spectra[i]->data()),
+					reinterpret_cast<IppType*>(dst.data() + i * size), static_cast<int>(size));
+			}
+
+			if (!dst.empty())
+				DftImpl::TransformBatch(dst, size, true);
+		}
+
 		template <typename UnderlyingType, typename T>
 		static void ProcessOptimized(std::vector<std::complex<UnderlyingType>>& src_dst, const T& impulse_response) {
 			DftImpl::Transform(src_dst);
@@ -92,7 +152,7 @@ namespace ugsdr {
 		template <typename UnderlyingType, typename T>
 		[[nodiscard]]
 		static auto ProcessOptimized(const std::vector<std::complex<UnderlyingType>>& src_dst, const T& impulse_response) {
-			const auto dst = src_dst;
+			auto dst = src_dst;
 			ProcessOptimized(dst, impulse_response);
 			return dst;
 		}
@@ -2,6 +2,10 @@
 
 #include <algorithm>
 #include <complex>
+#include <concepts>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 #include "../math/conj.hpp"
@@ -29,12 +33,34 @@ namespace ugsdr {
 			return FilterImpl::Prepare(impulse_response);
 		}
 
-		template <ComplexContainer T1, Container T2>
+		template <Container T>
+		static auto PrepareSignalSpectrum(const T& signal) {
+			return FilterImpl::PrepareSignal(signal);
+		}
+
+		// Row i of dst holds the matched filter output for the signal spectrum rotated left by bin_shifts[i] bins,
+		// i.e. the signal translated by -bin_shifts[i] * sampling_rate / size. All rows are inverse transformed in a single batch
+		template <Container T1, Container T2, typename UnderlyingType>
+		static void FilterShiftedBatch(const T1& signal_spectrum, const T2& code_spectrum, std::span<const std::ptrdiff_t> bin_shifts,
+			std::vector<std::complex<UnderlyingType>>& dst) {
+			FilterImpl::ProcessShiftedBatch(signal_spectrum, code_spectrum, bin_shifts, dst);
+		}
+
+		// Row i of dst holds the matched filter output of the signal for *code_spectra[i]: the single signal spectrum is
+		// multiplied by all the prepared code spectra and the rows are inverse transformed in a single batch
+		template <Container T, typename UnderlyingType>
+		static void FilterBatch(const T& signal_spectrum, std::span<const std::type_identity_t<T>* const> code_spectra,
+			std::vector<std::complex<UnderlyingType>>& dst) {
+			FilterImpl::ProcessBatch(signal_spectrum, code_spectra, dst);
+		}
+
+		// real signals are filtered through the half spectrum, if the implementation supports it
+		template <Container T1, Container T2>
 		static void FilterOptimized(T1& src_dst, const T2& impulse_response) {
 			FilterImpl::ProcessOptimized(src_dst, impulse_response);
 		}
 
-		template <ComplexContainer T1, Container T2>
+		template <Container T1, Container T2>
 		static auto FilterOptimized(const T1& src_dst, const T2& impulse_response) {
 			auto dst = src_dst;
 			FilterImpl::ProcessOptimized(dst, impulse_response);
@@ -46,13 +72,58 @@ namespace ugsdr {
 	protected:
 		friend class MatchedFilter<SequentialMatchedFilter>;
 
-		template <Container T>
+		template <typename T>
 		static auto Prepare(const std::vector<T>& impulse_response) {
 			auto ir_spectrum = SequentialDft::Transform(impulse_response);
 			SequentialConj::Transform(ir_spectrum);
 			return ir_spectrum;
 		}
 
+		template <typename T>
+		static auto PrepareSignal(const std::vector<T>& signal) {
+			return SequentialDft::Transform(signal);
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessShiftedBatch(const std::vector<std::complex<UnderlyingType>>& signal_spectrum, const std::vector<std::complex<UnderlyingType>>& code_spectrum,
+			std::span<const std::ptrdiff_t> bin_shifts, std::vector<std::complex<UnderlyingType>>& dst) {
+			const auto size = signal_spectrum.size();
+			CheckResize(dst, size * bin_shifts.size());
+
+			for (std::size_t i = 0; i < bin_shifts.size(); ++i) {
+				auto shift = static_cast<std::size_t>((bin_shifts[i] % static_cast<std::ptrdiff_t>(size) + static_cast<std::ptrdiff_t>(size)) % static_cast<std::ptrdiff_t>(size));
+				auto row = dst.begin() + i * size;
+				std::transform(signal_spectrum.begin() + shift, signal_spectrum.end(), code_spectrum.begin(), row, std::multiplies<std::complex<UnderlyingType>>{});
+				std::transform(signal_spectrum.begin(), signal_spectrum.begin() + shift, code_spectrum.begin() + (size - shift), row + (size - shift), std::multiplies<std::complex<UnderlyingType>>{});
+			}
+
+			SequentialDft::TransformBatch(dst, size, true);
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessBatch(const std::vector<std::complex<UnderlyingType>>& signal_spectrum,
+			std::span<const std::vector<std::complex<UnderlyingType>>* const> code_spectra, std::vector<std::complex<UnderlyingType>>& dst) {
+			const auto size = signal_spectrum.size();
+			CheckResize(dst, size * code_spectra.size());
+
+			// explicit products of the interleaved components, std::complex multiplication handles inf/nan and isn't vectorized
+			auto signal_ptr = reinterpret_cast<const UnderlyingType*>(signal_spectrum.data());
+			for (std::size_t i = 0; i < code_spectra.size(); ++i) {
+				if (code_spectra[i]->size() != size)
+					throw std::runtime_error("Code spectrum size doesn't match the signal spectrum");
+
+				auto code_ptr = reinterpret_cast<const UnderlyingType*>(code_spectra[i]->data());
+				auto row = reinterpret_cast<UnderlyingType*>(dst.data() + i * size);
+				for (std::size_t j = 0; j < size; ++j) {
+					row[2 * j] = signal_ptr[2 * j] * code_ptr[2 * j] - signal_ptr[2 * j + 1] * code_ptr[2 * j + 1];
+					row[2 * j + 1] = signal_ptr[2 * j] * code_ptr[2 * j + 1] + signal_ptr[2 * j + 1] * code_ptr[2 * j];
+				}
+			}
+
+			if (!dst.empty())
+				SequentialDft::TransformBatch(dst, size, true);
+		}
+
 		template <ComplexContainer T1, Container T2>
 		static auto ProcessOptimized(T1& src_dst, const T2& impulse_response) {
 			SequentialDft::Transform(src_dst);
@@ -60,6 +131,18 @@ namespace ugsdr {
 			SequentialDft::Transform(src_dst, true);
 		}
 
+		// Both the signal and the code are real, so the product of their spectra is Hermitian: only the half spectrum
+		// of the signal is computed (r2c) and multiplied, and the real correlation is restored by the c2r transform.
+		// The code spectrum is the prepared one, only its first size / 2 + 1 bins are used. The complex path applies 2/N to the
+		// same half spectrum, so its real part is the correlation the exact 1/N c2r transform restores here
+		template <std::floating_point T>
+		static void ProcessOptimized(std::vector<T>& src_dst, const std::vector<std::complex<T>>& impulse_response) {
+			thread_local std::vector<std::complex<T>> half_spectrum;
+			SequentialDft::TransformReal(src_dst, half_spectrum);
+			std::transform(half_spectrum.begin(), half_spectrum.end(), impulse_response.begin(), half_spectrum.begin(), std::multiplies<std::complex<T>>{});
+			SequentialDft::TransformRealInverse(half_spectrum, src_dst);
+		}
+
 		template <ComplexContainer T1, Container T2>
 		static void Process(T1& src_dst, const T2& impulse_response) {
 			auto ir_spectrum = SequentialDft::Transform(impulse_response);
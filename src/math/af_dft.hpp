@@ -23,6 +23,20 @@ namespace ugsdr {
 				src_dst = std::move(spectrum_cpu_optional.value());
 		}
 
+		template <typename UnderlyingType>
+		static void ProcessBatch(std::vector<std::complex<UnderlyingType>>& src_dst, std::size_t transform_size, bool is_inverse = false) {
+			af::array batch = ArrayProxy(src_dst);
+			batch = af::moddims(batch, static_cast<dim_t>(transform_size), static_cast<dim_t>(src_dst.size() / transform_size));
+			if (is_inverse)
+				af::ifftInPlace(batch);
+			else
+				af::fftInPlace(batch);
+
+			auto batch_cpu_optional = ArrayProxy(af::flat(batch)).CopyFromGpu(src_dst);
+			if (batch_cpu_optional.has_value())
+				src_dst = std::move(batch_cpu_optional.value());
+		}
+
 		static void Process(ArrayProxy& src, bool is_inverse = false) {
 			if (is_inverse)
 				af::ifftInPlace(src);
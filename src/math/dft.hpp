@@ -8,10 +8,15 @@
 #include "../../external/type_map/include/type_map.hpp"
 #endif
 
+#include <algorithm>
 #include <complex>
+#include <filesystem>
+#include <map>
 #include <mutex>
 #include <numbers>
 #include <numeric>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 namespace ugsdr {
@@ -29,6 +34,14 @@ namespace ugsdr {
 		static auto Transform(const T& src, bool is_inverse = false) {
 			return DftImpl::Process(src, is_inverse);
 		}
+
+		template <typename UnderlyingType>
+		static void TransformBatch(std::vector<std::complex<UnderlyingType>>& src_dst, std::size_t transform_size, bool is_inverse = false) {
+			if (transform_size == 0 || src_dst.size() % transform_size != 0)
+				throw std::runtime_error("Batch size is not a multiple of the transform size");
+
+			DftImpl::ProcessBatch(src_dst, transform_size, is_inverse);
+		}
 	};
 
 	class SequentialDft : public DiscreteFourierTransform<SequentialDft> {
@@ -51,6 +64,10 @@ namespace ugsdr {
 				mk::TypeValuePair<double, GetDoublePlan> ,
 				mk::TypeValuePair<std::complex<double>, fftw_plan_dft_1d>
 			>;
+			using CreateManyPlan = mk::TypeMap<
+				mk::TypeValuePair<std::complex<float>, fftwf_plan_many_dft>,
+				mk::TypeValuePair<std::complex<double>, fftw_plan_many_dft>
+			>;
 			using Dft = mk::TypeMap<
 				mk::TypeValuePair<float, fftwf_execute_dft_r2c>,
 				mk::TypeValuePair<std::complex<float>, fftwf_execute_dft>,
@@ -65,6 +82,26 @@ namespace ugsdr {
 				mk::TypeValuePair<float, fftwf_make_planner_thread_safe>,
 				mk::TypeValuePair<double, fftw_make_planner_thread_safe>
 			>;
+			using AlignmentOf = mk::TypeMap<
+				mk::TypeValuePair<float, fftwf_alignment_of>,
+				mk::TypeValuePair<double, fftw_alignment_of>
+			>;
+			using CreateRealInversePlan = mk::TypeMap<
+				mk::TypeValuePair<float, fftwf_plan_dft_c2r_1d>,
+				mk::TypeValuePair<double, fftw_plan_dft_c2r_1d>
+			>;
+			using RealInverseDft = mk::TypeMap<
+				mk::TypeValuePair<float, fftwf_execute_dft_c2r>,
+				mk::TypeValuePair<double, fftw_execute_dft_c2r>
+			>;
+			using ImportWisdom = mk::TypeMap<
+				mk::TypeValuePair<float, fftwf_import_wisdom_from_filename>,
+				mk::TypeValuePair<double, fftw_import_wisdom_from_filename>
+			>;
+			using ExportWisdom = mk::TypeMap<
+				mk::TypeValuePair<float, fftwf_export_wisdom_to_filename>,
+				mk::TypeValuePair<double, fftw_export_wisdom_to_filename>
+			>;
 			using DftComplexType = mk::TypeMap<
 				mk::TypePair<float, float>,
 				mk::TypePair<std::complex<float>, fftwf_complex>,
@@ -75,6 +112,9 @@ namespace ugsdr {
 			static auto GetCreatePlan() {
 				return CreatePlan::template GetValueByType<T>();
 			}
+			static auto GetCreateManyPlan() {
+				return CreateManyPlan::template GetValueByType<T>();
+			}
 			static auto GetDft() {
 				return Dft::GetValueByType<T>();
 			}
@@ -84,11 +124,192 @@ namespace ugsdr {
 			static auto GetPlannerThreadSafe() {
 				return PlannerThreadSafe::GetValueByType<underlying_t<T>>();
 			}
+			static auto GetCreateRealInversePlan() {
+				return CreateRealInversePlan::GetValueByType<underlying_t<T>>();
+			}
+			static auto GetRealInverseDft() {
+				return RealInverseDft::GetValueByType<underlying_t<T>>();
+			}
+			static auto GetAlignmentOf() {
+				return AlignmentOf::GetValueByType<underlying_t<T>>();
+			}
+			static auto GetImportWisdom() {
+				return ImportWisdom::GetValueByType<underlying_t<T>>();
+			}
+			static auto GetExportWisdom() {
+				return ExportWisdom::GetValueByType<underlying_t<T>>();
+			}
 			using DftType = DftComplexType::GetTypeByType<T>;
 		};
-#endif
 
-		static inline std::mutex m;
+		enum class TransformKind {
+			ComplexToComplex,
+			RealToComplex,
+			ComplexToReal
+		};
+
+		struct PlanKey {
+			std::size_t size = 0;
+			std::size_t batch_size = 1;
+			TransformKind kind = TransformKind::ComplexToComplex;
+			bool is_inverse = false;
+			bool is_in_place = false;
+			int input_alignment = 0;
+			int output_alignment = 0;
+
+			auto operator<=>(const PlanKey&) const = default;
+		};
+
+		// Plans are created once per layout and shared by all the threads, the new-array execute functions are thread
+		// safe and only the planner is serialized. The plans are measured on the scratch arrays with the same SIMD
+		// alignment as the actual data, because FFTW_MEASURE overwrites them
+		template <typename UnderlyingType>
+		class PlanCache {
+		private:
+			using Functions = FftwFunctions<UnderlyingType>;
+			using ComplexFunctions = FftwFunctions<std::complex<UnderlyingType>>;
+			using PlanType = decltype(Functions::GetCreatePlan()(0, nullptr, nullptr, 0, 0));
+
+			constexpr static inline std::size_t max_alignment_padding = 64;
+
+			std::mutex m;
+			std::map<PlanKey, PlanType> plans;
+			unsigned planner_flags = FFTW_MEASURE;
+			std::size_t measured_plans = 0;
+
+			PlanCache() {
+				Functions::GetPlannerThreadSafe()();
+			}
+
+			static auto GetAligned(std::vector<UnderlyingType>& scratch, std::size_t offset, int alignment) {
+				auto ptr = scratch.data() + offset;
+				while (Functions::GetAlignmentOf()(ptr) != alignment)
+					++ptr;
+				return ptr;
+			}
+
+			PlanType CreatePlan(const PlanKey& key) {
+				const auto elements = key.size * key.batch_size;
+				const auto input_elements = (key.kind == TransformKind::RealToComplex ? 1 : 2) * elements + max_alignment_padding;
+				auto scratch = std::vector<UnderlyingType>(input_elements + 2 * elements + max_alignment_padding);
+				auto in = GetAligned(scratch, 0, key.input_alignment);
+				auto out = key.is_in_place ? in : GetAligned(scratch, input_elements, key.output_alignment);
+
+				const auto n = static_cast<int>(key.size);
+				const auto sign = key.is_inverse ? FFTW_BACKWARD : FFTW_FORWARD;
+				// the c2r transforms are allowed to use their input as the scratch
+				const auto preserve_input = !key.is_in_place && key.kind != TransformKind::ComplexToReal;
+				const auto flags = planner_flags | (preserve_input ? static_cast<unsigned>(FFTW_PRESERVE_INPUT) : 0u);
+				auto complex_in = reinterpret_cast<typename ComplexFunctions::DftType*>(in);
+				auto complex_out = reinterpret_cast<typename ComplexFunctions::DftType*>(out);
+
+				auto create = [&](unsigned current_flags) {
+					if (key.kind == TransformKind::RealToComplex)
+						return Functions::GetCreatePlan()(n, in, complex_out, sign, current_flags);
+					if (key.kind == TransformKind::ComplexToReal)
+						return Functions::GetCreateRealInversePlan()(n, complex_in, out, current_flags);
+					if (key.batch_size == 1)
+						return ComplexFunctions::GetCreatePlan()(n, complex_in, complex_out, sign, current_flags);
+					return ComplexFunctions::GetCreateManyPlan()(1, &n, static_cast<int>(key.batch_size),
+						complex_in, nullptr, 1, n, complex_out, nullptr, 1, n, sign, current_flags);
+				};
+
+				// the layouts covered by the imported wisdom are planned without measuring, only the rest is new wisdom
+				auto plan = (planner_flags & FFTW_ESTIMATE) ? create(flags) : create(flags | FFTW_WISDOM_ONLY);
+				if (!plan) {
+					plan = create(flags);
+					++measured_plans;
+				}
+				if (!plan)
+					throw std::runtime_error("Unable to create FFTW plan");
+				return plan;
+			}
+
+		public:
+			PlanCache(const PlanCache&) = delete;
+			PlanCache& operator=(const PlanCache&) = delete;
+
+			~PlanCache() {
+				for (auto& [key, plan] : plans)
+					Functions::GetDestroyPlan()(plan);
+			}
+
+			static auto& Get() {
+				static PlanCache cache;
+				return cache;
+			}
+
+			// the threads look up their own copy of the map first, so the lock is only taken for the new layouts
+			PlanType GetPlan(const PlanKey& key) {
+				thread_local auto local_plans = std::map<PlanKey, PlanType>{};
+				if (auto it = local_plans.find(key); it != local_plans.end())
+					return it->second;
+
+				auto lock = std::unique_lock(m);
+				auto it = plans.find(key);
+				if (it == plans.end())
+					it = plans.emplace(key, CreatePlan(key)).first;
+				local_plans.emplace(key, it->second);
+				return it->second;
+			}
+
+			void SetPlannerFlags(unsigned flags) {
+				auto lock = std::unique_lock(m);
+				planner_flags = flags;
+			}
+
+			bool ImportWisdom(const std::filesystem::path& path) {
+				auto lock = std::unique_lock(m);
+				return Functions::GetImportWisdom()(path.string().c_str()) != 0;
+			}
+
+			bool HasNewPlans() {
+				auto lock = std::unique_lock(m);
+				return measured_plans != 0;
+			}
+
+			bool ExportWisdom(const std::filesystem::path& path) {
+				auto lock = std::unique_lock(m);
+				return Functions::GetExportWisdom()(path.string().c_str()) != 0;
+			}
+		};
+
+		template <typename UnderlyingType>
+		static auto GetPlan(std::size_t size, std::size_t batch_size, TransformKind kind, bool is_inverse, UnderlyingType* in, UnderlyingType* out) {
+			auto alignment_of = FftwFunctions<UnderlyingType>::GetAlignmentOf();
+			auto key = PlanKey{ size, batch_size, kind, is_inverse, in == out, alignment_of(in), alignment_of(out) };
+			return PlanCache<UnderlyingType>::Get().GetPlan(key);
+		}
+
+		// the separate wisdom of the single and double precision planners
+		template <typename UnderlyingType>
+		static auto GetWisdomPath(const std::filesystem::path& path) {
+			auto dst = path;
+			dst += std::is_same_v<UnderlyingType, float> ? ".fftwf" : ".fftw";
+			return dst;
+		}
+
+		// 2/N scale of the inverse transform applied to the interleaved components, so the loop is vectorized
+		template <typename UnderlyingType>
+		static void Rescale(std::complex<UnderlyingType>* data, std::size_t size, std::size_t transform_size) {
+			const auto scale = static_cast<UnderlyingType>(2.0 / static_cast<double>(transform_size));
+			auto ptr = reinterpret_cast<UnderlyingType*>(data);
+			for (std::size_t i = 0; i < 2 * size; ++i)
+				ptr[i] *= scale;
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessInPlace(std::complex<UnderlyingType>* data, std::size_t size, std::size_t transform_size, bool is_inverse) {
+			using T = std::complex<UnderlyingType>;
+			auto ptr = reinterpret_cast<UnderlyingType*>(data);
+			auto plan = GetPlan(transform_size, size / transform_size, TransformKind::ComplexToComplex, is_inverse, ptr, ptr);
+			auto fftw_data = reinterpret_cast<typename FftwFunctions<T>::DftType*>(data);
+			FftwFunctions<T>::GetDft()(plan, fftw_data, fftw_data);
+
+			if (is_inverse)
+				Rescale(data, size, transform_size);
+		}
+#endif
 
 		template <typename UnderlyingType>
 		static void GenerateSine(std::size_t iter, std::vector<std::complex<UnderlyingType>>& sine, bool is_inverse = false) {
@@ -111,37 +332,61 @@ namespace ugsdr {
 
 			return dst;
 #else
+			using UnderlyingType = underlying_t<DstType>;
 			auto dst = std::vector<DstType>(src.size());
-			auto plan_function = FftwFunctions<T>::GetCreatePlan();
-			auto src_copy = src;
-			FftwFunctions<T>::GetPlannerThreadSafe()();
-			auto plan = plan_function(static_cast<int>(src.size()), reinterpret_cast<typename FftwFunctions<T>::DftType*>(src_copy.data()),
-				reinterpret_cast<typename FftwFunctions<DstType>::DftType*>(dst.data()), is_inverse ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE);
+			if (src.empty())
+				return dst;
+
+			// out-of-place plans preserve the input, so there's no copy of the source
+			auto in = reinterpret_cast<UnderlyingType*>(const_cast<T*>(src.data()));
+			auto out = reinterpret_cast<UnderlyingType*>(dst.data());
+			auto plan = GetPlan(src.size(), 1, is_complex_v<T> ? TransformKind::ComplexToComplex : TransformKind::RealToComplex, is_inverse, in, out);
 
 			auto dft = FftwFunctions<T>::GetDft();
-			dft(plan, reinterpret_cast<typename FftwFunctions<T>::DftType*>(src_copy.data()), reinterpret_cast<typename FftwFunctions<DstType>::DftType*>(dst.data()));
+			dft(plan, reinterpret_cast<typename FftwFunctions<T>::DftType*>(in), reinterpret_cast<typename FftwFunctions<DstType>::DftType*>(out));
 
-			if (is_inverse) {
-				for (auto& el : dst) {
-					el /= src.size();
-					el *= 2;
-				}
-			}
+			if (is_inverse)
+				Rescale(dst.data(), dst.size(), src.size());
 
-			auto destroy = FftwFunctions<DstType>::GetDestroyPlan();
-			destroy(plan);
-		
 			return dst;
 #endif
 		}
 
+		template <typename UnderlyingType>
+		static void ProcessBatchImpl(std::vector<std::complex<UnderlyingType>>& src_dst, std::size_t transform_size, bool is_inverse) {
+#ifndef HAS_FFTW
+			using T = std::complex<UnderlyingType>;
+			const auto batch_size = src_dst.size() / transform_size;
+			auto row = std::vector<T>(transform_size);
+			for (std::size_t i = 0; i < batch_size; ++i) {
+				auto row_begin = src_dst.begin() + i * transform_size;
+				std::copy(row_begin, row_begin + transform_size, row.begin());
+				row = ProcessImpl<T>(row, is_inverse);
+				std::copy(row.begin(), row.end(), row_begin);
+			}
+#else
+			if (!src_dst.empty())
+				ProcessInPlace(src_dst.data(), src_dst.size(), transform_size, is_inverse);
+#endif
+		}
+
 	protected:
 		friend class DiscreteFourierTransform<SequentialDft>;
 
+		template <typename UnderlyingType>
+		static void ProcessBatch(std::vector<std::complex<UnderlyingType>>& src_dst, std::size_t transform_size, bool is_inverse = false) {
+			ProcessBatchImpl(src_dst, transform_size, is_inverse);
+		}
+
 		template <typename UnderlyingType>
 		static void Process(std::vector<std::complex<UnderlyingType>>& src_dst, bool is_inverse = false) {
+#ifndef HAS_FFTW
 			const auto& src = src_dst;
 			src_dst = Process(src, is_inverse);
+#else
+			if (!src_dst.empty())
+				ProcessInPlace(src_dst.data(), src_dst.size(), src_dst.size(), is_inverse);
+#endif
 		}
 
 		template <typename UnderlyingType>
@@ -155,5 +400,74 @@ namespace ugsdr {
 		}
 
 	public:
+		// Non-redundant half of the real signal spectrum: size / 2 + 1 bins, the rest follows from the Hermitian symmetry
+		template <typename UnderlyingType>
+		static void TransformReal(const std::vector<UnderlyingType>& src, std::vector<std::complex<UnderlyingType>>& half_spectrum) {
+			static_assert(std::is_floating_point_v<UnderlyingType>, "Only floating point types are supported");
+			CheckResize(half_spectrum, src.size() / 2 + 1);
+			if (src.empty())
+				return;
+#ifndef HAS_FFTW
+			const auto spectrum = ProcessImpl<std::complex<UnderlyingType>>(std::vector<std::complex<UnderlyingType>>(src.begin(), src.end()));
+			std::copy(spectrum.begin(), spectrum.begin() + half_spectrum.size(), half_spectrum.begin());
+#else
+			auto in = const_cast<UnderlyingType*>(src.data());
+			auto out = reinterpret_cast<UnderlyingType*>(half_spectrum.data());
+			auto plan = GetPlan(src.size(), 1, TransformKind::RealToComplex, false, in, out);
+			FftwFunctions<UnderlyingType>::GetDft()(plan, in, reinterpret_cast<typename FftwFunctions<std::complex<UnderlyingType>>::DftType*>(out));
+#endif
+		}
+
+		// Exact inverse of TransformReal (1/N scale), dst.size() is the length of the real signal. The half spectrum is
+		// used as the scratch and is overwritten
+		template <typename UnderlyingType>
+		static void TransformRealInverse(std::vector<std::complex<UnderlyingType>>& half_spectrum, std::vector<UnderlyingType>& dst) {
+			static_assert(std::is_floating_point_v<UnderlyingType>, "Only floating point types are supported");
+			if (half_spectrum.size() != dst.size() / 2 + 1)
+				throw std::runtime_error("Half spectrum size doesn't match the signal length");
+			if (dst.empty())
+				return;
+#ifndef HAS_FFTW
+			auto spectrum = std::vector<std::complex<UnderlyingType>>(dst.size());
+			std::copy(half_spectrum.begin(), half_spectrum.end(), spectrum.begin());
+			for (std::size_t i = half_spectrum.size(); i < spectrum.size(); ++i)
+				spectrum[i] = std::conj(spectrum[spectrum.size() - i]);
+			const auto signal = ProcessImpl<std::complex<UnderlyingType>>(spectrum, true);
+			std::transform(signal.begin(), signal.end(), dst.begin(), [](auto& val) { return val.real(); });
+#else
+			auto in = reinterpret_cast<UnderlyingType*>(half_spectrum.data());
+			auto plan = GetPlan(dst.size(), 1, TransformKind::ComplexToReal, true, in, dst.data());
+			FftwFunctions<UnderlyingType>::GetRealInverseDft()(plan, reinterpret_cast<typename FftwFunctions<std::complex<UnderlyingType>>::DftType*>(in), dst.data());
+
+			const auto scale = static_cast<UnderlyingType>(1.0 / static_cast<double>(dst.size()));
+			for (auto& el : dst)
+				el *= scale;
+#endif
+		}
+
+#ifdef HAS_FFTW
+		// affects the plans created afterwards, e.g. FFTW_ESTIMATE for the short runs or FFTW_PATIENT with the wisdom
+		template <typename UnderlyingType>
+		static void SetPlannerFlags(unsigned flags) {
+			PlanCache<UnderlyingType>::Get().SetPlannerFlags(flags);
+		}
+
+		// the wisdom of both precisions is stored next to each other as path.fftwf and path.fftw, the missing files
+		// aren't an error: the plans are just measured again
+		static bool ImportWisdom(const std::filesystem::path& path) {
+			const auto float_imported = PlanCache<float>::Get().ImportWisdom(GetWisdomPath<float>(path));
+			const auto double_imported = PlanCache<double>::Get().ImportWisdom(GetWisdomPath<double>(path));
+			return float_imported && double_imported;
+		}
+
+		// only the precisions that measured new plans are written, the wisdom of the others is left as it was
+		static bool ExportWisdom(const std::filesystem::path& path) {
+			auto& float_cache = PlanCache<float>::Get();
+			const auto float_exported = !float_cache.HasNewPlans() || float_cache.ExportWisdom(GetWisdomPath<float>(path));
+			auto& double_cache = PlanCache<double>::Get();
+			const auto double_exported = !double_cache.HasNewPlans() || double_cache.ExportWisdom(GetWisdomPath<double>(path));
+			return float_exported && double_exported;
+		}
+#endif
 	};
 }
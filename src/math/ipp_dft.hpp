@@ -7,6 +7,9 @@
 #include "../../external/plusifier/Plusifier.hpp"
 #include "../../external/type_map/include/type_map.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <list>
 #include <type_traits>
 
 namespace ugsdr {
@@ -21,43 +24,97 @@ namespace ugsdr {
 			return conversion_wrapper;
 		}
 
-		static auto& GetSpec() {
-			static thread_local auto spec = plusifier::PointerWrapper<Ipp8u, ippsFree>();
-			return spec;
-		}
+		// DFT spec with the work buffer of a single transform size, the power of two sizes use the FFT
+		template <typename UnderlyingType>
+		struct DftSpec {
+			std::size_t size = 0;
+			int fft_order = -1;
+			plusifier::PointerWrapper<Ipp8u, ippsFree> spec;
+			plusifier::PointerWrapper<Ipp8u, ippsFree> work_buffer;
+			Ipp8u* spec_ptr = nullptr;
+		};
 
-		static auto& GetInitializationBuffer() {
-			static thread_local auto init_buf = plusifier::PointerWrapper<Ipp8u, ippsFree>();
-			return init_buf;
-		}
+		constexpr static inline std::size_t max_cached_specs = 8;
+
+		template <typename UnderlyingType>
+		static void InitSpec(DftSpec<UnderlyingType>& dft_spec, std::size_t signal_size) {
+			Ipp32s spec_size = 0;
+			Ipp32s init_size = 0;
+			Ipp32s work_size = 0;
+			auto init_buf = plusifier::PointerWrapper<Ipp8u, ippsFree>();
+
+			dft_spec.size = signal_size;
+			if (std::has_single_bit(signal_size)) {
+				dft_spec.fft_order = static_cast<int>(std::countr_zero(signal_size));
+				IppDftFunctions<UnderlyingType>::GetFftSize(dft_spec.fft_order, IPP_FFT_DIV_INV_BY_N,
+					ippAlgHintNone, &spec_size, &init_size, &work_size);
+
+				dft_spec.spec = plusifier::PointerWrapper<Ipp8u, ippsFree>(ippsMalloc_8u, spec_size);
+				init_buf = plusifier::PointerWrapper<Ipp8u, ippsFree>(ippsMalloc_8u, init_size);
+
+				// the FFT spec is aligned within the provided buffer
+				using FftSpecType = typename IppDftFunctions<UnderlyingType>::FftSpecType;
+				FftSpecType* spec_ptr = nullptr;
+				IppDftFunctions<UnderlyingType>::GetFftInit(&spec_ptr, dft_spec.fft_order, IPP_FFT_DIV_INV_BY_N, ippAlgHintNone, dft_spec.spec, init_buf);
+				dft_spec.spec_ptr = reinterpret_cast<Ipp8u*>(spec_ptr);
+			}
+			else {
+				IppDftFunctions<UnderlyingType>::GetSize(static_cast<int>(signal_size), IPP_FFT_DIV_INV_BY_N,
+					ippAlgHintNone, &spec_size, &init_size, &work_size);
+
+				dft_spec.spec = plusifier::PointerWrapper<Ipp8u, ippsFree>(ippsMalloc_8u, spec_size);
+				init_buf = plusifier::PointerWrapper<Ipp8u, ippsFree>(ippsMalloc_8u, init_size);
 
-		static auto& GetWorkBuffer() {
-			static thread_local auto work_buf = plusifier::PointerWrapper<Ipp8u, ippsFree>();
-			return work_buf;
+				Ipp8u* spec_ptr = dft_spec.spec;
+				using DftSpecType = typename IppDftFunctions<UnderlyingType>::SpecType;
+				IppDftFunctions<UnderlyingType>::GetInit(static_cast<int>(signal_size), IPP_FFT_DIV_INV_BY_N, ippAlgHintNone, reinterpret_cast<DftSpecType*>(spec_ptr), init_buf);
+				dft_spec.spec_ptr = spec_ptr;
+			}
+			dft_spec.work_buffer = plusifier::PointerWrapper<Ipp8u, ippsFree>(ippsMalloc_8u, work_size);
 		}
 
+		// Least recently used specs of each precision per thread, so the acquisition, tracking and jamming detection
+		// sharing a thread with the different transform sizes don't initialize them over and over
 		template <typename UnderlyingType>
-		static void SetDftSizes(std::size_t signal_size) {
-			static thread_local std::size_t current_size = 0;
+		static auto& GetDftSpec(std::size_t signal_size) {
+			static thread_local auto specs = std::list<DftSpec<UnderlyingType>>();
 
-			if (current_size == signal_size)
-				return;
+			auto it = std::find_if(specs.begin(), specs.end(), [signal_size](const auto& el) { return el.size == signal_size; });
+			if (it != specs.end()) {
+				specs.splice(specs.begin(), specs, it);
+				return specs.front();
+			}
 
-			current_size = signal_size;
-			Ipp32s spec_size = 0;
-			Ipp32s init_size = 0;
-			Ipp32s work_size = 0;
-			IppDftFunctions<UnderlyingType>::GetSize(static_cast<int>(signal_size), IPP_FFT_DIV_INV_BY_N, 
-				ippAlgHintNone, &spec_size, &init_size, &work_size);
+			if (specs.size() == max_cached_specs)
+				specs.pop_back();
+			specs.emplace_front();
+			try {
+				InitSpec(specs.front(), signal_size);
+			}
+			catch (...) {
+				specs.pop_front();
+				throw;
+			}
+			return specs.front();
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessRows(std::complex<UnderlyingType>* data, std::size_t size, std::size_t transform_size, bool is_inverse) {
+			auto& dft_spec = GetDftSpec<UnderlyingType>(transform_size);
+			using IppType = typename IppTypeToComplex<UnderlyingType>::Type;
 
-			GetSpec() = plusifier::PointerWrapper<Ipp8u, ippsFree>(ippsMalloc_8u, spec_size);
-			GetInitializationBuffer() = plusifier::PointerWrapper<Ipp8u, ippsFree>(ippsMalloc_8u, init_size);
-			GetWorkBuffer() = plusifier::PointerWrapper<Ipp8u, ippsFree>(ippsMalloc_8u, work_size);
+			if (dft_spec.fft_order >= 0) {
+				using FftSpecType = typename IppDftFunctions<UnderlyingType>::FftSpecType;
+				auto fft_routine = is_inverse ? IppDftFunctions<UnderlyingType>::GetFftInverse() : IppDftFunctions<UnderlyingType>::GetFftForward();
+				for (auto row = data; row != data + size; row += transform_size)
+					fft_routine(reinterpret_cast<IppType*>(row), reinterpret_cast<FftSpecType*>(dft_spec.spec_ptr), dft_spec.work_buffer);
+				return;
+			}
 
-			Ipp8u* spec_ptr = GetSpec();
 			using DftSpecType = typename IppDftFunctions<UnderlyingType>::SpecType;
-			IppDftFunctions<UnderlyingType>::GetInit(static_cast<int>(signal_size), IPP_FFT_DIV_INV_BY_N, ippAlgHintNone, reinterpret_cast<DftSpecType*>(spec_ptr), GetInitializationBuffer());
-
+			auto dft_routine = is_inverse ? IppDftFunctions<UnderlyingType>::GetInverse() : IppDftFunctions<UnderlyingType>::GetForward();
+			for (auto row = data; row != data + size; row += transform_size)
+				dft_routine(reinterpret_cast<IppType*>(row), reinterpret_cast<IppType*>(row), reinterpret_cast<DftSpecType*>(dft_spec.spec_ptr), dft_spec.work_buffer);
 		}
 		
 	protected:
@@ -85,6 +142,26 @@ namespace ugsdr {
 				mk::TypePair<float, IppsDFTSpec_C_32fc>,
 				mk::TypePair<double, IppsDFTSpec_C_64fc>
 			>;
+			using FftGetSize = mk::TypeMap<
+				mk::TypeValuePair<float, ippsFFTGetSize_C_32fc>,
+				mk::TypeValuePair<double, ippsFFTGetSize_C_64fc>
+			>;
+			using FftInit = mk::TypeMap<
+				mk::TypeValuePair<float, ippsFFTInit_C_32fc>,
+				mk::TypeValuePair<double, ippsFFTInit_C_64fc>
+			>;
+			using FftInverse = mk::TypeMap<
+				mk::TypeValuePair<float, ippsFFTInv_CToC_32fc_I>,
+				mk::TypeValuePair<double, ippsFFTInv_CToC_64fc_I>
+			>;
+			using FftForward = mk::TypeMap<
+				mk::TypeValuePair<float, ippsFFTFwd_CToC_32fc_I>,
+				mk::TypeValuePair<double, ippsFFTFwd_CToC_64fc_I>
+			>;
+			using FftSpecTypeMap = mk::TypeMap<
+				mk::TypePair<float, IppsFFTSpec_C_32fc>,
+				mk::TypePair<double, IppsFFTSpec_C_64fc>
+			>;
 
 			template <typename ... Args>
 			static auto GetSize(Args &&... args) {
@@ -100,18 +177,35 @@ namespace ugsdr {
 			static auto GetForward() {
 				return DftForward::GetValueByType<T>();
 			}
+			template <typename ... Args>
+			static auto GetFftSize(Args &&... args) {
+				return FftGetSize::GetValueByType<T>()(args...);
+			}
+			template <typename ... Args>
+			static auto GetFftInit(Args &&... args) {
+				return FftInit::GetValueByType<T>()(args...);
+			}
+			static auto GetFftInverse() {
+				return FftInverse::GetValueByType<T>();
+			}
+			static auto GetFftForward() {
+				return FftForward::GetValueByType<T>();
+			}
 			using SpecType = DftSpecType::GetTypeByType<T>;
+			using FftSpecType = FftSpecTypeMap::GetTypeByType<T>;
 		};
 		
 		template <typename UnderlyingType>
 		static void Process(std::vector<std::complex<UnderlyingType>>& src_dst, bool is_inverse = false) {
 			static_assert(std::is_floating_point_v<UnderlyingType>, R"(Only floating point types are supported, convert integers in the const overload)");
-			SetDftSizes<UnderlyingType>(src_dst.size());
-			Ipp8u* spec_ptr = GetSpec();
-			using DftSpecType = typename IppDftFunctions<UnderlyingType>::SpecType;
-			using IppType = typename IppTypeToComplex<UnderlyingType>::Type;
-			auto dft_routine = is_inverse ? IppDftFunctions<UnderlyingType>::GetInverse() : IppDftFunctions<UnderlyingType>::GetForward();
-			dft_routine(reinterpret_cast<IppType*>(src_dst.data()), reinterpret_cast<IppType*>(src_dst.data()), reinterpret_cast<DftSpecType*>(spec_ptr), GetWorkBuffer());
+			if (!src_dst.empty())
+				ProcessRows(src_dst.data(), src_dst.size(), src_dst.size(), is_inverse);
+		}
+
+		template <typename UnderlyingType>
+		static void ProcessBatch(std::vector<std::complex<UnderlyingType>>& src_dst, std::size_t transform_size, bool is_inverse = false) {
+			if (!src_dst.empty())
+				ProcessRows(src_dst.data(), src_dst.size(), transform_size, is_inverse);
 		}
 
 		template <typename T>
@@ -65,7 +65,7 @@ namespace ugsdr {
 			std::vector<T> dst(window_length + (src.size() - 1) * gap_length);
 
 			for (std::size_t i = 0; i < src.size(); ++i) {
-				auto current_ifft = IppDft::Transform(src[i], true);
+				auto current_ifft = SequentialDft::Transform(src[i], true);
 				for (std::size_t j = 0; j < current_ifft.size(); ++j)
 					dst[i * gap_length + j] += current_ifft[j];
 			}
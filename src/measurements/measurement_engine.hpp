@@ -6,6 +6,7 @@
 #include "../tracking/tracking_parameters.hpp"
 #include "../helpers/rtklib_helpers.hpp"
 
+#include <filesystem>
 #include <fstream>
 #include <memory>
 #include <set>
@@ -136,11 +137,13 @@ namespace ugsdr {
 			}
 		}
 
-		void WriteNav(rnxopt_t* rnxopt) const {
+		void WriteNav(rnxopt_t* rnxopt, const std::filesystem::path& path = "ugsdr.nav") const {
 			if (!rnxopt)
 				throw std::runtime_error("Unexpected nullptr");
 
-			auto rinex_nav = std::unique_ptr<FILE, int(*)(FILE*)>(fopen("ugsdr.nav", "w"), fclose);
+			auto rinex_nav = std::unique_ptr<FILE, int(*)(FILE*)>(fopen(path.string().c_str(), "w"), fclose);
+			if (!rinex_nav)
+				throw std::runtime_error("Unable to open RINEX navigation file");
 
 			outrnxnavh(rinex_nav.get(), rnxopt, nav.get());
 			for (std::size_t i = 0; i < nav->n; ++i)
@@ -149,27 +152,21 @@ namespace ugsdr {
 				outrnxgnavb(rinex_nav.get(), rnxopt, nav->geph + i);
 		}
 
-	public:
-		TimeScale receiver_time_scale;
-		std::vector<Observable> observables;
-		std::unique_ptr<nav_t, void(*)(nav_t*)> nav;
-		std::set<ugsdr::Signal> available_signals;
-		std::size_t week = 0;
-
-		template <ChannelConfigConcept ChConfig, typename T>
-		MeasurementEngine(const Tracker<ChConfig, T>& tracker) : MeasurementEngine(tracker.GetTrackingParameters()) {}
-
-		template <TrackingParametersConfigConcept Config, typename T>
-		MeasurementEngine(const std::vector<TrackingParameters<Config, T>>& tracking_results) : nav(new nav_t(), FreeNav) {
-			if (tracking_results.empty())
-				throw std::runtime_error("Empty tracking results");
-
-			receiver_time_scale = TimeScale(tracking_results.begin()->prompt.size());
-			observables.reserve(tracking_results.size());
+		auto MakeRinexOptions(std::size_t epoch_step) const {
+			auto rnxopt = std::make_unique<rnxopt_t>();
+			rnxopt->rnxver = 303;
+			rnxopt->ttol = epoch_step * 0.001;
+			rnxopt->tstart = gpst2time(nav->eph[0].week, receiver_time_scale.first() * 1e-3);
+			rnxopt->tend = gpst2time(nav->eph[0].week, receiver_time_scale.last() * 1e-3);
+			for (auto& el : available_signals)
+				rnxopt->navsys |= rtklib_helpers::ConvertSystem(ugsdr::GetSystemBySignal(el));
 
-			for (auto& el : tracking_results) 
-				Observable::MakeObservable(el, receiver_time_scale, observables);
+			rnxopt->obstype = OBSTYPE_ALL;
+			rnxopt->freqtype = FREQTYPE_ALL;
+			return rnxopt;
+		}
 
+		void ProcessObservables() {
 			auto day_offset = 0;
 			for (auto& obs : observables) {
 				if (obs.sv.system == ugsdr::System::Gps) {
@@ -203,6 +200,46 @@ namespace ugsdr {
 				}
 			}
 		}
+
+	public:
+		TimeScale receiver_time_scale;
+		std::vector<Observable> observables;
+		std::unique_ptr<nav_t, void(*)(nav_t*)> nav;
+		std::set<ugsdr::Signal> available_signals;
+		std::size_t week = 0;
+
+		template <ChannelConfigConcept ChConfig, typename T>
+		MeasurementEngine(const Tracker<ChConfig, T>& tracker) : MeasurementEngine(tracker.GetTrackingParameters()) {}
+
+		template <TrackingParametersConfigConcept Config, typename T>
+		MeasurementEngine(const std::vector<TrackingParameters<Config, T>>& tracking_results) : nav(new nav_t(), FreeNav) {
+			if (tracking_results.empty())
+				throw std::runtime_error("Empty tracking results");
+
+			receiver_time_scale = TimeScale(tracking_results.begin()->prompt.size());
+			observables.reserve(tracking_results.size());
+
+			for (auto& el : tracking_results) 
+				Observable::MakeObservable(el, receiver_time_scale, observables);
+
+			ProcessObservables();
+		}
+	
+		// sliding window of the single-pass receiver, navigation_states keep the decoded navigation of every channel between the windows
+		template <TrackingParametersConfigConcept Config, typename T>
+		MeasurementEngine(const std::vector<TrackingParameters<Config, T>>& tracking_results, std::vector<NavigationState>& navigation_states) : nav(new nav_t(), FreeNav) {
+			if (tracking_results.empty())
+				throw std::runtime_error("Empty tracking results");
+
+			receiver_time_scale = TimeScale(tracking_results.begin()->prompt.size());
+			observables.reserve(tracking_results.size());
+			navigation_states.resize(tracking_results.size());
+
+			for (std::size_t i = 0; i < tracking_results.size(); ++i)
+				Observable::MakeObservable(tracking_results[i], receiver_time_scale, observables, navigation_states[i]);
+
+			ProcessObservables();
+		}
 	
 		auto GetMeasurementEpoch(std::size_t epoch) const -> std::pair< std::vector<obsd_t>, nav_t*>{
 			auto obs = std::vector<obsd_t>();
@@ -220,19 +257,15 @@ namespace ugsdr {
 		}
 
 		void WriteRinex(std::size_t epoch_step = 1) {
-			auto rnxopt = std::make_unique<rnxopt_t>();
-			rnxopt->rnxver = 303;
-			rnxopt->ttol = epoch_step * 0.001;
-			rnxopt->tstart = gpst2time(nav->eph[0].week, receiver_time_scale.first() * 1e-3);
-			rnxopt->tend = gpst2time(nav->eph[0].week, receiver_time_scale.last() * 1e-3);
-			for (auto& el : available_signals)
-				rnxopt->navsys |= rtklib_helpers::ConvertSystem(ugsdr::GetSystemBySignal(el));
-
-			rnxopt->obstype = OBSTYPE_ALL;
-			rnxopt->freqtype = FREQTYPE_ALL;
-
+			auto rnxopt = MakeRinexOptions(epoch_step);
 			WriteNav(rnxopt.get());
 			WriteObs(rnxopt.get(), epoch_step);
 		}
+
+		// decoded ephemerides for the next session, AcquisitionAidPredictor loads them back
+		void WriteNavigation(const std::filesystem::path& path) const {
+			auto rnxopt = MakeRinexOptions(1);
+			WriteNav(rnxopt.get(), path);
+		}
 	};
 }
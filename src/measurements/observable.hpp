@@ -14,11 +14,29 @@
 #include "../resample/resampler.hpp"
 #include "../tracking/tracking_parameters.hpp"
 
+#include <cstdint>
 #include <limits>
 #include <optional>
+#include <variant>
 #include <vector>
 
 namespace ugsdr {
+	// Navigation message of a channel decoded in the previous windows of a single-pass receiver, the preamble is the absolute epoch
+	struct DecodedNavigation {
+		std::ptrdiff_t preamble_epoch = 0;
+		std::int32_t pseudorange_offset = 0;
+		std::variant<GpsEphemeris, GlonassEphemeris> ephemeris;
+	};
+
+	struct NavigationState {
+		// the broadcast ephemeris changes every two hours, the previous one is used until the next one is decoded
+		constexpr static inline std::ptrdiff_t refresh_ms = 2 * 60 * 60 * 1000;
+
+		std::optional<DecodedNavigation> decoded;
+		// absolute epoch of the first preamble candidate that wasn't checked yet
+		std::size_t search_epoch = 0;
+	};
+
 	class Observable final {
 #ifdef HAS_IPP
 		using AbsType = IppAbs;
@@ -53,8 +71,12 @@ namespace ugsdr {
 
 		template <TrackingParametersConfigConcept Config, typename T>
 		void CalculateSnr(const TrackingParameters<Config, T>& tracking_result) {
+			static thread_local std::vector<std::complex<T>> prompt;
 			static thread_local std::vector<T> real(tracking_result.prompt.size());
 			static thread_local std::vector<T> imaginary(tracking_result.prompt.size());
+			tracking_result.prompt.CopyTo(prompt);
+			CheckResize(real, prompt.size());
+			CheckResize(imaginary, prompt.size());
 #ifdef HAS_IPP
 			using IppType = typename IppTypeToComplex<T>::Type;
 #else
@@ -62,27 +84,41 @@ namespace ugsdr {
 #endif
 
 			auto cplx_to_imag_wrapper = GetComplexToImagWrapper();
-			cplx_to_imag_wrapper(reinterpret_cast<const IppType*>(tracking_result.prompt.data()), real.data(), imaginary.data(), static_cast<int>(imaginary.size()));
+			cplx_to_imag_wrapper(reinterpret_cast<const IppType*>(prompt.data()), real.data(), imaginary.data(), static_cast<int>(imaginary.size()));
 
 			auto [mean, sigma] = MeanStdDevType::Calculate(imaginary);
 
-			snr.resize(tracking_result.prompt.size());
+			snr.resize(prompt.size());
 			for(std::size_t i = 0;i<snr.size(); ++i)
-				snr[i] = 27 + 20 * std::log10(std::abs(tracking_result.prompt[i].real()) / sigma);
+				snr[i] = 27 + 20 * std::log10(std::abs(prompt[i].real()) / sigma);
 		}
 		
+		// absolute epoch of the first one in the history, the sliding window drops the older ones
+		template <TrackingParametersConfigConcept Config, typename T>
+		static std::size_t GetFirstEpoch(const TrackingParameters<Config, T>& tracking_result) {
+			const auto history_length = tracking_result.prompt.size();
+			return tracking_result.epochs_tracked > history_length ? tracking_result.epochs_tracked - history_length : 0;
+		}
+
 		template <TrackingParametersConfigConcept Config, typename T, typename E>
 		Observable(const TrackingParameters<Config, T>& tracking_result, TimeScale& time_scale_ref, std::size_t position, E eph) :
-			sv(tracking_result.sv), ephemeris(std::move(eph)), time_scale(time_scale_ref), preamble_position(position) {
+			Observable(tracking_result, time_scale_ref, static_cast<std::ptrdiff_t>(position),
+				// we're estimating position in milliseconds, not code periods, so this should work fine
+				static_cast<std::int32_t>(tracking_result.code_phases[position] * 1000 / tracking_result.sampling_rate), std::move(eph)) {}
+
+		template <TrackingParametersConfigConcept Config, typename T, typename E>
+		Observable(const TrackingParameters<Config, T>& tracking_result, TimeScale& time_scale_ref, std::ptrdiff_t position, std::int32_t offset, E eph) :
+			sv(tracking_result.sv), ephemeris(std::move(eph)), time_scale(time_scale_ref), preamble_position(position), pseudorange_offset(offset) {
 			pseudorange.reserve(tracking_result.code_phases.size());
 			auto samples_to_ms_rate = 1000 / tracking_result.sampling_rate;
-			// we're estimating position in milliseconds, not code periods, so this should work fine
-			auto pseudorange_offset = static_cast<std::int32_t>(tracking_result.code_phases[position] * samples_to_ms_rate);
-			for (auto& el : tracking_result.code_phases) pseudorange.push_back(el * samples_to_ms_rate - pseudorange_offset);
+			for (auto el : tracking_result.code_phases) pseudorange.push_back(el * samples_to_ms_rate - pseudorange_offset);
 			auto intermediate_frequency_windup = tracking_result.intermediate_frequency / 1e3;
-			for (std::size_t i = 0; i < tracking_result.phases.size(); ++i) pseudophase.push_back(tracking_result.phases[i] + static_cast<double>(i + 1) * intermediate_frequency_windup);
+			tracking_result.phases.CopyTo(pseudophase);
+			// the phases are accumulated since the start of the tracking, so is the wind-up
+			const auto first_epoch = GetFirstEpoch(tracking_result);
+			for (std::size_t i = 0; i < pseudophase.size(); ++i) pseudophase[i] += static_cast<double>(first_epoch + i + 1) * intermediate_frequency_windup;
 			//pseudophase = tracking_result.phases;
-			doppler = tracking_result.frequencies;
+			tracking_result.frequencies.CopyTo(doppler);
 			for (auto& el : doppler) el -= tracking_result.intermediate_frequency;
 			CalculateSnr(tracking_result);
 		}
@@ -181,11 +217,11 @@ namespace ugsdr {
 		}
 
 		template <typename T>
-		static std::optional<std::size_t> FindPreamblePositionGps(const std::vector<std::size_t>& indexes, std::span<const T> bits, double first_pseudorange) {
+		static std::optional<std::size_t> FindPreamblePositionGps(const std::vector<std::size_t>& indexes, std::span<const T> bits, double first_pseudorange, std::size_t first_position) {
 			auto preamble_position = std::numeric_limits<std::size_t>::max();
 			for (auto& el : indexes) {
 				auto it = std::find_if(indexes.begin(), indexes.end(), [el](auto& ind) { return el - ind == 6000; });
-				if (it == indexes.end())
+				if (it == indexes.end() || *it < first_position)
 					continue;
 
 				auto accumulated_bits = GetAccumulatedBits(std::span(bits.begin() + *it - 40, 20 * 62));
@@ -201,9 +237,10 @@ namespace ugsdr {
 		}
 
 		template <TrackingParametersConfigConcept Config, typename T>
-		static auto FindPreambleGps(const TrackingParameters<Config, T>& tracking_result, TimeScale& receiver_time_scale) -> std::optional<Observable> {
+		static auto FindPreambleGps(const TrackingParameters<Config, T>& tracking_result, TimeScale& receiver_time_scale, std::size_t first_position) -> std::optional<Observable> {
 			std::vector<T> navigation_bits;
-			const auto& prompt = tracking_result.prompt;
+			std::vector<std::complex<T>> prompt;
+			tracking_result.prompt.CopyTo(prompt);
 			navigation_bits.reserve(prompt.size());
 			std::transform(prompt.begin(), prompt.end(), std::back_inserter(navigation_bits), [](auto& prompt_value) {
 				auto value = prompt_value.real() > 0 ? 1 : -1;
@@ -222,7 +259,7 @@ namespace ugsdr {
 			std::vector<T> vals;
 			for (auto& el : prompt)
 				vals.push_back(el.real());
-			auto preamble_position = FindPreamblePositionGps(indexes, std::span<const T>(vals), tracking_result.code_phases[0] * 1000 / tracking_result.sampling_rate);
+			auto preamble_position = FindPreamblePositionGps(indexes, std::span<const T>(vals), tracking_result.code_phases[0] * 1000 / tracking_result.sampling_rate, first_position);
 			if (!preamble_position)
 				return std::nullopt;
 
@@ -232,18 +269,16 @@ namespace ugsdr {
 			auto nav_bits = GetAccumulatedBits(std::span<const T>(navigation_bits.begin() + preamble_position.value() - 20, 1501 * 20), T{});
 			auto current_ephemeris = GpsEphemeris(std::span(nav_bits.begin() + 1, nav_bits.end()), nav_bits[0]);
 
-			auto tow_ms = current_ephemeris.tow * 1000;
-
-			receiver_time_scale.UpdateScale(preamble_position.value(), tow_ms, System::Gps);
+			receiver_time_scale.UpdateScale(static_cast<std::ptrdiff_t>(preamble_position.value()), GetTowMs(current_ephemeris), System::Gps);
 			
 			return Observable(tracking_result, receiver_time_scale, preamble_position.value(), current_ephemeris);
 		}
 
-		static std::optional<std::size_t> FindPreamblePositionGlonass(const std::vector<std::size_t>& indexes, double first_pseudorange) {
+		static std::optional<std::size_t> FindPreamblePositionGlonass(const std::vector<std::size_t>& indexes, double first_pseudorange, std::size_t first_position) {
 			auto preamble_position = std::numeric_limits<std::size_t>::max();
 			for (auto& el : indexes) {
 				auto it = std::find_if(indexes.begin(), indexes.end(), [el](auto& ind) { return el - ind == 30000; });
-				if (it == indexes.end())
+				if (it == indexes.end() || *it < first_position)
 					continue;
 
 				preamble_position = *it + 300;
@@ -258,9 +293,10 @@ namespace ugsdr {
 		}
 
 		template <TrackingParametersConfigConcept Config, typename T>
-		static auto FindPreambleGlonass(const TrackingParameters<Config, T>& tracking_result, TimeScale& receiver_time_scale) -> std::optional<Observable> {
+		static auto FindPreambleGlonass(const TrackingParameters<Config, T>& tracking_result, TimeScale& receiver_time_scale, std::size_t first_position) -> std::optional<Observable> {
 			std::vector<T> navigation_bits;
-			const auto& prompt = tracking_result.prompt;
+			std::vector<std::complex<T>> prompt;
+			tracking_result.prompt.CopyTo(prompt);
 			navigation_bits.reserve(prompt.size());
 			std::transform(prompt.begin(), prompt.end(), std::back_inserter(navigation_bits), [](auto& prompt_value) {
 				auto value = prompt_value.real() > 0 ? 1 : -1;
@@ -279,7 +315,7 @@ namespace ugsdr {
 			std::vector<T> vals;
 			for (auto& el : prompt)
 				vals.push_back(el.real());
-			auto preamble_position = FindPreamblePositionGlonass(indexes, tracking_result.code_phases[0] * 1000 / tracking_result.sampling_rate);
+			auto preamble_position = FindPreamblePositionGlonass(indexes, tracking_result.code_phases[0] * 1000 / tracking_result.sampling_rate, first_position);
 			if (!preamble_position)
 				return std::nullopt;
 
@@ -305,20 +341,38 @@ namespace ugsdr {
 				accumulated_bits[i] = (accumulated_bits[i] < 0);
 			auto current_ephemeris = GlonassEphemeris(std::span(accumulated_bits));
 
-			auto tow_ms = static_cast<std::size_t>((current_ephemeris.tk - 3 * 60 * 60 + 18) * 1000);
-
-			receiver_time_scale.UpdateScale(preamble_position.value(), tow_ms, System::Glonass);
+			receiver_time_scale.UpdateScale(static_cast<std::ptrdiff_t>(preamble_position.value()), GetTowMs(current_ephemeris), System::Glonass);
 
 			return Observable(tracking_result, receiver_time_scale, preamble_position.value(), current_ephemeris);
 		}
 		
 		template <TrackingParametersConfigConcept Config, typename T>
-		static std::optional<Observable> FindPreamble(const TrackingParameters<Config, T>& tracking_result, TimeScale& receiver_time_scale) {
+		static std::optional<Observable> FindPreamble(const TrackingParameters<Config, T>& tracking_result, TimeScale& receiver_time_scale, std::size_t first_position = 0) {
 			switch (tracking_result.sv.system) {
 			case (System::Gps):
-				return FindPreambleGps(tracking_result, receiver_time_scale);
+				return FindPreambleGps(tracking_result, receiver_time_scale, first_position);
 			case (System::Glonass):
-				return FindPreambleGlonass(tracking_result, receiver_time_scale);
+				return FindPreambleGlonass(tracking_result, receiver_time_scale, first_position);
+			default:
+				throw std::runtime_error("Unsupported system");
+			}
+		}
+
+		static std::size_t GetTowMs(const GpsEphemeris& current_ephemeris) {
+			return static_cast<std::size_t>(current_ephemeris.tow * 1000);
+		}
+
+		static std::size_t GetTowMs(const GlonassEphemeris& current_ephemeris) {
+			return static_cast<std::size_t>((current_ephemeris.tk - 3 * 60 * 60 + 18) * 1000);
+		}
+
+		// the candidates before the last lookahead epochs of the history had all the bits they need, so they were checked for good
+		static std::size_t GetPreambleLookahead(System system) {
+			switch (system) {
+			case (System::Gps):
+				return 1501 * 20;
+			case (System::Glonass):
+				return 30000 + 300;
 			default:
 				throw std::runtime_error("Unsupported system");
 			}
@@ -326,13 +380,13 @@ namespace ugsdr {
 
 		void UpdatePseudorangeGps() {
 			for (std::size_t i = 0; i < pseudorange.size(); ++i)
-				pseudorange[i] += time_scale[i] - (static_cast<std::ptrdiff_t>(i) - preamble_position + std::get<GpsEphemeris>(ephemeris).tow * 1000 + 2);
+				pseudorange[i] += time_scale[i] - (static_cast<double>(static_cast<std::ptrdiff_t>(i) - preamble_position) + std::get<GpsEphemeris>(ephemeris).tow * 1000 + 2);
 		}
 
 		void UpdatePseudorangeGlonass(std::size_t day_offset) {
 			double tk_gps_ms = (std::get<GlonassEphemeris>(ephemeris).tk - 3.0 * 60 * 60 + 18 + day_offset * 86400) * 1000;
 			for (std::size_t i = 0; i < pseudorange.size(); ++i)
-				pseudorange[i] += time_scale[i] - (static_cast<std::ptrdiff_t>(i) - static_cast<double>(preamble_position) + tk_gps_ms + 2);
+				pseudorange[i] += time_scale[i] - (static_cast<double>(static_cast<std::ptrdiff_t>(i) - preamble_position) + tk_gps_ms + 2);
 		}
 
 	public:
@@ -343,7 +397,9 @@ namespace ugsdr {
 		std::vector<double> snr;
 		std::variant<GpsEphemeris, GlonassEphemeris> ephemeris;
 		TimeScale& time_scale;
-		std::size_t preamble_position = std::numeric_limits<std::size_t>::max();
+		// relative to the first epoch of the history, negative once the preamble is dropped from the sliding window
+		std::ptrdiff_t preamble_position = std::numeric_limits<std::ptrdiff_t>::max();
+		std::int32_t pseudorange_offset = 0;
 
 		template <TrackingParametersConfigConcept Config, typename T>
 		static void MakeObservable(const TrackingParameters<Config, T>& tracking_result, TimeScale& receiver_time_scale, std::vector<Observable>& observables) {
@@ -357,10 +413,50 @@ namespace ugsdr {
 					observables.push_back(std::move(optional_obs.value()));
 			}
 			else 
-				observables.push_back(Observable(tracking_result, receiver_time_scale, previous_satellite->preamble_position, previous_satellite->ephemeris));
+				observables.push_back(Observable(tracking_result, receiver_time_scale, previous_satellite->preamble_position, previous_satellite->pseudorange_offset, previous_satellite->ephemeris));
 			
 		}
 
+		// Sliding window of the single-pass receiver: the navigation decoded in the previous windows is reused, the preambles
+		// of the remaining channels are searched only among the candidates that weren't checked yet
+		template <TrackingParametersConfigConcept Config, typename T>
+		static void MakeObservable(const TrackingParameters<Config, T>& tracking_result, TimeScale& receiver_time_scale, std::vector<Observable>& observables,
+			NavigationState& navigation_state) {
+			auto previous_satellite = std::find_if(observables.begin(), observables.end(), [sv = tracking_result.sv](Observable& obs) {
+				return (sv.system == obs.sv.system) && (sv.id == obs.sv.id) && (sv.signal != obs.sv.signal);
+			});
+			if (previous_satellite != observables.end()) {
+				observables.push_back(Observable(tracking_result, receiver_time_scale, previous_satellite->preamble_position, previous_satellite->pseudorange_offset, previous_satellite->ephemeris));
+				return;
+			}
+
+			const auto first_epoch = GetFirstEpoch(tracking_result);
+			const auto history_length = tracking_result.prompt.size();
+			auto& decoded = navigation_state.decoded;
+			const auto is_outdated = decoded.has_value() && static_cast<std::ptrdiff_t>(first_epoch) - decoded->preamble_epoch > NavigationState::refresh_ms;
+			if (!decoded.has_value() || is_outdated) {
+				const auto first_position = navigation_state.search_epoch > first_epoch ? navigation_state.search_epoch - first_epoch : 0;
+				auto optional_obs = FindPreamble(tracking_result, receiver_time_scale, first_position);
+				if (optional_obs.has_value()) {
+					decoded = DecodedNavigation{ static_cast<std::ptrdiff_t>(first_epoch) + optional_obs->preamble_position, optional_obs->pseudorange_offset, optional_obs->ephemeris };
+					navigation_state.search_epoch = static_cast<std::size_t>(decoded->preamble_epoch) + 1;
+					observables.push_back(std::move(optional_obs.value()));
+					return;
+				}
+
+				const auto lookahead = std::min(history_length, GetPreambleLookahead(tracking_result.sv.system));
+				navigation_state.search_epoch = std::max(navigation_state.search_epoch, first_epoch + history_length - lookahead);
+				if (!decoded.has_value())
+					return;
+			}
+
+			const auto position = decoded->preamble_epoch - static_cast<std::ptrdiff_t>(first_epoch);
+			std::visit([&](const auto& current_ephemeris) {
+				receiver_time_scale.UpdateScale(position, GetTowMs(current_ephemeris), tracking_result.sv.system);
+			}, decoded->ephemeris);
+			observables.push_back(Observable(tracking_result, receiver_time_scale, position, decoded->pseudorange_offset, decoded->ephemeris));
+		}
+
 		void UpdatePseudoranges(std::size_t day_offset) {
 			switch (sv.system) {
 			case (System::Gps):
@@ -12,14 +12,15 @@ namespace ugsdr {
 		std::vector<double> time_ms;
 		std::vector<double> system_time_ms;
 		bool is_corrected = false;
-		std::size_t last_preable_position = 0;		
+		std::ptrdiff_t last_preable_position = 0;		
 
 	public:
 		TimeScale(std::size_t ms_cnt = 0) : time_ms(ms_cnt), system_time_ms(ms_cnt) {
 			std::iota(time_ms.begin(), time_ms.end(), 0.0);
 		}
 
-		void UpdateScale(std::size_t preable_position, std::size_t tow_ms, System system) {
+		// the preamble position is relative to the first epoch of the scale and may precede it
+		void UpdateScale(std::ptrdiff_t preable_position, std::size_t tow_ms, System system) {
 			if (is_corrected && system == System::Glonass)
 				return;
 
@@ -27,7 +28,7 @@ namespace ugsdr {
 				return;
 
 			auto initial_ms_offset = 70;
-			auto current_offset = static_cast<double>(tow_ms + initial_ms_offset - preable_position);
+			auto current_offset = static_cast<double>(tow_ms + initial_ms_offset) - static_cast<double>(preable_position);
 			std::iota(time_ms.begin(), time_ms.end(), current_offset);
 			std::transform(std::execution::par_unseq, time_ms.begin(), time_ms.end(), system_time_ms.begin(),
 				[initial_ms_offset](auto& val) {return val - initial_ms_offset + 2; });
@@ -80,6 +80,19 @@ namespace ugsdr {
 			ippsMul_16sc_ISfs(c_exp.data(), reinterpret_cast<Ipp16sc*>(src_dst.data()), static_cast<int>(src_dst.size()), 8);
 		}
 
+		// real input is multiplied by the complex tone directly
+		static void ProcessReal(const std::vector<float>& src, double sampling_freq, double frequency, double phase, std::vector<std::complex<float>>& dst) {
+			float scale = 1.0;
+
+			thread_local std::vector<Ipp32fc> c_exp(src.size());
+			CheckResize(c_exp, src.size());
+			float phase_float = static_cast<float>(phase);
+			ippsTone_32fc(c_exp.data(), static_cast<int>(c_exp.size()), scale, static_cast<Ipp32f>(frequency / sampling_freq), &phase_float, IppHintAlgorithm::ippAlgHintFast);
+
+			CheckResize(dst, src.size());
+			ippsMul_32f32fc(src.data(), c_exp.data(), reinterpret_cast<Ipp32fc*>(dst.data()), static_cast<int>(src.size()));
+		}
+
 		template <typename T>
 		static auto Process(const std::vector<T>& src, double sampling_freq, double frequency, double phase = 0) {
 			auto dst = src;
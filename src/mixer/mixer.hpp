@@ -4,6 +4,8 @@
 
 #include <cmath>
 #include <complex>
+#include <concepts>
+#include <cstdint>
 #include <execution>
 #include <limits>
 #include <numbers>
@@ -16,6 +18,7 @@ namespace ugsdr {
 		double sampling_rate = 0.0;
 		double mixer_frequency = 0.0;
 		double mixer_phase = 0.0;
+		std::uint64_t translated_samples = 0;
 
 		template <typename T>
 		static void FixPhase(T& phase) {
@@ -50,13 +53,37 @@ namespace ugsdr {
 			return MixerImpl::Process(src, sampling_freq, frequency, phase);
 		}
 
+		// continues from the end of the previous block, the blocks may be of any length
 		template <ComplexContainer T>
 		void Translate(T& src_dst) {
-			Translate(src_dst, sampling_rate, mixer_frequency, mixer_phase);
-			auto phase_mod = std::fmod(mixer_frequency / 1000.0, 1.0);
-			if (phase_mod < 0)
-				phase_mod += 1;
-			mixer_phase += 2 * std::numbers::pi_v<double> * phase_mod;
+			Translate(src_dst, translated_samples);
+			translated_samples += src_dst.size();
+		}
+
+		// the phase of the first sample is derived from its absolute index, so the blocks may be translated in any order
+		template <ComplexContainer T>
+		void Translate(T& src_dst, std::uint64_t first_sample) {
+			const auto cycles = std::fmod(mixer_frequency / sampling_rate * static_cast<double>(first_sample), 1.0);
+			Translate(src_dst, sampling_rate, mixer_frequency, mixer_phase + 2 * std::numbers::pi_v<double> * cycles);
+		}
+
+		// real samples are mixed straight into the complex dst, the implementations without the real input support
+		// translate the promoted copy
+		template <std::floating_point UnderlyingType>
+		void Translate(const std::vector<UnderlyingType>& src, std::uint64_t first_sample, std::vector<std::complex<UnderlyingType>>& dst) {
+			const auto cycles = std::fmod(mixer_frequency / sampling_rate * static_cast<double>(first_sample), 1.0);
+			auto phase = mixer_phase + 2 * std::numbers::pi_v<double> * cycles;
+			FixPhase(phase);
+			auto frequency = mixer_frequency < 0 ? sampling_rate + mixer_frequency : mixer_frequency;
+
+			if constexpr (requires { MixerImpl::ProcessReal(src, sampling_rate, frequency, phase, dst); }) {
+				if (std::abs(mixer_frequency) != 0.0) {
+					MixerImpl::ProcessReal(src, sampling_rate, frequency, phase, dst);
+					return;
+				}
+			}
+			dst.assign(src.begin(), src.end());
+			Translate(dst, sampling_rate, mixer_frequency, phase);
 		}
 
 		auto GetFrequency() const {
@@ -65,6 +92,7 @@ namespace ugsdr {
 
 		void SetPhase(double phase) {
 			mixer_phase = phase;
+			translated_samples = 0;
 		}
 	};
 
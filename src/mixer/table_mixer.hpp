@@ -14,6 +14,7 @@
 
 #include <array>
 #include <cmath>
+#include <concepts>
 #include <numbers>
 
 #ifdef HAS_IPP
@@ -100,6 +101,31 @@ namespace ugsdr {
 #endif
 		}
 
+		// real input: two real products per sample instead of the complex one
+		template <std::floating_point UnderlyingType>
+		static void ProcessReal(const std::vector<UnderlyingType>& src, double sampling_freq, double frequency, double phase, std::vector<std::complex<UnderlyingType>>& dst) {
+			constexpr std::size_t phase_bits = 6;
+			constexpr std::size_t nco_bits = 32;
+
+			GCEM_CONSTEXPR auto table = GetSinCosTable<phase_bits, UnderlyingType>();
+			NumericallyControlledOscillator<nco_bits> nco(sampling_freq, frequency, phase);
+
+			CheckResize(dst, src.size());
+			auto dst_ptr = reinterpret_cast<UnderlyingType*>(dst.data());
+			for (std::size_t i = 0; i < src.size(); ++i) {
+				const auto complex_exp = GetComplexExp<phase_bits>(table, nco);
+				dst_ptr[2 * i] = src[i] * complex_exp.real();
+				dst_ptr[2 * i + 1] = src[i] * complex_exp.imag();
+			}
+		}
+
+		template <typename UnderlyingType>
+		static auto Process(const std::vector<std::complex<UnderlyingType>>& src, double sampling_freq, double frequency, double phase = 0) {
+			auto dst = src;
+			Process(dst, sampling_freq, frequency, phase);
+			return dst;
+		}
+
 	public:
 		TableMixer(double sampling_freq, double frequency, double phase) : Mixer<TableMixer>(sampling_freq, frequency, phase) {}
 	};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace ugsdr {
+	// Spreading code with one bit per sample, the set bit stands for -1. Time-multiplexed codes (L2CM with the CL slots)
+	// additionally keep the plane of the non-zero samples, the other codes don't allocate it
+	class PackedCode final {
+	public:
+		using WordType = std::uint64_t;
+		constexpr static inline std::size_t word_bits = 64;
+
+	private:
+		// one zero word past the end, so the unaligned reads of the last word don't need the bounds check
+		std::vector<WordType> signs;
+		std::vector<WordType> non_zero;
+		std::size_t samples = 0;
+
+		static auto GetWord(const std::vector<WordType>& plane, std::size_t offset) {
+			const auto word = offset / word_bits;
+			const auto shift = offset % word_bits;
+			if (shift == 0)
+				return plane[word];
+			return (plane[word] >> shift) | (plane[word + 1] << (word_bits - shift));
+		}
+
+	public:
+		PackedCode() = default;
+
+		template <typename T>
+		explicit PackedCode(std::span<const T> code) : signs(code.size() / word_bits + 2), samples(code.size()) {
+			for (std::size_t i = 0; i < code.size(); ++i) {
+				const auto bit = WordType{ 1 } << (i % word_bits);
+				if (code[i] == static_cast<T>(-1))
+					signs[i / word_bits] |= bit;
+				else if (code[i] == static_cast<T>(0)) {
+					if (non_zero.empty())
+						non_zero.assign(signs.size(), ~WordType{ 0 });
+					non_zero[i / word_bits] &= ~bit;
+				}
+				else if (code[i] != static_cast<T>(1))
+					throw std::runtime_error("Only the binary codes are packed");
+			}
+		}
+
+		template <typename T>
+		explicit PackedCode(const std::vector<T>& code) : PackedCode(std::span<const T>(code)) {}
+
+		auto size() const {
+			return samples;
+		}
+
+		bool HasZeros() const {
+			return !non_zero.empty();
+		}
+
+		// word_bits consecutive samples starting at offset, the caller masks the bits past the end
+		auto GetSigns(std::size_t offset) const {
+			return GetWord(signs, offset);
+		}
+
+		auto GetNonZero(std::size_t offset) const {
+			return non_zero.empty() ? ~WordType{ 0 } : GetWord(non_zero, offset);
+		}
+
+		template <typename T>
+		T Get(std::size_t index) const {
+			const auto bit = WordType{ 1 } << (index % word_bits);
+			if (!non_zero.empty() && !(non_zero[index / word_bits] & bit))
+				return static_cast<T>(0);
+			return static_cast<T>((signs[index / word_bits] & bit) ? -1 : 1);
+		}
+
+		auto GetBytes() const {
+			return (signs.size() + non_zero.size()) * sizeof(WordType);
+		}
+	};
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../acquisition/acquisition_result.hpp"
+#include "../dfe/dfe.hpp"
+#include "../measurements/measurement_engine.hpp"
+#include "../positioning/standalone_rtklib.hpp"
+#include "../tracking/tracker.hpp"
+#include "../tracking/tracking_parameters.hpp"
+
+#include "boost/timer/progress_display.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace ugsdr {
+	struct PositionSolution {
+		std::size_t epoch = 0;
+		double x = 0.0;
+		double y = 0.0;
+		double z = 0.0;
+		double clock_bias = 0.0;
+	};
+
+	// Tracks the signal epoch by epoch and keeps only a sliding window of the tracking history.
+	// The observables and the position are resolved every step_ms, as soon as enough ephemerides are decoded.
+	// The decoded navigation is kept between the steps, so the preambles are searched only among the new bits.
+	// window_ms of history is enough to decode the ephemeris, the oldest step_ms epochs are dropped past it
+	template <TrackingParametersConfigConcept TrParamsConfig = DefaultTrackingParametersConfig, ChannelConfigConcept ChConfig = DefaultChannelConfig, typename UnderlyingType = float>
+	class SinglePassReceiver final {
+	public:
+		using ObservablesCallback = std::function<void(std::size_t, const std::vector<obsd_t>&, const nav_t*)>;
+		using PositionCallback = std::function<void(const PositionSolution&)>;
+
+		// two GPS preambles 6 s apart plus 1501 bits of the ephemeris take ~42 s, same goes for the GLONASS time marks 30 s apart plus 5 strings
+		constexpr static inline std::size_t default_window_ms = 48000;
+		// one GPS subframe
+		constexpr static inline std::size_t default_step_ms = 6000;
+		constexpr static inline std::size_t default_output_step_ms = 1000;
+		constexpr static inline std::size_t min_observables = 4;
+
+	private:
+		DigitalFrontend<ChConfig, UnderlyingType>& digital_frontend;
+		std::vector<AcquisitionResult<UnderlyingType>> acquisition_results;
+		Tracker<TrParamsConfig, ChConfig, UnderlyingType> tracker;
+		std::vector<NavigationState> navigation_states;
+
+		std::size_t window_ms = default_window_ms;
+		std::size_t step_ms = default_step_ms;
+		std::size_t output_step_ms = default_output_step_ms;
+
+		std::size_t current_epoch = 0;
+		std::size_t next_output_epoch = 0;
+		bool is_resolved = false;
+
+		ObservablesCallback observables_callback;
+		PositionCallback position_callback;
+
+		auto GetHistoryLength() const {
+			const auto& tracking_parameters = tracker.GetTrackingParameters();
+			return tracking_parameters.empty() ? std::size_t{ 0 } : tracking_parameters.front().prompt.size();
+		}
+
+		void ProcessWindow() {
+			const auto& tracking_parameters = tracker.GetTrackingParameters();
+			const auto history_length = GetHistoryLength();
+			if (history_length == 0)
+				return;
+
+			auto measurement_engine = MeasurementEngine(tracking_parameters, navigation_states);
+			if (measurement_engine.observables.size() < min_observables)
+				return;
+
+			is_resolved = true;
+			auto positioning_engine = StandaloneRtklib(measurement_engine);
+
+			const auto window_start = current_epoch - history_length;
+			if (next_output_epoch < window_start)
+				next_output_epoch += (window_start - next_output_epoch + output_step_ms - 1) / output_step_ms * output_step_ms;
+
+			for (; next_output_epoch < current_epoch; next_output_epoch += output_step_ms) {
+				const auto epoch = next_output_epoch - window_start;
+				if (observables_callback) {
+					auto [obs, nav] = measurement_engine.GetMeasurementEpoch(epoch);
+					observables_callback(next_output_epoch, obs, nav);
+				}
+
+				auto [x, y, z, clock_bias] = positioning_engine.EstimatePosition(epoch);
+				if (position_callback)
+					position_callback(PositionSolution{ next_output_epoch, x, y, z, clock_bias });
+			}
+		}
+
+	public:
+		SinglePassReceiver(DigitalFrontend<ChConfig, UnderlyingType>& dfe, std::vector<AcquisitionResult<UnderlyingType>> acquisition_dst,
+			std::size_t window = default_window_ms, std::size_t step = default_step_ms, std::size_t output_step = default_output_step_ms) :
+			digital_frontend(dfe), acquisition_results(std::move(acquisition_dst)), tracker(digital_frontend, acquisition_results),
+			window_ms(window), step_ms(step), output_step_ms(output_step) {
+			if (step_ms == 0 || step_ms > window_ms)
+				throw std::runtime_error("Window step should be in (0, window]");
+			if (output_step_ms == 0)
+				throw std::runtime_error("Output step can't be zero");
+
+			tracker.SetHistoryDepth(window_ms);
+		}
+
+		void SetObservablesCallback(ObservablesCallback callback) {
+			observables_callback = std::move(callback);
+		}
+
+		void SetPositionCallback(PositionCallback callback) {
+			position_callback = std::move(callback);
+		}
+
+		void ProcessEpoch() {
+			tracker.TrackEpoch(digital_frontend.GetEpoch(current_epoch++));
+			if (current_epoch % step_ms != 0)
+				return;
+
+			ProcessWindow();
+			if (GetHistoryLength() >= window_ms)
+				tracker.DiscardHistory(step_ms);
+		}
+
+		void Process(std::size_t epochs_to_process) {
+			auto timer = boost::timer::progress_display(static_cast<unsigned long>(epochs_to_process));
+
+			digital_frontend.StartPrefetch(current_epoch, epochs_to_process);
+			for (std::size_t i = 0; i < epochs_to_process; ++i, ++timer)
+				ProcessEpoch();
+			digital_frontend.StopPrefetch();
+		}
+
+		// resolve the epochs left in the incomplete window, e.g. at the end of the file
+		void Flush() {
+			if (next_output_epoch < current_epoch)
+				ProcessWindow();
+		}
+
+		auto IsResolved() const {
+			return is_resolved;
+		}
+
+		auto GetCurrentEpoch() const {
+			return current_epoch;
+		}
+
+		const auto& GetTrackingParameters() const {
+			return tracker.GetTrackingParameters();
+		}
+	};
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../helpers/is_complex.hpp"
+#include "resampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <numeric>
+#include <span>
+#include <tuple>
+#include <vector>
+
+namespace ugsdr {
+	// Filter bank of a single rational L/M stage. The prototype filter runs at the interpolated rate and is split into
+	// the phases, so only the taps that hit the non-zero input samples are evaluated for every output sample
+	template <typename UnderlyingType>
+	class PolyphaseFilterBank final {
+	private:
+		// more phases than that are quantized, the timing error doesn't exceed 1/max_phases of the input sample
+		constexpr static inline std::size_t max_phases = 4096;
+		// taps per phase for the interpolation, the decimation scales it with the ratio to keep the transition band
+		constexpr static inline std::size_t half_taps = 8;
+		// ~60 dB stop band attenuation
+		constexpr static inline double kaiser_beta = 5.65;
+
+		std::size_t interpolation = 1;
+		std::size_t phases = 1;
+		std::size_t taps_per_phase = 1;
+		std::size_t delay = 0;
+		// every phase is stored reversed, so the output is the dot product with the consecutive input samples
+		std::vector<UnderlyingType> coefficients;
+
+		static auto BesselI0(double x) {
+			auto sum = 1.0;
+			auto term = 1.0;
+			for (std::size_t k = 1; term > 1e-12 * sum; ++k) {
+				term *= (x / (2 * static_cast<double>(k))) * (x / (2 * static_cast<double>(k)));
+				sum += term;
+			}
+			return sum;
+		}
+
+		void SetPrototype(const std::vector<double>& prototype) {
+			coefficients.resize(phases * taps_per_phase);
+			for (std::size_t phase = 0; phase < phases; ++phase)
+				for (std::size_t tap = 0; tap < taps_per_phase; ++tap)
+					coefficients[phase * taps_per_phase + tap] = static_cast<UnderlyingType>(prototype[phase + (taps_per_phase - 1 - tap) * phases]);
+		}
+
+		PolyphaseFilterBank() = default;
+
+	public:
+		// Kaiser windowed sinc with the cutoff at the half of the lower sampling rate
+		static auto MakeLowpass(std::size_t interpolation, std::size_t decimation) {
+			auto dst = PolyphaseFilterBank();
+			dst.interpolation = interpolation;
+			dst.phases = std::min(interpolation, max_phases);
+			const auto ratio = std::max(1.0, static_cast<double>(decimation) / static_cast<double>(interpolation));
+			dst.taps_per_phase = 2 * static_cast<std::size_t>(std::ceil(half_taps * ratio));
+			dst.delay = dst.taps_per_phase / 2;
+
+			const auto len = dst.phases * dst.taps_per_phase;
+			const auto center = static_cast<double>(len / 2);
+			const auto cutoff = 0.5 / (static_cast<double>(dst.phases) * ratio);
+			auto prototype = std::vector<double>(len);
+			for (std::size_t i = 0; i < len; ++i) {
+				const auto t = static_cast<double>(i) - center;
+				const auto sinc = t == 0 ? 1.0 : std::sin(2 * std::numbers::pi * cutoff * t) / (2 * std::numbers::pi * cutoff * t);
+				const auto window_arg = std::max(0.0, 1 - (t / center) * (t / center));
+				prototype[i] = sinc * BesselI0(kaiser_beta * std::sqrt(window_arg)) / BesselI0(kaiser_beta);
+			}
+
+			// unit gain of every phase
+			const auto gain = std::accumulate(prototype.begin(), prototype.end(), 0.0) / static_cast<double>(dst.phases);
+			for (auto& el : prototype)
+				el /= gain;
+
+			dst.SetPrototype(prototype);
+			return dst;
+		}
+
+		// CIC (sinc^order) decimator in the non-recursive form: there are no integrators to drift in the floating point.
+		// The group delay is an integer number of samples for the even orders only
+		static auto MakeCic(std::size_t decimation, std::size_t order) {
+			auto prototype = std::vector<double>{ 1.0 };
+			for (std::size_t stage = 0; stage < order; ++stage) {
+				auto next = std::vector<double>(prototype.size() + decimation - 1);
+				for (std::size_t i = 0; i < prototype.size(); ++i)
+					for (std::size_t j = 0; j < decimation; ++j)
+						next[i + j] += prototype[i] / static_cast<double>(decimation);
+				prototype = std::move(next);
+			}
+
+			auto dst = PolyphaseFilterBank();
+			dst.taps_per_phase = prototype.size();
+			dst.delay = prototype.size() / 2;
+			dst.SetPrototype(prototype);
+			return dst;
+		}
+
+		// the banks depend only on the rate pair, so they are designed once and shared by all the channels and threads
+		static std::shared_ptr<const PolyphaseFilterBank> GetLowpass(std::size_t interpolation, std::size_t decimation) {
+			return GetCached(0, interpolation, decimation, [&] { return MakeLowpass(interpolation, decimation); });
+		}
+
+		static std::shared_ptr<const PolyphaseFilterBank> GetCic(std::size_t decimation, std::size_t order) {
+			return GetCached(1, decimation, order, [&] { return MakeCic(decimation, order); });
+		}
+
+		template <typename Fn>
+		static std::shared_ptr<const PolyphaseFilterBank> GetCached(std::size_t kind, std::size_t lhs, std::size_t rhs, Fn&& make) {
+			static std::mutex m;
+			static std::map<std::tuple<std::size_t, std::size_t, std::size_t>, std::shared_ptr<const PolyphaseFilterBank>> cache;
+
+			auto lock = std::unique_lock(m);
+			auto& dst = cache[std::make_tuple(kind, lhs, rhs)];
+			if (!dst)
+				dst = std::make_shared<const PolyphaseFilterBank>(make());
+			return dst;
+		}
+
+		auto GetTapsPerPhase() const {
+			return taps_per_phase;
+		}
+
+		// group delay in the input samples
+		auto GetDelay() const {
+			return delay;
+		}
+
+		// phase is the fractional output time in the 1/interpolation input sample units, window holds the taps_per_phase
+		// input samples that end with the last one at or before the output
+		template <typename T>
+		T Filter(const T* window, std::size_t phase) const {
+			const auto bank_phase = phases == interpolation ? phase : phase * phases / interpolation;
+			const auto taps = coefficients.data() + bank_phase * taps_per_phase;
+			// independent partial sums of the interleaved components, a single accumulator chain is bound by the
+			// latency of the addition and std::complex arithmetic isn't vectorized
+			constexpr std::size_t components = is_complex_v<T> ? 2 : 1;
+			constexpr std::size_t partial_sums = 8;
+			constexpr std::size_t taps_per_step = partial_sums / components;
+			const auto window_ptr = reinterpret_cast<const UnderlyingType*>(window);
+			UnderlyingType sums[partial_sums] = {};
+			std::size_t i = 0;
+			for (; i + taps_per_step <= taps_per_phase; i += taps_per_step)
+				for (std::size_t j = 0; j < partial_sums; ++j)
+					sums[j] += window_ptr[i * components + j] * taps[i + j / components];
+			for (; i < taps_per_phase; ++i)
+				for (std::size_t k = 0; k < components; ++k)
+					sums[k] += window_ptr[i * components + k] * taps[i];
+
+			for (std::size_t step = partial_sums / 2; step >= components; step /= 2)
+				for (std::size_t j = 0; j < step; ++j)
+					sums[j] += sums[j + step];
+			if constexpr (is_complex_v<T>)
+				return T(sums[0], sums[1]);
+			else
+				return sums[0];
+		}
+	};
+
+	// Single rational stage. Process() is the streaming form: the delay line and the fractional output position are
+	// carried between the calls, so consecutive blocks of any length give the same samples as the whole record.
+	// ProcessCentered() compensates the group delay of the stateless record and doesn't touch the state
+	template <typename T>
+	class PolyphaseStage final {
+	private:
+		using BankType = PolyphaseFilterBank<underlying_t<T>>;
+
+		std::shared_ptr<const BankType> bank;
+		std::size_t interpolation = 1;
+		std::size_t decimation = 1;
+
+		std::vector<T> delay_line;
+		std::size_t position = 0;
+
+		// returns the position of the next output sample, the positions are advanced without the divisions
+		template <typename Fn>
+		auto FilterBlock(const std::vector<T>& block, std::size_t first_position, std::size_t end_position, Fn&& output) const {
+			auto sample = first_position / interpolation;
+			auto phase = first_position % interpolation;
+			const auto sample_step = decimation / interpolation;
+			const auto phase_step = decimation % interpolation;
+			for (auto current_position = first_position; current_position < end_position; current_position += decimation) {
+				output(bank->Filter(block.data() + sample, phase));
+				sample += sample_step;
+				phase += phase_step;
+				if (phase >= interpolation) {
+					phase -= interpolation;
+					++sample;
+				}
+			}
+			return sample * interpolation + phase;
+		}
+
+	public:
+		PolyphaseStage() = default;
+		PolyphaseStage(std::shared_ptr<const BankType> filter_bank, std::size_t interpolation_factor, std::size_t decimation_factor) :
+			bank(std::move(filter_bank)), interpolation(interpolation_factor), decimation(decimation_factor),
+			delay_line(bank->GetTapsPerPhase() - 1) {}
+
+		void Process(std::span<const T> src, std::vector<T>& dst) {
+			const auto history = delay_line.size();
+			delay_line.insert(delay_line.end(), src.begin(), src.end());
+
+			const auto end_position = src.size() * interpolation;
+			dst.clear();
+			dst.reserve((end_position - std::min(end_position, position)) / decimation + 1);
+			position = FilterBlock(delay_line, position, end_position, [&dst](const T& val) { dst.push_back(val); }) - end_position;
+			delay_line.erase(delay_line.begin(), delay_line.end() - static_cast<std::ptrdiff_t>(history));
+		}
+
+		void ProcessCentered(std::span<const T> src, std::vector<T>& dst) const {
+			const auto history = bank->GetTapsPerPhase() - 1;
+			const auto delay = bank->GetDelay();
+			thread_local static std::vector<T> block;
+			block.assign(history, T{});
+			block.insert(block.end(), src.begin(), src.end());
+			block.resize(block.size() + delay + 1);
+
+			const auto output_samples = src.size() * interpolation / decimation;
+			CheckResize(dst, output_samples);
+			auto dst_ptr = dst.data();
+			const auto first_position = delay * interpolation;
+			FilterBlock(block, first_position, first_position + output_samples * decimation, [&dst_ptr](const T& val) { *dst_ptr++ = val; });
+		}
+
+		// the next output is computed at the position relative to the first sample of the next block
+		void Seek(std::size_t next_position) {
+			std::fill(delay_line.begin(), delay_line.end(), T{});
+			position = next_position;
+		}
+
+		void Reset() {
+			Seek(0);
+		}
+
+		auto GetInterpolation() const {
+			return interpolation;
+		}
+
+		auto GetDecimation() const {
+			return decimation;
+		}
+
+		auto GetTapsPerPhase() const {
+			return bank->GetTapsPerPhase();
+		}
+
+		auto GetDelay() const {
+			return bank->GetDelay();
+		}
+	};
+
+	// Rational L/M resampler: large decimation ratios are split into the CIC decimation by an integer factor, that
+	// leaves at least twice the output rate, and the polyphase low pass filter for the rest of the ratio.
+	// Nothing is computed or stored at the common multiple of the rates
+	template <typename T>
+	class MultistageResampler final {
+	private:
+		constexpr static inline std::size_t cic_min_ratio = 4;
+		constexpr static inline std::size_t cic_order = 4;
+		static_assert(cic_order % 2 == 0, "Odd order CIC has the fractional group delay");
+
+		bool passthrough = false;
+		bool has_cic = false;
+		PolyphaseStage<T> cic;
+		PolyphaseStage<T> lowpass;
+		std::vector<T> intermediate;
+
+		static auto GetCicRatio(std::size_t interpolation, std::size_t decimation) {
+			if (decimation < cic_min_ratio * interpolation)
+				return std::size_t{ 1 };
+			for (auto ratio = decimation / (2 * interpolation); ratio > 1; --ratio)
+				if (decimation % ratio == 0)
+					return ratio;
+			return std::size_t{ 1 };
+		}
+
+		// first sample at the input rate of the low pass stage that affects the output sample
+		std::uint64_t GetFirstIntermediate(std::uint64_t output_sample) const {
+			const auto last_intermediate = (output_sample * lowpass.GetDecimation() + lowpass.GetDelay() * lowpass.GetInterpolation()) / lowpass.GetInterpolation();
+			const auto lowpass_window = static_cast<std::uint64_t>(lowpass.GetTapsPerPhase() - 1);
+			return last_intermediate > lowpass_window ? last_intermediate - lowpass_window : 0;
+		}
+
+	public:
+		MultistageResampler() = default;
+		MultistageResampler(std::size_t new_sampling_rate, std::size_t old_sampling_rate) {
+			if (new_sampling_rate == 0 || old_sampling_rate == 0)
+				throw std::runtime_error("Sampling rate can't be zero");
+
+			const auto gcd = std::gcd(new_sampling_rate, old_sampling_rate);
+			const auto interpolation = new_sampling_rate / gcd;
+			auto decimation = old_sampling_rate / gcd;
+			passthrough = interpolation == decimation;
+			if (passthrough)
+				return;
+
+			const auto cic_ratio = GetCicRatio(interpolation, decimation);
+			has_cic = cic_ratio != 1;
+			if (has_cic) {
+				cic = PolyphaseStage<T>(PolyphaseFilterBank<underlying_t<T>>::GetCic(cic_ratio, cic_order), 1, cic_ratio);
+				decimation /= cic_ratio;
+			}
+			lowpass = PolyphaseStage<T>(PolyphaseFilterBank<underlying_t<T>>::GetLowpass(interpolation, decimation), interpolation, decimation);
+		}
+
+		void Process(std::span<const T> src, std::vector<T>& dst) {
+			if (passthrough) {
+				dst.assign(src.begin(), src.end());
+				return;
+			}
+			if (!has_cic) {
+				lowpass.Process(src, dst);
+				return;
+			}
+			cic.Process(src, intermediate);
+			lowpass.Process(intermediate, dst);
+		}
+
+		void ProcessCentered(std::span<const T> src, std::vector<T>& dst) const {
+			if (passthrough) {
+				dst.assign(src.begin(), src.end());
+				return;
+			}
+			if (!has_cic) {
+				lowpass.ProcessCentered(src, dst);
+				return;
+			}
+			thread_local static std::vector<T> cic_dst;
+			cic.ProcessCentered(src, cic_dst);
+			lowpass.ProcessCentered(cic_dst, dst);
+		}
+
+		void Reset() {
+			cic.Reset();
+			lowpass.Reset();
+		}
+
+		// Delay compensated streaming: the output sample k corresponds to the input time k * M / L. These are the input
+		// samples past the time of the output sample that are required to compute it
+		std::size_t GetLookahead() const {
+			if (passthrough)
+				return 0;
+			const auto cic_ratio = has_cic ? cic.GetDecimation() : 1;
+			const auto cic_delay = has_cic ? cic.GetDelay() : 0;
+			return (lowpass.GetDelay() + 1) * cic_ratio + cic_delay;
+		}
+
+		// earliest input sample that affects the output sample
+		std::uint64_t GetFirstInput(std::uint64_t output_sample) const {
+			if (passthrough)
+				return output_sample;
+			const auto first_intermediate = GetFirstIntermediate(output_sample);
+			if (!has_cic)
+				return first_intermediate;
+			const auto cic_window = static_cast<std::uint64_t>(cic.GetTapsPerPhase() - 1);
+			const auto last_input = first_intermediate * cic.GetDecimation() + cic.GetDelay();
+			return last_input > cic_window ? last_input - cic_window : 0;
+		}
+
+		// prepares the state to produce output_sample first, when the input is fed starting from first_input,
+		// which mustn't be later than GetFirstInput(output_sample). The result doesn't depend on the earlier blocks
+		void Seek(std::uint64_t output_sample, std::uint64_t first_input) {
+			if (passthrough)
+				return;
+			if (first_input > GetFirstInput(output_sample))
+				throw std::runtime_error("Resampler input starts after the requested output");
+
+			const auto lowpass_position = output_sample * lowpass.GetDecimation() + lowpass.GetDelay() * lowpass.GetInterpolation();
+			if (!has_cic) {
+				lowpass.Seek(static_cast<std::size_t>(lowpass_position - first_input * lowpass.GetInterpolation()));
+				return;
+			}
+			const auto first_intermediate = GetFirstIntermediate(output_sample);
+			cic.Seek(static_cast<std::size_t>(first_intermediate * cic.GetDecimation() + cic.GetDelay() - first_input));
+			lowpass.Seek(static_cast<std::size_t>(lowpass_position - first_intermediate * lowpass.GetInterpolation()));
+		}
+	};
+
+	class PolyphaseResampler : public Resampler<PolyphaseResampler> {
+	protected:
+		friend class Resampler<PolyphaseResampler>;
+
+		template <typename T>
+		static void Process(std::vector<T>& src_dst, std::size_t new_sampling_rate, std::size_t old_sampling_rate) {
+			thread_local static std::vector<T> dst;
+			MultistageResampler<T>(new_sampling_rate, old_sampling_rate).ProcessCentered(src_dst, dst);
+			src_dst.swap(dst);
+		}
+
+	public:
+	};
+}
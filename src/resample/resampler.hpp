@@ -3,6 +3,7 @@
 #include "../common.hpp"
 
 #include <cmath>
+#include <numeric>
 #include <vector>
 #include "decimator.hpp"
 #include "upsampler.hpp"
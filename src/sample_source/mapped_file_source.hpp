@@ -0,0 +1,32 @@
+#pragma once
+
+#include "sample_source.hpp"
+
+#include "boost/iostreams/device/mapped_file.hpp"
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace ugsdr {
+	class MappedFileSource final : public SampleSource {
+	private:
+		boost::iostreams::mapped_file_source signal_file;
+
+	public:
+		MappedFileSource(const std::filesystem::path& path) {
+			signal_file.open(path.string());
+			if (!signal_file.is_open())
+				throw std::runtime_error("Unable to open file");
+		}
+
+		virtual void Read(std::size_t offset, std::size_t length, const ReadCallback& fn) override {
+			if (offset + length > signal_file.size())
+				throw std::runtime_error("Exceeding file size");
+			fn(signal_file.data() + offset);
+		}
+
+		virtual std::optional<std::size_t> size() const override {
+			return signal_file.size();
+		}
+	};
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "sample_source.hpp"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ugsdr {
+	// recording that is already in memory, e.g. received by the other means or generated
+	class MemorySource final : public SampleSource {
+	private:
+		std::vector<char> data;
+
+	public:
+		MemorySource(std::vector<char> src) : data(std::move(src)) {}
+
+		virtual void Read(std::size_t offset, std::size_t length, const ReadCallback& fn) override {
+			if (offset + length > data.size())
+				throw std::runtime_error("Exceeding buffer size");
+			fn(data.data() + offset);
+		}
+
+		virtual std::optional<std::size_t> size() const override {
+			return data.size();
+		}
+	};
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+
+namespace ugsdr {
+	// Raw bytes of the recording, the FileType decoders of the SignalParametersBase work on top of it
+	class SampleSource {
+	public:
+		using ReadCallback = std::function<void(const char*)>;
+
+		// calls fn with the pointer to [offset, offset + length) of the source, the pointer is valid only inside fn
+		virtual void Read(std::size_t offset, std::size_t length, const ReadCallback& fn) = 0;
+		// total size in bytes, live streams don't know it in advance
+		virtual std::optional<std::size_t> size() const = 0;
+		virtual ~SampleSource() {}
+	};
+}
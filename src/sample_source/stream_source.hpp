@@ -0,0 +1,218 @@
+#pragma once
+
+#include "sample_source.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ugsdr {
+	// Live stream from a pipe/FIFO, stdin or a local socket, received by a background thread into a ring buffer.
+	// The ring provides the backpressure: while it's full of the bytes that weren't requested yet, the descriptor
+	// isn't read, so the kernel buffer fills up and the writer blocks instead of losing the samples (UDP datagrams
+	// are dropped by the kernel in that case). The bytes before the last request stay in the ring until they are
+	// overwritten, so the acquisition and the tracking may both start from the same epoch
+	class StreamSource final : public SampleSource {
+	private:
+		constexpr static inline int poll_timeout_ms = 100;
+
+		int fd = -1;
+		bool owns_fd = true;
+
+		std::vector<char> ring;
+		std::size_t begin_offset = 0;		// oldest byte that is still in the ring
+		std::size_t end_offset = 0;			// next byte to be received
+		std::size_t released_offset = 0;	// bytes before it may be overwritten
+		bool end_of_stream = false;
+		bool stop = false;
+		std::exception_ptr receiver_error;
+
+		std::vector<char> wrapped_data;
+		std::mutex read_mutex;
+		std::mutex m;
+		std::condition_variable cv;
+		std::thread receiver_thread;
+
+		// a request far ahead releases everything received so far, the receiver skips the bytes up to it
+		std::size_t GetUnreleasedBytes() const {
+			return end_offset > released_offset ? end_offset - released_offset : 0;
+		}
+
+		void ReceiveChunk(std::unique_lock<std::mutex>& lock) {
+			const auto ring_position = end_offset % ring.size();
+			const auto chunk = std::min(ring.size() - ring_position, ring.size() - GetUnreleasedBytes());
+			if (end_offset + chunk > ring.size())
+				begin_offset = std::max(begin_offset, end_offset + chunk - ring.size());
+			lock.unlock();
+
+			// poll with the timeout, so the destructor doesn't wait for the silent stream forever
+			auto poll_fd = pollfd{ fd, POLLIN, 0 };
+			const auto ready = poll(&poll_fd, 1, poll_timeout_ms);
+			if (ready < 0 && errno != EINTR)
+				throw std::runtime_error("Unable to poll stream");
+
+			auto bytes_read = ssize_t{ 0 };
+			if (ready > 0) {
+				bytes_read = read(fd, ring.data() + ring_position, chunk);
+				if (bytes_read < 0 && errno != EINTR && errno != EAGAIN)
+					throw std::runtime_error("Unable to read stream");
+			}
+
+			lock.lock();
+			if (ready > 0 && bytes_read == 0)
+				end_of_stream = true;
+			else if (bytes_read > 0)
+				end_offset += static_cast<std::size_t>(bytes_read);
+			cv.notify_all();
+		}
+
+		void Receive() {
+			auto lock = std::unique_lock(m);
+			try {
+				while (true) {
+					cv.wait(lock, [this] { return stop || GetUnreleasedBytes() < ring.size(); });
+					if (stop || end_of_stream)
+						return;
+
+					ReceiveChunk(lock);
+				}
+			}
+			catch (...) {
+				if (!lock.owns_lock())
+					lock.lock();
+				receiver_error = std::current_exception();
+				cv.notify_all();
+			}
+		}
+
+	public:
+		constexpr static inline std::size_t default_ring_size = 64 << 20;
+
+		StreamSource(int descriptor, std::size_t ring_size = default_ring_size, bool take_ownership = true) :
+			fd(descriptor), owns_fd(take_ownership), ring(ring_size) {
+			if (fd < 0)
+				throw std::runtime_error("Invalid stream descriptor");
+			if (ring.empty())
+				throw std::runtime_error("Stream buffer can't be empty");
+
+			receiver_thread = std::thread(&StreamSource::Receive, this);
+		}
+
+		StreamSource(const StreamSource&) = delete;
+		StreamSource& operator=(const StreamSource&) = delete;
+
+		virtual ~StreamSource() override {
+			{
+				auto lock = std::unique_lock(m);
+				stop = true;
+			}
+			cv.notify_all();
+			if (receiver_thread.joinable())
+				receiver_thread.join();
+			if (owns_fd)
+				close(fd);
+		}
+
+		// named pipe (FIFO) the grabber writes to, blocks until the writer opens it
+		static auto OpenPipe(const std::filesystem::path& path, std::size_t ring_size = default_ring_size) {
+			auto descriptor = open(path.c_str(), O_RDONLY);
+			if (descriptor < 0)
+				throw std::runtime_error("Unable to open pipe");
+			return std::make_shared<StreamSource>(descriptor, ring_size);
+		}
+
+		static auto OpenStdin(std::size_t ring_size = default_ring_size) {
+			return std::make_shared<StreamSource>(STDIN_FILENO, ring_size, false);
+		}
+
+		// loopback TCP server, e.g. the grabber or a stand-in for it
+		static auto ConnectTcp(std::uint16_t port, std::size_t ring_size = default_ring_size) {
+			auto descriptor = socket(AF_INET, SOCK_STREAM, 0);
+			if (descriptor < 0)
+				throw std::runtime_error("Unable to create socket");
+
+			auto address = sockaddr_in{};
+			address.sin_family = AF_INET;
+			address.sin_port = htons(port);
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			if (connect(descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+				close(descriptor);
+				throw std::runtime_error("Unable to connect to the stream");
+			}
+			return std::make_shared<StreamSource>(descriptor, ring_size);
+		}
+
+		// datagrams sent to the loopback port, in the order of arrival
+		static auto BindUdp(std::uint16_t port, std::size_t ring_size = default_ring_size) {
+			auto descriptor = socket(AF_INET, SOCK_DGRAM, 0);
+			if (descriptor < 0)
+				throw std::runtime_error("Unable to create socket");
+
+			auto address = sockaddr_in{};
+			address.sin_family = AF_INET;
+			address.sin_port = htons(port);
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			if (bind(descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+				close(descriptor);
+				throw std::runtime_error("Unable to bind the stream socket");
+			}
+			return std::make_shared<StreamSource>(descriptor, ring_size);
+		}
+
+		// waits for the requested bytes, everything before offset is released for the new data
+		virtual void Read(std::size_t offset, std::size_t length, const ReadCallback& fn) override {
+			auto read_lock = std::unique_lock(read_mutex);
+			auto lock = std::unique_lock(m);
+			if (length > ring.size())
+				throw std::runtime_error("Request exceeds the stream buffer");
+			if (offset < begin_offset)
+				throw std::runtime_error("Requested samples were already discarded");
+
+			released_offset = offset;
+			cv.notify_all();
+			cv.wait(lock, [&] { return end_offset >= offset + length || end_of_stream || receiver_error; });
+			if (end_offset < offset + length) {
+				if (receiver_error)
+					std::rethrow_exception(receiver_error);
+				throw std::runtime_error("End of stream");
+			}
+			lock.unlock();
+
+			// the receiver only writes after the released offset, so the requested bytes stay intact without the lock
+			const auto ring_position = offset % ring.size();
+			if (ring_position + length <= ring.size()) {
+				fn(ring.data() + ring_position);
+				return;
+			}
+
+			wrapped_data.resize(length);
+			const auto first_part = ring.size() - ring_position;
+			std::copy(ring.begin() + static_cast<std::ptrdiff_t>(ring_position), ring.end(), wrapped_data.begin());
+			std::copy(ring.begin(), ring.begin() + static_cast<std::ptrdiff_t>(length - first_part), wrapped_data.begin() + static_cast<std::ptrdiff_t>(first_part));
+			fn(wrapped_data.data());
+		}
+
+		virtual std::optional<std::size_t> size() const override {
+			return std::nullopt;
+		}
+	};
+}
+
+#endif
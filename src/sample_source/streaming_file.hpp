@@ -0,0 +1,169 @@
+#pragma once
+
+#include "sample_source.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define UGSDR_POSIX_FILE_IO
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace ugsdr {
+	struct StreamingOptions {
+		std::size_t window_epochs = 256;	// epochs read at once and kept in memory
+		bool direct_io = false;				// bypass the page cache completely (O_DIRECT), if the platform supports it
+	};
+
+	// Sequential reader of the recordings that are too large to be mapped. The file is read in large aligned chunks
+	// into a single window, the pages behind the window are dropped from the page cache and the next window is
+	// requested in advance, so the long captures don't evict everything else on the host
+	class StreamingFile final : public SampleSource {
+	private:
+		constexpr static inline std::size_t alignment = 4096;
+
+		struct AlignedDeleter {
+			void operator()(char* ptr) const {
+				::operator delete[](ptr, std::align_val_t{ alignment });
+			}
+		};
+
+		std::size_t file_size = 0;
+		std::size_t window_bytes = 0;
+		bool direct_io = false;
+
+		std::unique_ptr<char[], AlignedDeleter> buffer;
+		std::size_t buffer_capacity = 0;
+		std::size_t window_begin = 0;
+		std::size_t window_end = 0;
+		std::size_t dropped_until = 0;
+
+		std::mutex m;
+
+#ifdef UGSDR_POSIX_FILE_IO
+		int fd = -1;
+#else
+		std::ifstream file;
+#endif
+
+		static auto AlignDown(std::size_t value) {
+			return value / alignment * alignment;
+		}
+
+		static auto AlignUp(std::size_t value) {
+			return AlignDown(value + alignment - 1);
+		}
+
+#if defined(UGSDR_POSIX_FILE_IO) && defined(POSIX_FADV_NORMAL)
+		void Advise(std::size_t offset, std::size_t length, int advice) const {
+			if (length)
+				posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), advice);
+		}
+#endif
+
+		void ReadChunk(std::size_t offset, std::size_t length) {
+			if (buffer_capacity < length) {
+				buffer.reset(static_cast<char*>(::operator new[](length, std::align_val_t{ alignment })));
+				buffer_capacity = length;
+			}
+
+#ifdef UGSDR_POSIX_FILE_IO
+			std::size_t bytes_read = 0;
+			while (bytes_read < length) {
+				auto current_read = pread(fd, buffer.get() + bytes_read, length - bytes_read, static_cast<off_t>(offset + bytes_read));
+				if (current_read < 0)
+					throw std::runtime_error("Unable to read file");
+				if (current_read == 0)
+					break;
+				bytes_read += static_cast<std::size_t>(current_read);
+			}
+#else
+			file.clear();
+			file.seekg(static_cast<std::streamoff>(offset));
+			file.read(buffer.get(), static_cast<std::streamsize>(length));
+			auto bytes_read = static_cast<std::size_t>(file.gcount());
+#endif
+			window_begin = offset;
+			window_end = offset + bytes_read;
+		}
+
+		void Refill(std::size_t offset, std::size_t length) {
+			const auto chunk_begin = AlignDown(offset);
+			const auto chunk_end = std::min(AlignUp(std::max(offset + length, chunk_begin + window_bytes)), AlignUp(file_size));
+			ReadChunk(chunk_begin, chunk_end - chunk_begin);
+			if (window_end < offset + length)
+				throw std::runtime_error("Exceeding file size");
+
+			if (direct_io)
+				return;
+#if defined(UGSDR_POSIX_FILE_IO) && defined(POSIX_FADV_NORMAL)
+			// everything behind the cursor won't be required anymore, the next window will be
+			if (dropped_until < chunk_begin) {
+				Advise(dropped_until, chunk_begin - dropped_until, POSIX_FADV_DONTNEED);
+				dropped_until = chunk_begin;
+			}
+			Advise(window_end, std::min(window_bytes, file_size - std::min(file_size, window_end)), POSIX_FADV_WILLNEED);
+#endif
+		}
+
+	public:
+		StreamingFile(const std::filesystem::path& path, std::size_t window_size_bytes, bool use_direct_io) :
+			file_size(static_cast<std::size_t>(std::filesystem::file_size(path))),
+			window_bytes(AlignUp(std::max<std::size_t>(window_size_bytes, 1))) {
+#ifdef UGSDR_POSIX_FILE_IO
+#ifdef O_DIRECT
+			if (use_direct_io) {
+				fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+				direct_io = fd >= 0;
+			}
+#endif
+			if (fd < 0)
+				fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw std::runtime_error("Unable to open file");
+#ifdef POSIX_FADV_SEQUENTIAL
+			Advise(0, file_size, POSIX_FADV_SEQUENTIAL);
+#endif
+#else
+			static_cast<void>(use_direct_io);
+			file.open(path, std::ios::binary);
+			if (!file.is_open())
+				throw std::runtime_error("Unable to open file");
+#endif
+		}
+
+		StreamingFile(const StreamingFile&) = delete;
+		StreamingFile& operator=(const StreamingFile&) = delete;
+
+		virtual ~StreamingFile() override {
+#ifdef UGSDR_POSIX_FILE_IO
+			if (fd >= 0)
+				close(fd);
+#endif
+		}
+
+		virtual void Read(std::size_t offset, std::size_t length, const ReadCallback& fn) override {
+			auto lock = std::unique_lock(m);
+			if (offset < window_begin || offset + length > window_end)
+				Refill(offset, length);
+
+			fn(buffer.get() + (offset - window_begin));
+		}
+
+		virtual std::optional<std::size_t> size() const override {
+			return file_size;
+		}
+	};
+}
+
+#undef UGSDR_POSIX_FILE_IO
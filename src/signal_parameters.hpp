@@ -1,15 +1,22 @@
 #pragma once
 
+#include <algorithm>
 #include <complex>
-#include <execution>
 #include <filesystem>
 #include <fstream>
-
-#include "boost/iostreams/device/mapped_file.hpp"
+#include <limits>
+#include <memory>
+#include <optional>
+#include <type_traits>
 
 #include "common.hpp"
-#include "helpers/BbpPackedSpan.hpp"
-#include "helpers/NtlabPackedSpan.hpp"
+#include "helpers/is_complex.hpp"
+#include "helpers/packed_decoder.hpp"
+#include "sample_source/mapped_file_source.hpp"
+#include "sample_source/memory_source.hpp"
+#include "sample_source/sample_source.hpp"
+#include "sample_source/stream_source.hpp"
+#include "sample_source/streaming_file.hpp"
 
 #ifdef HAS_IPP
 
@@ -41,14 +48,17 @@ namespace ugsdr {
 		std::size_t number_of_epochs = 0;
 		std::size_t epoch_size_bytes = 0;
 
-		boost::iostreams::mapped_file_source signal_file;
+		// shared, so the copies of the parameters read the same file or stream
+		std::shared_ptr<SampleSource> sample_source;
+		// the mapped file is verified as a whole on open
+		bool headers_verified = false;
 
 		using OutputVectorType = std::vector<std::complex<UnderlyingType>>;
 		
-		void VerifyHeaders() const {
-			auto last_header = *reinterpret_cast<const std::uint64_t*>(signal_file.data()) & ((1 << 24) - 1);
-			for (std::size_t i = 1; i < number_of_epochs; ++i) {
-				auto ptr = reinterpret_cast<const std::uint64_t*>(signal_file.data() + epoch_size_bytes * i);
+		void VerifyHeaders(const char* data, std::size_t epochs) const {
+			auto last_header = *reinterpret_cast<const std::uint64_t*>(data) & ((1 << 24) - 1);
+			for (std::size_t i = 1; i < epochs; ++i) {
+				auto ptr = reinterpret_cast<const std::uint64_t*>(data + epoch_size_bytes * i);
 				auto header = *ptr & ((1 << 24) - 1);
 				if (header - last_header != 1)
 					throw std::runtime_error("Header ms count mismatch");
@@ -56,24 +66,34 @@ namespace ugsdr {
 			}
 		}
 
-		void OpenFile() {
-			signal_file.open(signal_file_path.string());
-			if (!signal_file.is_open())
-				throw std::runtime_error("Unable to open file");
+		std::size_t GetSampleSizeBytes() const {
+			switch (file_type) {
+			case FileType::Iq_8_plus_8:
+				return sizeof(std::complex<std::int8_t>);
+			case FileType::Iq_16_plus_16:
+				return sizeof(std::complex<std::int16_t>);
+			case FileType::Real_8:
+			case FileType::Nt1065GrabberFirst:
+			case FileType::Nt1065GrabberSecond:
+			case FileType::Nt1065GrabberThird:
+			case FileType::Nt1065GrabberFourth:
+				return sizeof(std::int8_t);
+			default:
+				throw std::runtime_error("Unexpected file type");
+			}
+		}
 
+		void SetFileLayout(std::optional<std::size_t> source_size) {
 			switch (file_type) {
 			case FileType::Iq_8_plus_8:
-				number_of_epochs = static_cast<std::size_t>(signal_file.size() / (sampling_rate / 1e3) / sizeof(std::complex<std::int8_t>));
-				break;
 			case FileType::Iq_16_plus_16:
-				number_of_epochs = static_cast<std::size_t>(signal_file.size() / (sampling_rate / 1e3) / sizeof(std::complex<std::int16_t>));
-				break;
 			case FileType::Real_8:
 			case FileType::Nt1065GrabberFirst:
 			case FileType::Nt1065GrabberSecond:
 			case FileType::Nt1065GrabberThird:
 			case FileType::Nt1065GrabberFourth:
-				number_of_epochs = static_cast<std::size_t>(signal_file.size() / (sampling_rate / 1e3));
+				if (source_size)
+					number_of_epochs = static_cast<std::size_t>(*source_size / (sampling_rate / 1e3) / GetSampleSizeBytes());
 				break;
 			case FileType::BbpDdc: {
 				auto epoch_size_words = sampling_rate / 1e3 * 4 / 64 + 1; // 2+2 samples in 64-bit words plus header
@@ -81,14 +101,36 @@ namespace ugsdr {
 				if (std::fmod(epoch_size_words, 2.0))
 					epoch_size_bytes += 2;
 				epoch_size_bytes *= 8;
-				number_of_epochs = signal_file.size() / epoch_size_bytes;
-				VerifyHeaders();
-
+				if (source_size)
+					number_of_epochs = *source_size / epoch_size_bytes;
 				break;
 			}
 			default:
 				throw std::runtime_error("Unexpected file type");
 			}
+
+			// live streams are unbounded, they end with an exception on read
+			if (!source_size)
+				number_of_epochs = std::numeric_limits<std::size_t>::max();
+		}
+
+		void OpenFile() {
+			sample_source = std::make_shared<MappedFileSource>(signal_file_path);
+			SetFileLayout(sample_source->size());
+			if (file_type == FileType::BbpDdc)
+				sample_source->Read(0, number_of_epochs * epoch_size_bytes, [this](const char* data) {
+					VerifyHeaders(data, number_of_epochs);
+				});
+			headers_verified = true;
+		}
+
+		void OpenStreamingFile(const StreamingOptions& options) {
+			if (!std::filesystem::exists(signal_file_path))
+				throw std::runtime_error("Unable to open file");
+
+			SetFileLayout(static_cast<std::size_t>(std::filesystem::file_size(signal_file_path)));
+			const auto epoch_size = file_type == FileType::BbpDdc ? epoch_size_bytes : static_cast<std::size_t>(sampling_rate / 1e3) * GetSampleSizeBytes();
+			sample_source = std::make_shared<StreamingFile>(signal_file_path, epoch_size * options.window_epochs, options.direct_io);
 		}
 
 #ifdef HAS_IPP
@@ -124,124 +166,65 @@ namespace ugsdr {
 		}
 #endif
 
-#ifdef HAS_IPP
-		void GetPartialSignalNt1065(int bit_shift, std::size_t length_samples, std::size_t samples_offset, OutputVectorType& dst) {
-			static thread_local std::vector<std::int8_t> unpacked_data;
-			CheckResize(unpacked_data, length_samples);
-			auto ptr = reinterpret_cast<const Ipp8u*>(signal_file.data()) + samples_offset; // 4.9 n
-			ippsRShiftC_8u(ptr, bit_shift, reinterpret_cast<Ipp8u*>(unpacked_data.data()), static_cast<int>(unpacked_data.size())); // 1250n
-			ippsAndC_8u_I(0x3, reinterpret_cast<Ipp8u*>(unpacked_data.data()), static_cast<int>(unpacked_data.size()));				// 2406n
-
-			ippsReplaceC_8u(reinterpret_cast<Ipp8u*>(unpacked_data.data()), reinterpret_cast<Ipp8u*>(unpacked_data.data()), static_cast<int>(unpacked_data.size()), 0, 0xff); // 4200n
-			ippsReplaceC_8u(reinterpret_cast<Ipp8u*>(unpacked_data.data()), reinterpret_cast<Ipp8u*>(unpacked_data.data()), static_cast<int>(unpacked_data.size()), 2, 0xfd); // 6000n
-
-			static thread_local std::vector<std::int16_t> pseudo_complex_data;
-			CheckResize(pseudo_complex_data, length_samples);
-			ippsConvert_8s16s(unpacked_data.data(), pseudo_complex_data.data(), static_cast<int>(unpacked_data.size()));	//8000n
-			ippsAndC_16u_I(0x00FF, reinterpret_cast<std::uint16_t*>(pseudo_complex_data.data()), static_cast<int>(pseudo_complex_data.size()));	//9800n
-
-			CheckResize(dst, length_samples);
-		
-			auto convert_wrapper = GetConvertWrapper();
-			convert_wrapper(reinterpret_cast<const int8_t*>(pseudo_complex_data.data()), reinterpret_cast<UnderlyingType*>(dst.data()), static_cast<int>(length_samples) * 2); //21000n
+		// floating point samples are converted by IPP (if available), the integer front end just widens them
+		template <typename SrcT, typename T>
+		static void ConvertSamples(const SrcT* src, T* dst, std::size_t size) {
+			if constexpr (std::is_floating_point_v<T>) {
+				auto convert_wrapper = GetConvertWrapper();
+				convert_wrapper(src, dst, static_cast<int>(size));
+			}
+			else
+				std::copy(src, src + size, dst);
 		}
-#endif
 
-		void GetPartialSignal(std::size_t length_samples, std::size_t samples_offset, OutputVectorType& dst) {
+		// data points to the first requested sample, or to the header of the first requested epoch for BBP
+		template <typename T>
+		void DecodeSignal(const char* data, std::size_t length_samples, std::vector<std::complex<T>>& dst) const {
 			switch (file_type) {
-			case FileType::Iq_8_plus_8: {
-				auto ptr_start = signal_file.data() + samples_offset * sizeof(std::complex<std::int8_t>);
+			case FileType::Iq_8_plus_8:
 				CheckResize(dst, length_samples);
-
-				auto convert_wrapper = GetConvertWrapper();
-				convert_wrapper(reinterpret_cast<const int8_t*>(ptr_start), reinterpret_cast<UnderlyingType*>(dst.data()), static_cast<int>(dst.size()) * 2);
+				ConvertSamples(reinterpret_cast<const std::int8_t*>(data), reinterpret_cast<T*>(dst.data()), dst.size() * 2);
 				break;
-			}
-			case FileType::Iq_16_plus_16: {
-				auto ptr_start = signal_file.data() + samples_offset * sizeof(std::complex<std::int16_t>);
+			case FileType::Iq_16_plus_16:
 				CheckResize(dst, length_samples);
-
-				auto convert_wrapper = GetConvertWrapper();
-				convert_wrapper(reinterpret_cast<const int16_t*>(ptr_start), reinterpret_cast<UnderlyingType*>(dst.data()), static_cast<int>(dst.size()) * 2);
+				ConvertSamples(reinterpret_cast<const std::int16_t*>(data), reinterpret_cast<T*>(dst.data()), dst.size() * 2);
 				break;
-			}
 			case FileType::Real_8: {
-				auto ptr_start = signal_file.data() + samples_offset * sizeof(std::int8_t);
+				auto ptr_start = reinterpret_cast<const std::int8_t*>(data);
 				CheckResize(dst, length_samples);
 
 #ifdef HAS_IPP
-				static thread_local std::vector<UnderlyingType> local_data(length_samples); CheckResize(local_data, length_samples);
-				auto convert_wrapper = GetConvertWrapper();
-				convert_wrapper(reinterpret_cast<const int8_t*>(ptr_start), local_data.data(), static_cast<int>(dst.size()));
-
-				auto real_to_complex_wrapper = GetRealToComplexWrapper();
-				using IppType = typename IppTypeToComplex<UnderlyingType>::Type;
-				real_to_complex_wrapper(local_data.data(), nullptr, reinterpret_cast<IppType*>(dst.data()), static_cast<int>(length_samples));
-#else
-				std::copy(ptr_start, ptr_start + length_samples, dst.data());
+				if constexpr (std::is_floating_point_v<T>) {
+					static thread_local std::vector<T> local_data(length_samples); CheckResize(local_data, length_samples);
+					ConvertSamples(ptr_start, local_data.data(), length_samples);
+
+					auto real_to_complex_wrapper = GetRealToComplexWrapper();
+					using IppType = typename IppTypeToComplex<T>::Type;
+					real_to_complex_wrapper(local_data.data(), nullptr, reinterpret_cast<IppType*>(dst.data()), static_cast<int>(length_samples));
+					break;
+				}
 #endif
+				std::copy(ptr_start, ptr_start + length_samples, dst.data());
 				break;
 			}
-#ifdef HAS_IPP
-			case FileType::Nt1065GrabberFirst:
-			case FileType::Nt1065GrabberSecond:
-			case FileType::Nt1065GrabberThird:
-			case FileType::Nt1065GrabberFourth: 
-				GetPartialSignalNt1065(2 * (static_cast<int>(FileType::Nt1065GrabberFourth) - static_cast<int>(file_type)), length_samples, samples_offset, dst);
-				break;
-#else
 			case FileType::Nt1065GrabberFirst:
 			case FileType::Nt1065GrabberSecond:
 			case FileType::Nt1065GrabberThird:
 			case FileType::Nt1065GrabberFourth: {
 				CheckResize(dst, length_samples);
-				auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
-				auto epochs_offset = samples_offset / samples_per_ms;
-				auto length_epochs = length_samples / samples_per_ms;
-
-				for (std::size_t i = epochs_offset; i < epochs_offset + length_epochs; ++i) {
-					auto ptr = reinterpret_cast<const std::byte*>(signal_file.data() + epoch_size_bytes * i);
-
-					// Unfortunately, case argument isn't considered a compile-time variable
-					switch (file_type) {
-					case FileType::Nt1065GrabberFirst: {
-						auto packed_span = NtlabPackedSpan<6, UnderlyingType>(ptr, samples_per_ms);
-						std::copy(std::execution::par_unseq, packed_span.begin(), packed_span.end(), dst.begin() + samples_per_ms * (i - epochs_offset));
-						break;
-					}
-					case FileType::Nt1065GrabberSecond: {
-						auto packed_span = NtlabPackedSpan<4, UnderlyingType>(ptr, samples_per_ms);
-						std::copy(std::execution::par_unseq, packed_span.begin(), packed_span.end(), dst.begin() + samples_per_ms * (i - epochs_offset));
-						break;
-					}
-					case FileType::Nt1065GrabberThird: {
-						auto packed_span = NtlabPackedSpan<2, UnderlyingType>(ptr, samples_per_ms);
-						std::copy(std::execution::par_unseq, packed_span.begin(), packed_span.end(), dst.begin() + samples_per_ms * (i - epochs_offset));
-						break;
-					}
-					case FileType::Nt1065GrabberFourth: {
-						auto packed_span = NtlabPackedSpan<0, UnderlyingType>(ptr, samples_per_ms);
-						std::copy(std::execution::par_unseq, packed_span.begin(), packed_span.end(), dst.begin() + samples_per_ms * (i - epochs_offset));
-						break;
-					}
-					default:
-						break;
-					}
-				}
+				auto bit_offset = 2 * static_cast<std::size_t>(static_cast<int>(FileType::Nt1065GrabberFourth) - static_cast<int>(file_type));
+				DecodeNtlabPacked(bit_offset, reinterpret_cast<const std::byte*>(data), length_samples, dst.data());
 				break;
 			}
-#endif
 			case FileType::BbpDdc: {
 				CheckResize(dst, length_samples);
 				auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
-				auto epochs_offset = samples_offset / samples_per_ms;
 				auto length_epochs = length_samples / samples_per_ms;
 
-				for (std::size_t i = epochs_offset; i < epochs_offset + length_epochs; ++i) {
-					auto ptr = reinterpret_cast<const std::byte*>(signal_file.data() + epoch_size_bytes * i + 8);
+				for (std::size_t i = 0; i < length_epochs; ++i) {
+					auto ptr = reinterpret_cast<const std::byte*>(data + epoch_size_bytes * i + 8);
 
-					auto packed_span = PackedSpan<UnderlyingType>(ptr, samples_per_ms);
-					std::copy(std::execution::par_unseq, packed_span.begin(), packed_span.end(), dst.begin() + samples_per_ms * (i - epochs_offset));
+					DecodeBbpPacked(ptr, samples_per_ms, dst.data() + samples_per_ms * i);
 				}
 				break;
 			}
@@ -250,6 +233,53 @@ namespace ugsdr {
 			}
 		}
 
+		// real valued files are decoded as is, without the zero imaginary part
+		template <typename T>
+		void DecodeRealSignal(const char* data, std::size_t length_samples, std::vector<T>& dst) const {
+			switch (file_type) {
+			case FileType::Real_8:
+				CheckResize(dst, length_samples);
+				ConvertSamples(reinterpret_cast<const std::int8_t*>(data), dst.data(), length_samples);
+				break;
+			case FileType::Nt1065GrabberFirst:
+			case FileType::Nt1065GrabberSecond:
+			case FileType::Nt1065GrabberThird:
+			case FileType::Nt1065GrabberFourth: {
+				CheckResize(dst, length_samples);
+				auto bit_offset = 2 * static_cast<std::size_t>(static_cast<int>(FileType::Nt1065GrabberFourth) - static_cast<int>(file_type));
+				DecodeNtlabPacked(bit_offset, reinterpret_cast<const std::byte*>(data), length_samples, dst.data());
+				break;
+			}
+			default:
+				throw std::runtime_error("Complex data can't be read as real");
+			}
+		}
+
+		template <typename T>
+		void GetPartialSignal(std::size_t length_samples, std::size_t samples_offset, std::vector<T>& dst) {
+			std::size_t offset_bytes = 0;
+			std::size_t length_bytes = 0;
+			if (file_type == FileType::BbpDdc) {
+				auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
+				offset_bytes = samples_offset / samples_per_ms * epoch_size_bytes;
+				length_bytes = length_samples / samples_per_ms * epoch_size_bytes;
+			}
+			else {
+				offset_bytes = samples_offset * GetSampleSizeBytes();
+				length_bytes = length_samples * GetSampleSizeBytes();
+			}
+
+			sample_source->Read(offset_bytes, length_bytes, [&](const char* data) {
+				// the other sources can only be verified by the read
+				if (file_type == FileType::BbpDdc && !headers_verified && length_bytes)
+					VerifyHeaders(data, length_bytes / epoch_size_bytes);
+				if constexpr (is_complex_v<T>)
+					DecodeSignal(data, length_samples, dst);
+				else
+					DecodeRealSignal(data, length_samples, dst);
+			});
+		}
+
 	public:
 		SignalParametersBase(std::filesystem::path signal_file, FileType type, double central_freq, double sampling_freq) :
 			signal_file_path(std::move(signal_file)),
@@ -259,7 +289,30 @@ namespace ugsdr {
 			OpenFile();
 		}
 
-		void GetSeveralMs(std::size_t ms_offset, std::size_t ms_cnt, OutputVectorType& dst) {
+		// reads the file sequentially through a window instead of mapping it, for the captures larger than the address space
+		SignalParametersBase(std::filesystem::path signal_file, FileType type, double central_freq, double sampling_freq, const StreamingOptions& options) :
+			signal_file_path(std::move(signal_file)),
+			file_type(type),
+			central_frequency(central_freq),
+			sampling_rate(sampling_freq) {
+			OpenStreamingFile(options);
+		}
+
+		// the file type describes the format of the source, e.g. the live stream of the grabber
+		SignalParametersBase(std::shared_ptr<SampleSource> source, FileType type, double central_freq, double sampling_freq) :
+			file_type(type),
+			central_frequency(central_freq),
+			sampling_rate(sampling_freq),
+			sample_source(std::move(source)) {
+			if (!sample_source)
+				throw std::runtime_error("Sample source can't be empty");
+			SetFileLayout(sample_source->size());
+		}
+
+		// integral T is used by the fixed point front end, the samples are stored as is. Real T reads the real valued
+		// files (see IsDataReal) without promoting them to complex
+		template <typename T>
+		void GetSeveralMs(std::size_t ms_offset, std::size_t ms_cnt, std::vector<T>& dst) {
 			const auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1000);
 			if (ms_cnt + ms_offset > number_of_epochs)
 				throw std::runtime_error("Exceeding epoch requested");
@@ -288,6 +341,26 @@ namespace ugsdr {
 			return sampling_rate;
 		}
 
+		// width of the decoded integer samples including the sign
+		std::size_t GetSampleBits() const {
+			switch (file_type) {
+			case FileType::Iq_8_plus_8:
+			case FileType::Real_8:
+				return 8;
+			case FileType::Iq_16_plus_16:
+				return 16;
+			case FileType::Nt1065GrabberFirst:
+			case FileType::Nt1065GrabberSecond:
+			case FileType::Nt1065GrabberThird:
+			case FileType::Nt1065GrabberFourth:
+				return 3;
+			case FileType::BbpDdc:
+				return 2;
+			default:
+				throw std::runtime_error("Unexpected file type");
+			}
+		}
+
 		auto GetNumberOfEpochs() const {
 			return number_of_epochs;
 		}
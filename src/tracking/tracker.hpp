@@ -18,18 +18,22 @@
 
 #include "boost/timer/progress_display.hpp"
 
+#include <algorithm>
 #include <execution>
 #include <map>
 #include <numbers>
+#include <numeric>
 #include <span>
+#include <thread>
 #include <vector>
 
 namespace ugsdr {
-	template <ChannelConfigConcept ChConfig, typename UnderlyingType>
+	// Three code periods upsampled to the sampling rate of every signal, CodeType is PackedCode for the packed correlators
+	template <ChannelConfigConcept ChConfig, typename UnderlyingType, typename CodeType = std::vector<UnderlyingType>>
 	struct Codes final {
 	private:
 		using UpsamplerType = Upsampler<SequentialUpsampler>;
-		using MapType = std::map<Sv, std::vector<UnderlyingType>>;
+		using MapType = std::map<Sv, CodeType>;
 
 		constexpr static inline Sv glonass_sv = Sv{ 0, System::Glonass, Signal::GlonassCivilFdma_L1 };
 
@@ -45,8 +49,9 @@ namespace ugsdr {
 			auto offset = static_cast<std::int32_t>(ugsdr::GetSystemBySignal(signal) == System::Sbas ? ugsdr::sbas_sv_offset : 0);
 			for (std::int32_t i = offset; i < static_cast<std::int32_t>(offset + GetCodesCount(GetSystemBySignal(signal))); ++i) {
 				auto sv = Sv{ i, GetSystemBySignal(signal), signal };
-				codes[sv] = UpsamplerType::Transform(RepeatCodeNTimes(PrnGenerator<signal>::template Get<UnderlyingType>(i), 3),
+				auto code = UpsamplerType::Transform(RepeatCodeNTimes(PrnGenerator<signal>::template Get<UnderlyingType>(i), 3),
 					static_cast<std::size_t>(3 * PrnGenerator<signal>::GetNumberOfMilliseconds() * sampling_rate / 1e3));
+				codes[sv] = CodeType(std::move(code));
 			}
 		}
 
@@ -100,8 +105,9 @@ namespace ugsdr {
 		DigitalFrontend<ChConfig, UnderlyingType>& digital_frontend;
 		const std::vector<AcquisitionResult<UnderlyingType>>& acquisition_results;
 
-		Codes<ChConfig, UnderlyingType> codes;
+		Codes<ChConfig, UnderlyingType, CorrelatorCodeType<typename TrParamsConfig::CorrelatorType, UnderlyingType>> codes;
 		std::vector<TrackingParameters<TrParamsConfig, UnderlyingType>> tracking_parameters;
+		std::vector<SignalEpoch<UnderlyingType>> epoch_batch;
 
 #ifdef HAS_IPP
 		using MatchedFilterType = IppMatchedFilter;
@@ -116,28 +122,38 @@ namespace ugsdr {
 				TrackingParameters<TrParamsConfig, UnderlyingType>::FillTrackingParameters(el, digital_frontend, tracking_parameters);
 		}
 
-		auto GetEpl(TrackingParameters<TrParamsConfig, UnderlyingType>& parameters, double code_phase, double spacing_chips) {
-			auto& translated_signal = parameters.translated_signal;
-			MixerType::Translate(translated_signal, parameters.sampling_rate, -parameters.carrier_frequency, -parameters.carrier_phase);
-			parameters.UpdatePhase();
-			
+		auto GetEpl(TrackingParameters<TrParamsConfig, UnderlyingType>& parameters, const std::vector<std::complex<UnderlyingType>>& signal, double code_phase, double spacing_chips) {
 			const auto& full_code = codes.GetCode(parameters.sv);
 
 			auto spacing_offset = parameters.GetSamplesPerChip() * spacing_chips;
-						
-			auto output_array = std::array{
-				std::make_pair(code_phase + spacing_offset, std::complex<UnderlyingType>{}),
-				std::make_pair(code_phase, std::complex<UnderlyingType>{}),
-				std::make_pair(code_phase - spacing_offset, std::complex<UnderlyingType>{}),
+			auto code_phases = std::array{
+				code_phase + spacing_offset,
+				code_phase,
+				code_phase - spacing_offset
 			};
 
-			std::for_each(std::execution::par_unseq, output_array.begin(), output_array.end(), [&translated_signal, &full_code, &parameters, this](auto& pair) {
-				pair.second = parameters.CorrelateSplit(translated_signal, full_code, pair.first);
-			});
+			auto epl = std::array<std::complex<UnderlyingType>, 3>{};
+			if constexpr (TrackingParameters<TrParamsConfig, UnderlyingType>::fused_carrier_wipe_off)
+				epl = parameters.CorrelateSplitMultipleWithCarrier(signal, full_code, code_phases);
+			else {
+				auto copy_wrapper = GetCopyWrapper();
 
-			return std::make_tuple(output_array[0].second, output_array[1].second, output_array[2].second);
-		}
+#ifdef HAS_IPP
+				using IppType = typename IppTypeToComplex<UnderlyingType>::Type;
+#else
+				using IppType = std::complex<UnderlyingType>;
+#endif
+				auto& translated_signal = parameters.translated_signal;
+				CheckResize(translated_signal, signal.size());
+				copy_wrapper(reinterpret_cast<const IppType*>(signal.data()), reinterpret_cast<IppType*>(translated_signal.data()), static_cast<int>(signal.size()));
 
+				MixerType::Translate(translated_signal, parameters.sampling_rate, -parameters.carrier_frequency, -parameters.carrier_phase);
+				epl = parameters.CorrelateSplitMultiple(translated_signal, full_code, code_phases);
+			}
+			parameters.UpdatePhase();
+
+			return std::make_tuple(epl[0], epl[1], epl[2]);
+		}
 
 		static auto GetCopyWrapper() {
 #ifdef HAS_IPP
@@ -156,21 +172,12 @@ namespace ugsdr {
 		void TrackSingleSatellite(TrackingParameters<TrParamsConfig, UnderlyingType>& parameters, const SignalEpoch<UnderlyingType>& signal_epoch) {
 			const auto& signal = signal_epoch.GetSubband(parameters.sv.signal);
 
-			auto copy_wrapper = GetCopyWrapper();
-						
-#ifdef HAS_IPP
-			using IppType = typename IppTypeToComplex<UnderlyingType>::Type;
-#else
-			using IppType = std::complex<UnderlyingType>;
-#endif
-			CheckResize(parameters.translated_signal, signal.size());
-			copy_wrapper(reinterpret_cast<const IppType*>(signal.data()), reinterpret_cast<IppType*>(parameters.translated_signal.data()), static_cast<int>(signal.size()));
-
-			auto code_phase = parameters.code_phase - parameters.sampling_rate / 1e3 * (parameters.prompt.size() % parameters.GetCodePeriod());
-			auto [early, prompt, late] = GetEpl(parameters, code_phase, 0.25);
+			auto code_phase = parameters.code_phase - parameters.sampling_rate / 1e3 * (parameters.GetEpochsTracked() % parameters.GetCodePeriod());
+			auto [early, prompt, late] = GetEpl(parameters, signal, code_phase, 0.25);
 			parameters.early.push_back(early);
 			parameters.prompt.push_back(prompt);
 			parameters.late.push_back(late);
+			++parameters.epochs_tracked;
 
 			parameters.Pll(prompt);
 			parameters.Dll(early, late);
@@ -185,21 +192,61 @@ namespace ugsdr {
 
 		void Track(std::size_t epochs_to_process) {
 			auto timer = boost::timer::progress_display(static_cast<unsigned long>(epochs_to_process));
+			digital_frontend.StartPrefetch(0, epochs_to_process);
 
-			for (std::size_t i = 0; i < epochs_to_process; ++i, ++timer) {
-				auto& current_signal_ms = digital_frontend.GetEpoch(i);
-
-				std::for_each(std::execution::par_unseq, tracking_parameters.begin(), tracking_parameters.end(),
-					[&current_signal_ms, this](auto& current_tracking_parameters) {
-						TrackSingleSatellite(current_tracking_parameters, current_signal_ms);
-					});
+			if constexpr (TrParamsConfig::epoch_batch == 1) {
+				for (std::size_t i = 0; i < epochs_to_process; ++i, ++timer)
+					TrackEpoch(digital_frontend.GetEpoch(i));
+			}
+			else {
+				for (std::size_t i = 0; i < epochs_to_process; i += TrParamsConfig::epoch_batch) {
+					const auto batch_size = std::min(TrParamsConfig::epoch_batch, epochs_to_process - i);
+					epoch_batch.resize(batch_size);
+					for (std::size_t j = 0; j < batch_size; ++j)
+						digital_frontend.GetEpoch(i + j, epoch_batch[j]);
+
+					TrackEpochs(epoch_batch);
+					timer += static_cast<unsigned long>(batch_size);
+				}
 			}
+			digital_frontend.StopPrefetch();
+		}
+
+		// Every worker gets a fixed set of channels and tracks them through the whole batch,
+		// so the workers are joined once per batch instead of once per epoch
+		void TrackEpochs(std::span<const SignalEpoch<UnderlyingType>> signal_epochs) {
+			const auto workers = std::min<std::size_t>(tracking_parameters.size(), std::max(1u, std::thread::hardware_concurrency()));
+			std::vector<std::size_t> worker_indices(workers);
+			std::iota(worker_indices.begin(), worker_indices.end(), 0);
+
+			std::for_each(std::execution::par, worker_indices.begin(), worker_indices.end(), [&signal_epochs, workers, this](auto worker_index) {
+				for (auto i = worker_index; i < tracking_parameters.size(); i += workers)
+					for (const auto& signal_epoch : signal_epochs)
+						TrackSingleSatellite(tracking_parameters[i], signal_epoch);
+			});
+		}
+
+		void TrackEpoch(const SignalEpoch<UnderlyingType>& signal_epoch) {
+			std::for_each(std::execution::par_unseq, tracking_parameters.begin(), tracking_parameters.end(),
+				[&signal_epoch, this](auto& current_tracking_parameters) {
+					TrackSingleSatellite(current_tracking_parameters, signal_epoch);
+				});
+		}
+
+		void SetHistoryDepth(std::size_t epochs) {
+			for (auto& el : tracking_parameters)
+				el.SetHistoryDepth(epochs);
+		}
+
+		void DiscardHistory(std::size_t epochs) {
+			for (auto& el : tracking_parameters)
+				el.DiscardHistory(epochs);
 		}
 
 		void Plot() const {
 			for (auto& el : tracking_parameters) {
 				//ugsdr::Add(L"Early tracking result", el.early);
-				ugsdr::Add(static_cast<std::wstring>(el.sv) + L". Prompt tracking result", el.prompt);
+				ugsdr::Add(static_cast<std::wstring>(el.sv) + L". Prompt tracking result", std::vector(el.prompt.begin(), el.prompt.end()));
 				//ugsdr::Add(L"Late tracking result", el.late);
 			}			
 		}
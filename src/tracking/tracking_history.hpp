@@ -0,0 +1,420 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ugsdr {
+	enum class HistoryPolicy {
+		Full,		// everything is kept in memory
+		Ring,		// only the last depth epochs are kept
+		Spill		// the last depth epochs are kept in memory, the older ones go to a raw per-column file of depth-sized blocks
+	};
+
+	// Per-epoch tracking output (prompt, phases etc.) with a storage policy. Elements are addressed
+	// from the oldest available one and are returned by value, so the consumers use either the random
+	// access iterators or ForEachSpan for the contiguous blocks
+	template <typename T, HistoryPolicy policy = HistoryPolicy::Full>
+	class HistoryColumn final {
+		static_assert(std::is_trivially_copyable_v<T>, "History column elements are stored as raw bytes");
+
+	private:
+		constexpr static inline std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+		std::vector<T> data;
+		std::size_t depth = 0;
+		// ring: index of the oldest element and the number of elements in data
+		std::size_t head = 0;
+		std::size_t count = 0;
+		// spill: number of the spilled elements, logical start after the discards
+		std::size_t spilled = 0;
+		std::size_t first = 0;
+		std::filesystem::path spill_path;
+		// spill: the file is a ring of blocks, the blocks of the discarded chunks are reused by the next spills.
+		// chunk_blocks maps the chunks from the first kept one (first_chunk) to their blocks in the file
+		std::size_t first_chunk = 0;
+		std::deque<std::size_t> chunk_blocks;
+		std::vector<std::size_t> free_blocks;
+		std::size_t file_blocks = 0;
+
+		// spill: the file stays open while the column lives, the const readers share it and the last read chunk under the mutex
+		mutable std::fstream spill_file;
+		mutable std::mutex spill_mutex;
+		mutable std::vector<T> chunk;
+		mutable std::size_t chunk_index = npos;
+
+		static auto MakeSpillPath() {
+			static const auto session = std::random_device{}();
+			static std::atomic<std::size_t> counter = 0;
+			auto filename = "ugsdr_history_" + std::to_string(session) + "_" + std::to_string(counter++) + ".bin";
+			return std::filesystem::temp_directory_path() / filename;
+		}
+
+		void RemoveSpill() {
+			if (spill_path.empty())
+				return;
+
+			spill_file.close();
+			std::error_code ec;
+			std::filesystem::remove(spill_path, ec);
+			spill_path.clear();
+		}
+
+		void Spill() {
+			// chunks are always depth elements long, the ones discarded before the spill aren't written at all
+			if (first >= spilled + depth) {
+				spilled += depth;
+				first_chunk = spilled / depth;
+				data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(depth));
+				return;
+			}
+
+			if (spill_path.empty())
+				OpenSpill(MakeSpillPath());
+
+			auto block = file_blocks;
+			if (!free_blocks.empty()) {
+				block = free_blocks.back();
+				free_blocks.pop_back();
+			}
+			else
+				++file_blocks;
+
+			{
+				auto lock = std::unique_lock(spill_mutex);
+				spill_file.seekp(static_cast<std::streamoff>(block * depth * sizeof(T)));
+				spill_file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(depth * sizeof(T)));
+				if (!spill_file)
+					throw std::runtime_error("Unable to spill the tracking history to " + spill_path.string());
+			}
+
+			chunk_blocks.push_back(block);
+			spilled += depth;
+			data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(depth));
+		}
+
+		// the blocks of the chunks behind first are free
+		void ReleaseChunks() {
+			while (!chunk_blocks.empty() && first >= (first_chunk + 1) * depth) {
+				free_blocks.push_back(chunk_blocks.front());
+				chunk_blocks.pop_front();
+				++first_chunk;
+			}
+		}
+
+		void OpenSpill(std::filesystem::path path) {
+			spill_path = std::move(path);
+			if (!std::filesystem::exists(spill_path))
+				std::ofstream created(spill_path, std::ios::binary);
+			spill_file.open(spill_path, std::ios::binary | std::ios::in | std::ios::out);
+			if (!spill_file)
+				throw std::runtime_error("Unable to open the tracking history spill " + spill_path.string());
+		}
+
+		// has to be called under spill_mutex
+		void ReadChunk(std::size_t index, std::vector<T>& dst) const {
+			CheckResize(dst, depth);
+			spill_file.seekg(static_cast<std::streamoff>(chunk_blocks[index - first_chunk] * depth * sizeof(T)));
+			spill_file.read(reinterpret_cast<char*>(dst.data()), static_cast<std::streamsize>(depth * sizeof(T)));
+			if (!spill_file)
+				throw std::runtime_error("Unable to read the tracking history from " + spill_path.string());
+		}
+
+		T GetSpilled(std::size_t index) const {
+			auto lock = std::unique_lock(spill_mutex);
+			if (chunk_index != index / depth) {
+				chunk_index = npos;
+				ReadChunk(index / depth, chunk);
+				chunk_index = index / depth;
+			}
+			return chunk[index % depth];
+		}
+
+		auto GetChunk(std::size_t index) const {
+			std::vector<T> dst;
+			auto lock = std::unique_lock(spill_mutex);
+			if (chunk_index == index)
+				dst = chunk;
+			else
+				ReadChunk(index, dst);
+			return dst;
+		}
+
+		void Linearize(std::size_t new_depth) {
+			std::vector<T> values;
+			values.reserve(std::max(new_depth, count));
+			for (std::size_t i = count > new_depth ? count - new_depth : 0; i < count; ++i)
+				values.push_back(data[(head + i) % data.size()]);
+			count = values.size();
+			values.resize(new_depth);
+			data.swap(values);
+			head = 0;
+		}
+
+	public:
+		class Iterator final {
+		private:
+			const HistoryColumn* column = nullptr;
+			std::ptrdiff_t index = 0;
+
+		public:
+			using iterator_concept = std::random_access_iterator_tag;
+			using iterator_category = std::input_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using reference = T;
+			using pointer = void;
+
+			Iterator() = default;
+			Iterator(const HistoryColumn* column_ptr, std::ptrdiff_t position) : column(column_ptr), index(position) {}
+
+			T operator*() const { return (*column)[static_cast<std::size_t>(index)]; }
+			T operator[](difference_type offset) const { return (*column)[static_cast<std::size_t>(index + offset)]; }
+
+			Iterator& operator++() { ++index; return *this; }
+			Iterator operator++(int) { auto tmp = *this; ++index; return tmp; }
+			Iterator& operator--() { --index; return *this; }
+			Iterator operator--(int) { auto tmp = *this; --index; return tmp; }
+			Iterator& operator+=(difference_type offset) { index += offset; return *this; }
+			Iterator& operator-=(difference_type offset) { index -= offset; return *this; }
+
+			friend Iterator operator+(Iterator it, difference_type offset) { return it += offset; }
+			friend Iterator operator+(difference_type offset, Iterator it) { return it += offset; }
+			friend Iterator operator-(Iterator it, difference_type offset) { return it -= offset; }
+			friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) { return lhs.index - rhs.index; }
+
+			friend bool operator==(const Iterator& lhs, const Iterator& rhs) { return lhs.index == rhs.index; }
+			friend auto operator<=>(const Iterator& lhs, const Iterator& rhs) { return lhs.index <=> rhs.index; }
+		};
+
+		HistoryColumn() = default;
+		HistoryColumn(const HistoryColumn& rhs) : data(rhs.data), depth(rhs.depth), head(rhs.head), count(rhs.count), spilled(rhs.spilled), first(rhs.first),
+			first_chunk(rhs.first_chunk), chunk_blocks(rhs.chunk_blocks), free_blocks(rhs.free_blocks), file_blocks(rhs.file_blocks) {
+			if (!rhs.spill_path.empty()) {
+				auto path = MakeSpillPath();
+				{
+					auto lock = std::unique_lock(rhs.spill_mutex);
+					rhs.spill_file.flush();
+					std::filesystem::copy_file(rhs.spill_path, path);
+				}
+				OpenSpill(std::move(path));
+			}
+		}
+		HistoryColumn(HistoryColumn&& rhs) noexcept : data(std::move(rhs.data)), depth(rhs.depth), head(rhs.head), count(rhs.count),
+			spilled(rhs.spilled), first(rhs.first), spill_path(std::move(rhs.spill_path)), first_chunk(rhs.first_chunk),
+			chunk_blocks(std::move(rhs.chunk_blocks)), free_blocks(std::move(rhs.free_blocks)), file_blocks(rhs.file_blocks),
+			spill_file(std::move(rhs.spill_file)) {
+			rhs.spill_path.clear();
+		}
+		HistoryColumn& operator=(HistoryColumn rhs) noexcept {
+			std::swap(data, rhs.data);
+			std::swap(depth, rhs.depth);
+			std::swap(head, rhs.head);
+			std::swap(count, rhs.count);
+			std::swap(spilled, rhs.spilled);
+			std::swap(first, rhs.first);
+			std::swap(spill_path, rhs.spill_path);
+			std::swap(first_chunk, rhs.first_chunk);
+			std::swap(chunk_blocks, rhs.chunk_blocks);
+			std::swap(free_blocks, rhs.free_blocks);
+			std::swap(file_blocks, rhs.file_blocks);
+			spill_file.swap(rhs.spill_file);
+			chunk_index = npos;
+			return *this;
+		}
+		~HistoryColumn() {
+			RemoveSpill();
+		}
+
+		// full: capacity hint, ring: number of the stored epochs, spill: number of the epochs kept in memory
+		void SetDepth(std::size_t new_depth) {
+			if constexpr (policy == HistoryPolicy::Full) {
+				auto reserved = std::vector<T>();
+				reserved.reserve(std::max(new_depth, data.size()));
+				reserved.assign(data.begin(), data.end());
+				data.swap(reserved);
+			}
+			else if constexpr (policy == HistoryPolicy::Ring) {
+				if (new_depth == 0)
+					throw std::runtime_error("Ring history depth can't be zero");
+				Linearize(new_depth);
+			}
+			else {
+				if (new_depth == 0)
+					throw std::runtime_error("Spill history depth can't be zero");
+				if (spilled != 0 && new_depth != depth)
+					throw std::runtime_error("Spill history depth can't be changed after the first spill");
+				data.reserve(new_depth);
+			}
+			depth = new_depth;
+		}
+
+		auto GetDepth() const {
+			return depth;
+		}
+
+		std::size_t size() const {
+			if constexpr (policy == HistoryPolicy::Full)
+				return data.size();
+			else if constexpr (policy == HistoryPolicy::Ring)
+				return count;
+			else
+				return spilled + data.size() - first;
+		}
+
+		bool empty() const {
+			return size() == 0;
+		}
+
+		void push_back(const T& value) {
+			if constexpr (policy == HistoryPolicy::Full)
+				data.push_back(value);
+			else if constexpr (policy == HistoryPolicy::Ring) {
+				if (data.empty())
+					SetDepth(std::max<std::size_t>(depth, 1));
+				data[(head + count) % data.size()] = value;
+				if (count < data.size())
+					++count;
+				else
+					head = (head + 1) % data.size();
+			}
+			else {
+				if (depth == 0)
+					depth = 1;
+				data.push_back(value);
+				while (data.size() >= depth)
+					Spill();
+			}
+		}
+
+		T operator[](std::size_t index) const {
+			if constexpr (policy == HistoryPolicy::Full)
+				return data[index];
+			else if constexpr (policy == HistoryPolicy::Ring)
+				return data[(head + index) % data.size()];
+			else {
+				index += first;
+				if (index >= spilled)
+					return data[index - spilled];
+				return GetSpilled(index);
+			}
+		}
+
+		T front() const {
+			return (*this)[0];
+		}
+
+		T back() const {
+			return (*this)[size() - 1];
+		}
+
+		auto begin() const {
+			return Iterator(this, 0);
+		}
+
+		auto end() const {
+			return Iterator(this, static_cast<std::ptrdiff_t>(size()));
+		}
+
+		// calls fn with the contiguous blocks of the history, from the oldest to the newest
+		template <typename Fn>
+		void ForEachSpan(Fn&& fn) const {
+			if constexpr (policy == HistoryPolicy::Full)
+				fn(std::span<const T>(data));
+			else if constexpr (policy == HistoryPolicy::Ring) {
+				auto first_length = std::min(count, data.size() - head);
+				fn(std::span<const T>(data.data() + head, first_length));
+				if (first_length != count)
+					fn(std::span<const T>(data.data(), count - first_length));
+			}
+			else {
+				for (auto index = first; index < spilled; index = (index / depth + 1) * depth) {
+					const auto current_chunk = GetChunk(index / depth);
+					fn(std::span<const T>(current_chunk).subspan(index % depth));
+				}
+				auto offset = first > spilled ? first - spilled : 0;
+				fn(std::span<const T>(data).subspan(offset));
+			}
+		}
+
+		void CopyTo(std::vector<T>& dst) const {
+			dst.clear();
+			dst.reserve(size());
+			ForEachSpan([&dst](auto values) {
+				dst.insert(dst.end(), values.begin(), values.end());
+			});
+		}
+
+		// drops the oldest epochs
+		void Discard(std::size_t epochs) {
+			epochs = std::min(epochs, size());
+			if constexpr (policy == HistoryPolicy::Full)
+				data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(epochs));
+			else if constexpr (policy == HistoryPolicy::Ring) {
+				if (!data.empty())
+					head = (head + epochs) % data.size();
+				count -= epochs;
+			}
+			else {
+				first += epochs;
+				ReleaseChunks();
+			}
+		}
+
+		// spill: the file holds the blocks of the kept chunks and the free ones, it doesn't grow once the discards keep up
+		const auto& GetSpillPath() const {
+			return spill_path;
+		}
+
+		void clear() {
+			data.clear();
+			head = 0;
+			count = 0;
+			spilled = 0;
+			first = 0;
+			first_chunk = 0;
+			chunk_blocks.clear();
+			free_blocks.clear();
+			file_blocks = 0;
+			chunk_index = npos;
+			RemoveSpill();
+			if constexpr (policy == HistoryPolicy::Ring)
+				SetDepth(std::max<std::size_t>(depth, 1));
+		}
+
+		template <typename Archive>
+		void save(Archive& ar) const {
+#ifdef HAS_CEREAL
+			std::vector<T> values;
+			CopyTo(values);
+			ar(values);
+#endif
+		}
+
+		template <typename Archive>
+		void load(Archive& ar) {
+#ifdef HAS_CEREAL
+			std::vector<T> values;
+			ar(values);
+			clear();
+			for (const auto& el : values)
+				push_back(el);
+#endif
+		}
+	};
+}
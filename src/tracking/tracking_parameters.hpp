@@ -3,13 +3,31 @@
 #include "../common.hpp"
 #include "../acquisition/acquisition_result.hpp"
 #include "../correlator/correlator.hpp"
+#include "../correlator/fused_correlator.hpp"
 #include "../correlator/ipp_correlator.hpp"
+#include "../correlator/packed_correlator.hpp"
 #include "../dfe/dfe.hpp"
+#include "../matched_filter/matched_filter.hpp"
+#include "../matched_filter/ipp_matched_filter.hpp"
+#include "../math/abs.hpp"
+#include "../math/ipp_abs.hpp"
+#include "../math/reshape_and_sum.hpp"
+#include "../math/ipp_reshape_and_sum.hpp"
 #include "../mixer/table_mixer.hpp"
 #include "../mixer/ipp_mixer.hpp"
+#include "../prn_codes/codegen_wrapper.hpp"
+#include "../resample/upsampler.hpp"
+#include "tracking_history.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <complex>
+#include <limits>
 #include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace ugsdr {
 	template <
@@ -18,9 +36,15 @@ namespace ugsdr {
 		typename MatchedFilterT,
 		typename MixerT,
 		typename ReshapeAndSumT,
-		typename UpsamplerT
+		typename UpsamplerT,
+		HistoryPolicy HistoryPolicyValue = HistoryPolicy::Full,
+		std::size_t EpochBatchValue = 1
 	>
 		struct TrackingParametersConfig {
+		constexpr static inline auto history_policy = HistoryPolicyValue;
+		// epochs tracked by every worker thread for its channels between the synchronizations, 1 means a join after each epoch
+		constexpr static inline std::size_t epoch_batch = EpochBatchValue;
+
 		using AbsType = AbsT;
 		using CorrelatorType = CorrelatorT;
 		using MatchedFilterType = MatchedFilterT;
@@ -28,6 +52,7 @@ namespace ugsdr {
 		using ReshapeAndSumType = ReshapeAndSumT;
 		using UpsamplerType = UpsamplerT;
 
+		static_assert(epoch_batch != 0, "Epoch batch can't be empty");
 		static_assert(std::is_base_of_v<Abs<AbsType>, AbsType>, "Incorrect abs provided, expected ugsdr::Abs<T>");
 		static_assert(std::is_base_of_v<Correlator<CorrelatorType>, CorrelatorType>, "Incorrect correlator provided, expected ugsdr::Correlator<T>");
 		static_assert(std::is_base_of_v<MatchedFilter<MatchedFilterType>, MatchedFilterType>, "Incorrect matched filter provided, expected ugsdr::MatchedFilter<T>");
@@ -36,22 +61,52 @@ namespace ugsdr {
 		static_assert(std::is_base_of_v<Upsampler<UpsamplerType>, UpsamplerType>, "Incorrect upsampler provided, expected ugsdr::Upsampler<T>");
 	};
 
-	using DefaultTrackingParametersConfig = TrackingParametersConfig <
+	template <HistoryPolicy history_policy, std::size_t epoch_batch = 20>
+	using ParametricTrackingParametersConfig = TrackingParametersConfig <
 #ifdef HAS_IPP
 		IppAbs,
 		IppCorrelator,
 		IppMatchedFilter,
 		IppMixer,
 		IppReshapeAndSum,
-		SequentialUpsampler
+		SequentialUpsampler,
+		history_policy,
+		epoch_batch
 #else
 		SequentialAbs,
-		SequentialCorrelator,
+		FusedCorrelator,
 		SequentialMatchedFilter,
+		TableMixer,
 		SequentialReshapeAndSum,
+		SequentialUpsampler,
+		history_policy,
+		epoch_batch
+#endif
+	>;
+
+	using DefaultTrackingParametersConfig = ParametricTrackingParametersConfig<HistoryPolicy::Full>;
+
+	// Codes are stored with one bit per sample and correlated with XOR and popcount, see PackedCorrelatorBase
+	template <HistoryPolicy history_policy, std::size_t epoch_batch = 20, std::size_t bits = 2>
+	using PackedTrackingParametersConfig = TrackingParametersConfig <
+#ifdef HAS_IPP
+		IppAbs,
+		PackedCorrelatorBase<bits>,
+		IppMatchedFilter,
+		IppMixer,
+		IppReshapeAndSum,
+		SequentialUpsampler,
+		history_policy,
+		epoch_batch
+#else
+		SequentialAbs,
+		PackedCorrelatorBase<bits>,
+		SequentialMatchedFilter,
 		TableMixer,
-		
+		SequentialReshapeAndSum,
 		SequentialUpsampler,
+		history_policy,
+		epoch_batch
 #endif
 	>;
 
@@ -59,8 +114,10 @@ namespace ugsdr {
 	constexpr bool IsTrackingParametersConfig(T val) {
 		return false;
 	}
-	template <typename ... Args>
-	constexpr bool IsTrackingParametersConfig(TrackingParametersConfig<Args...> val) {
+	template <typename AbsT, typename CorrelatorT, typename MatchedFilterT, typename MixerT, typename ReshapeAndSumT, typename UpsamplerT,
+		HistoryPolicy history_policy, std::size_t epoch_batch>
+	constexpr bool IsTrackingParametersConfig(TrackingParametersConfig<AbsT, CorrelatorT, MatchedFilterT, MixerT, ReshapeAndSumT, UpsamplerT,
+		history_policy, epoch_batch> val) {
 		return true;
 	}
 	template <typename T>
@@ -69,6 +126,8 @@ namespace ugsdr {
 	template <TrackingParametersConfigConcept Config = DefaultTrackingParametersConfig, typename T = float>
 	struct TrackingParameters final {
 	private:
+		// one minute of the history for the ring and spill policies
+		constexpr static inline std::size_t default_history_depth = 60000;
 		constexpr static inline double PLL_NOISE_BANDWIDTH = 25.0;
 		constexpr static inline double FLL_NOISE_BANDWIDTH = 250.0;
 		constexpr static inline double SUMMATION_INTERVAL_PLL = 0.001;
@@ -111,24 +170,30 @@ namespace ugsdr {
         double sampling_rate = 0.0;
 		bool spectrum_inversion = false;
 
-		std::vector<double> phases;
-		std::vector<double> frequencies;
-		std::vector<double> code_phases;
-		std::vector<double> code_frequencies;
-		std::vector<double> phase_residuals;
-		std::vector<double> code_residuals;
+		template <typename U>
+		using HistoryType = HistoryColumn<U, Config::history_policy>;
+
+		HistoryType<double> phases;
+		HistoryType<double> frequencies;
+		HistoryType<double> code_phases;
+		HistoryType<double> code_frequencies;
+		HistoryType<double> phase_residuals;
+		HistoryType<double> code_residuals;
 
 		std::vector<std::complex<T>> translated_signal;
 
-		std::vector<std::complex<T>> early;
-		std::vector<std::complex<T>> prompt;
-		std::vector<std::complex<T>> late;
+		HistoryType<std::complex<T>> early;
+		HistoryType<std::complex<T>> prompt;
+		HistoryType<std::complex<T>> late;
 
 		std::complex<T> previous_prompt{};
 		double carrier_phase_error = 0.0;
 		double code_nco = 0.0;
 		double code_error = 0.0;
 
+		// total number of the tracked epochs, the history may hold only the last ones
+		std::size_t epochs_tracked = 0;
+
 		TrackingParameters() = default;
 		template <ChannelConfigConcept ChConfig>
 		TrackingParameters(const AcquisitionResult<T>& acquisition, DigitalFrontend<ChConfig, T>& digital_frontend) : TrackingParameters(acquisition, digital_frontend, acquisition.GetAcquiredSignalType()) {}
@@ -147,17 +212,41 @@ namespace ugsdr {
 			translated_signal.resize(static_cast<std::size_t>(sampling_rate / 1e3));
 
 			auto epochs_to_process = digital_frontend.GetNumberOfEpochs(sv.signal);
-			
-			phases.reserve(epochs_to_process);
-			frequencies.reserve(epochs_to_process);
-			code_phases.reserve(epochs_to_process);
-			code_frequencies.reserve(epochs_to_process);
-			phase_residuals.reserve(epochs_to_process);
-			code_residuals.reserve(epochs_to_process);
-
-			early.reserve(epochs_to_process);
-			prompt.reserve(epochs_to_process);
-			late.reserve(epochs_to_process);
+			// live streams don't know their length in advance, the full history just grows for them
+			if constexpr (Config::history_policy == HistoryPolicy::Full)
+				SetHistoryDepth(epochs_to_process == std::numeric_limits<std::size_t>::max() ? default_history_depth : epochs_to_process);
+			else
+				SetHistoryDepth(std::min(epochs_to_process, default_history_depth));
+		}
+
+		template <typename Fn>
+		void ForEachHistory(Fn&& fn) {
+			fn(phases);
+			fn(frequencies);
+			fn(code_phases);
+			fn(code_frequencies);
+			fn(phase_residuals);
+			fn(code_residuals);
+
+			fn(early);
+			fn(prompt);
+			fn(late);
+		}
+
+		void SetHistoryDepth(std::size_t epochs) {
+			ForEachHistory([epochs](auto& history) {
+				history.SetDepth(std::max<std::size_t>(epochs, 1));
+			});
+		}
+
+		void DiscardHistory(std::size_t epochs) {
+			ForEachHistory([epochs](auto& history) {
+				history.Discard(epochs);
+			});
+		}
+
+		auto GetEpochsTracked() const {
+			return epochs_tracked;
 		}
 
 		void UpdatePhase() {
@@ -468,8 +557,8 @@ namespace ugsdr {
 			return sampling_rate / base_code_frequency;
 		}
 
-		template <typename T1, typename T2>
-		auto CorrelateSplit(const T1& translated_signal, const T2& full_code, double current_code_phase) const {
+		// code offset and split of the millisecond at the code period boundary, along with the relative phase of the boundary
+		auto GetCorrelatorTap(double current_code_phase) const {
 			auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
 			auto code_period_samples = samples_per_ms * code_period;
 
@@ -479,9 +568,20 @@ namespace ugsdr {
 				current_code_phase = std::fmod(current_code_phase, code_period_samples);
 
 			auto first_batch_length = static_cast<std::size_t>(std::ceil(current_code_phase)) % samples_per_ms;
+			auto first_batch_phase = static_cast<std::size_t>(std::ceil(2 * code_period_samples - current_code_phase));
+
+			return std::make_pair(CorrelatorTap{ first_batch_phase, first_batch_length }, std::fmod(current_code_phase, samples_per_ms) / samples_per_ms);
+		}
+
+		template <typename T1, typename T2>
+		auto CorrelateSplit(const T1& translated_signal, const T2& full_code, double current_code_phase) const {
+			auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
+			auto [tap, relative_phase] = GetCorrelatorTap(current_code_phase);
+
+			auto first_batch_length = tap.split;
 			auto second_batch_length = samples_per_ms - first_batch_length;
 
-			auto first_batch_phase = static_cast<std::size_t>(std::ceil(2 * code_period_samples - current_code_phase));
+			auto first_batch_phase = tap.code_offset;
 			auto second_batch_phase = first_batch_phase + first_batch_length;
 
 			auto first = Config::CorrelatorType::Correlate(std::span(translated_signal.begin(), first_batch_length),
@@ -489,7 +589,48 @@ namespace ugsdr {
 			auto second = Config::CorrelatorType::Correlate(std::span(translated_signal.begin() + first_batch_length, second_batch_length),
 				std::span(full_code.begin() + second_batch_phase, second_batch_length));
 
-			return AddWithPhase(first, second, std::fmod(current_code_phase, samples_per_ms) / samples_per_ms);
+			return AddWithPhase(first, second, relative_phase);
+		}
+
+		template <typename T2, std::size_t taps_count, typename Fn>
+		auto CorrelateSplitTaps(const T2& full_code, const std::array<double, taps_count>& code_phases, Fn&& correlate) const {
+			std::array<CorrelatorTap, taps_count> taps;
+			std::array<double, taps_count> relative_phases{};
+			for (std::size_t i = 0; i < taps_count; ++i)
+				std::tie(taps[i], relative_phases[i]) = GetCorrelatorTap(code_phases[i]);
+
+			std::array<SplitCorrelation<T>, taps_count> correlations;
+			if constexpr (std::is_same_v<T2, PackedCode>)
+				correlate(full_code, std::span<const CorrelatorTap>(taps), std::span<SplitCorrelation<T>>(correlations));
+			else
+				correlate(std::span<const typename T2::value_type>(full_code), std::span<const CorrelatorTap>(taps), std::span<SplitCorrelation<T>>(correlations));
+
+			std::array<std::complex<T>, taps_count> dst;
+			for (std::size_t i = 0; i < taps_count; ++i)
+				dst[i] = AddWithPhase(correlations[i].first, correlations[i].second, relative_phases[i]);
+
+			return dst;
+		}
+
+		// same as CorrelateSplit for every code phase at once, the correlator reads the signal only once for all the taps
+		template <typename T1, typename T2, std::size_t taps_count>
+		auto CorrelateSplitMultiple(const T1& translated_signal, const T2& full_code, const std::array<double, taps_count>& code_phases) const {
+			auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
+			return CorrelateSplitTaps(full_code, code_phases, [&translated_signal, samples_per_ms](const auto& code, auto taps, auto correlations) {
+				Config::CorrelatorType::CorrelateMultiple(std::span<const std::complex<T>>(translated_signal.data(), samples_per_ms), code, taps, correlations);
+			});
+		}
+
+		// correlator wipes off the current carrier by itself, so the untranslated signal goes straight from the epoch
+		constexpr static inline bool fused_carrier_wipe_off = requires { typename Config::CorrelatorType::Carrier; };
+
+		template <typename T1, typename T2, std::size_t taps_count>
+		auto CorrelateSplitMultipleWithCarrier(const T1& signal, const T2& full_code, const std::array<double, taps_count>& code_phases) const {
+			auto samples_per_ms = static_cast<std::size_t>(sampling_rate / 1e3);
+			auto carrier = typename Config::CorrelatorType::Carrier{ -carrier_phase, -2 * std::numbers::pi * carrier_frequency / sampling_rate };
+			return CorrelateSplitTaps(full_code, code_phases, [&signal, samples_per_ms, &carrier](const auto& code, auto taps, auto correlations) {
+				Config::CorrelatorType::CorrelateMultipleWithCarrier(std::span<const std::complex<T>>(signal.data(), samples_per_ms), code, taps, correlations, carrier);
+			});
 		}
 
 		void Pll(const std::complex<T>& current_prompt) {
@@ -584,6 +725,8 @@ namespace ugsdr {
 				code_nco,
 				code_error
 			);
+			// not archived to keep the format, the reloaded history starts the epoch count
+			epochs_tracked = prompt.size();
 #endif
 		}
 	};
@@ -2,12 +2,18 @@
 
 #include "../src/correlator/correlator.hpp"
 #include "../src/correlator/af_correlator.hpp"
+#include "../src/correlator/fused_correlator.hpp"
 #include "../src/correlator/ipp_correlator.hpp"
+#include "../src/correlator/packed_correlator.hpp"
 #include "../src/prn_codes/GpsL1Ca.hpp"
 #include "../src/prn_codes/GlonassOf.hpp"
+#include "../src/prn_codes/packed_code.hpp"
 
 #include "../src/helpers/af_array_proxy.hpp"
+#include "../src/helpers/BbpPackedSpan.hpp"
 #include "../src/helpers/is_complex.hpp"
+#include "../src/helpers/NtlabPackedSpan.hpp"
+#include "../src/helpers/packed_decoder.hpp"
 
 #include "../src/matched_filter/matched_filter.hpp"
 #include "../src/matched_filter/ipp_matched_filter.hpp"
@@ -43,11 +49,14 @@
 #include "../src/resample/ipp_decimator.hpp"
 #include "../src/resample/af_resampler.hpp"
 #include "../src/resample/ipp_resampler.hpp"
+#include "../src/resample/polyphase_resampler.hpp"
 #include "../src/resample/ipp_upsampler.hpp"
 
 #include "../src/signal_parameters.hpp"
 
 #include "../src/dfe/dfe.hpp"
+#include "../src/dfe/epoch_prefetcher.hpp"
+#include "../src/acquisition/aid_predictor.hpp"
 #include "../src/acquisition/fse.hpp"
 
 #include "../src/tracking/tracker.hpp"
@@ -56,10 +65,209 @@
 
 #include "../src/positioning/standalone_rtklib.hpp"
 
+#include <atomic>
+#include <execution>
+#include <filesystem>
+#include <numbers>
 #include <random>
 #include <type_traits>
 
 namespace basic_tests {
+	namespace AcquisitionTests {
+		template <typename T>
+		class DopplerSpectrumCacheTest : public testing::Test {
+		public:
+			using Type = T;
+		};
+		using DopplerSpectrumCacheTypes = ::testing::Types<float, double>;
+		TYPED_TEST_SUITE(DopplerSpectrumCacheTest, DopplerSpectrumCacheTypes);
+
+		TYPED_TEST(DopplerSpectrumCacheTest, sequential_doppler_spectrum_cache) {
+			using T = typename TestFixture::Type;
+			using CacheType = ugsdr::DopplerSpectrumCache<ugsdr::TableMixer, ugsdr::SequentialResampler, ugsdr::SequentialMatchedFilter, T>;
+
+			const auto signal = std::vector<std::complex<T>>(4000, { 1, 0 });
+			const auto spectrum_bytes = signal.size() * sizeof(std::complex<T>);
+			auto cache = CacheType(3 * spectrum_bytes);
+			auto key = typename CacheType::Key{ signal.data(), 0.0, 1e6, 5e3, 200 };
+
+			std::size_t signal_requests = 0;
+			auto get_signal = [&]() {
+				++signal_requests;
+				return signal;
+			};
+			const auto& entry = cache.Get(key, get_signal);
+			const auto& same_entry = cache.Get(key, get_signal);
+
+			ASSERT_EQ(&entry, &same_entry);
+			ASSERT_EQ(signal_requests, 1);
+			// 250 Hz bins and 200 Hz step give 5 distinct sub-bin residuals, the signal and two spectra fit into the budget
+			ASSERT_EQ(entry.residuals.size(), 5);
+			ASSERT_EQ(entry.spectra.size(), 2);
+			ASSERT_EQ(entry.GetBytes(), 3 * spectrum_bytes);
+
+			std::size_t hypotheses = 0;
+			entry.ForEachSpectrum([&](const auto& spectrum, const auto& bin_shifts, const auto& doppler_frequencies) {
+				ASSERT_EQ(spectrum.size(), signal.size());
+				ASSERT_EQ(bin_shifts.size(), doppler_frequencies.size());
+				for (std::size_t i = 0; i < bin_shifts.size(); ++i)
+					ASSERT_LT(std::abs(doppler_frequencies[i] - 250.0 * bin_shifts[i]), 250.0);
+				hypotheses += bin_shifts.size();
+			});
+			ASSERT_EQ(hypotheses, 51);
+
+			// the budget is exhausted by the first entry, including its signal
+			auto other_key = key;
+			other_key.segment = 1;
+			other_key.segments = 2;
+			const auto& other_entry = cache.Get(other_key, get_signal);
+			ASSERT_EQ(other_entry.spectra.size(), 0);
+			ASSERT_EQ(signal_requests, 2);
+
+			cache.Clear();
+			static_cast<void>(cache.Get(key, get_signal));
+			ASSERT_EQ(signal_requests, 3);
+
+			// the different keys are built concurrently, every key once, and share the budget
+			cache.Clear();
+			std::atomic<std::size_t> concurrent_requests = 0;
+			std::vector<typename CacheType::Key> keys;
+			for (std::size_t i = 0; i < 16; ++i) {
+				keys.push_back(key);
+				keys.back().intermediate_frequency = static_cast<double>(i % 4) * 1e3;
+			}
+			std::vector<const typename CacheType::Entry*> entries(keys.size());
+			std::for_each(std::execution::par, keys.begin(), keys.end(), [&](auto& current_key) {
+				entries[static_cast<std::size_t>(&current_key - keys.data())] = &cache.Get(current_key, [&]() {
+					++concurrent_requests;
+					return signal;
+				});
+			});
+			ASSERT_EQ(concurrent_requests, 4);
+			std::size_t cached_spectra = 0;
+			for (std::size_t i = 0; i < 4; ++i) {
+				for (std::size_t j = i; j < entries.size(); j += 4)
+					ASSERT_EQ(entries[j], entries[i]);
+				cached_spectra += entries[i]->spectra.size();
+			}
+			ASSERT_EQ(cached_spectra, 2);
+		}
+
+		template <typename T>
+		class CodeSpectrumBankTest : public testing::Test {
+		public:
+			using Type = T;
+		};
+		using CodeSpectrumBankTypes = ::testing::Types<float, double>;
+		TYPED_TEST_SUITE(CodeSpectrumBankTest, CodeSpectrumBankTypes);
+
+		TYPED_TEST(CodeSpectrumBankTest, sequential_code_spectrum_bank) {
+			using T = typename TestFixture::Type;
+			using BankType = ugsdr::CodeSpectrumBank<ugsdr::SequentialUpsampler, ugsdr::SequentialMatchedFilter, T>;
+			constexpr double sampling_rate = 2.046e6;
+			constexpr std::size_t ms_to_process = 4;
+
+			auto bank = BankType();
+			const auto& spectrum = bank.template Get<ugsdr::Signal::GpsCoarseAcquisition_L1>(3, sampling_rate, ms_to_process);
+			const auto& same_spectrum = bank.template Get<ugsdr::Signal::GpsCoarseAcquisition_L1>(3, sampling_rate, ms_to_process);
+			ASSERT_EQ(&spectrum, &same_spectrum);
+			ASSERT_EQ(spectrum.size(), static_cast<std::size_t>(ms_to_process * sampling_rate / 1e3));
+
+			const auto code = ugsdr::SequentialUpsampler::Transform(ugsdr::RepeatCodeNTimes(ugsdr::PrnGenerator<ugsdr::Signal::GpsCoarseAcquisition_L1>::template Get<T>(3), ms_to_process),
+				spectrum.size());
+			const auto reference = ugsdr::SequentialMatchedFilter::PrepareCodeSpectrum(code);
+			for (std::size_t i = 0; i < reference.size(); ++i)
+				ASSERT_NEAR(std::abs(spectrum[i] - reference[i]), 0, 1e-3);
+
+			bank.template Build<ugsdr::Signal::Galileo_E1b>({ 0, 1 }, sampling_rate, ms_to_process, std::execution::seq);
+			ASSERT_EQ(bank.size(), 1 + 2 * BankType::GetSignPermutationsCount(ugsdr::Signal::Galileo_E1b));
+			const auto& first_permutation = bank.template Get<ugsdr::Signal::Galileo_E1b>(0, sampling_rate, ms_to_process, 0);
+			const auto& last_permutation = bank.template Get<ugsdr::Signal::Galileo_E1b>(0, sampling_rate, ms_to_process, 3);
+			ASSERT_NE(&first_permutation, &last_permutation);
+			ASSERT_EQ(bank.size(), 1 + 2 * BankType::GetSignPermutationsCount(ugsdr::Signal::Galileo_E1b));
+		}
+
+		template <typename T>
+		class AcquisitionAidTest : public testing::Test {
+		public:
+			using Type = T;
+		};
+		using AcquisitionAidTypes = ::testing::Types<float, double>;
+		TYPED_TEST_SUITE(AcquisitionAidTest, AcquisitionAidTypes);
+
+		TYPED_TEST(AcquisitionAidTest, previous_session_aids) {
+			auto results = std::vector<ugsdr::AcquisitionResult<typename TestFixture::Type>>(3);
+			results[0].sv_number = ugsdr::Sv(4, ugsdr::Signal::GpsCoarseAcquisition_L1);
+			results[0].intermediate_frequency = 14.58e6;
+			results[0].doppler = 14.58e6 + 1250.0;
+			results[1].sv_number = ugsdr::Sv(-3, ugsdr::Signal::GlonassCivilFdma_L1);
+			results[1].intermediate_frequency = -1.6875e6;
+			results[1].doppler = -1.6875e6 - 3100.0;
+			results[2].sv_number = ugsdr::Sv(7, ugsdr::Signal::Gps_L5I);
+			results[2].doppler = 900.0;
+
+			// the Doppler of the same signal is restored, the other bands are scaled with the carrier
+			const auto aids = ugsdr::MakeAcquisitionAids(results);
+			ASSERT_EQ(aids.size(), results.size());
+			for (std::size_t i = 0; i < aids.size(); ++i) {
+				ASSERT_EQ(static_cast<std::uint32_t>(aids[i].sv), static_cast<std::uint32_t>(results[i].sv_number));
+				ASSERT_NEAR(ugsdr::GetAidedDoppler(aids[i], ugsdr::GetAcquisitionCarrierFrequency(aids[i].sv)), results[i].doppler - results[i].intermediate_frequency, 1e-6);
+			}
+			// positive Doppler of the approaching satellite
+			ASSERT_LT(aids[0].range_rate, 0.0);
+			ASSERT_NEAR(ugsdr::GetAidedDoppler(aids[0], 1176.45e6), 1250.0 * 1176.45e6 / 1575.42e6, 1e-6);
+		}
+
+		TEST(AcquisitionAidPredictorTest, predicted_aids) {
+			constexpr auto deg = std::numbers::pi / 180.0;
+			constexpr auto earth_radius = 6378137.0;
+			constexpr auto earth_rotation = 7.2921151467e-5;
+			constexpr auto orbit_radius = 26560e3;
+			constexpr auto receiver_longitude = 30.0 * deg;
+			constexpr auto separation = 20.0 * deg;
+
+			const auto time = gpst2time(2200, 0.0);
+			const auto receiver_position = std::array<double, 3>{ earth_radius * std::cos(receiver_longitude), earth_radius * std::sin(receiver_longitude), 0.0 };
+
+			// circular equatorial GPS orbit, the satellite is west of the receiver and overtakes it
+			auto gps_ephemeris = eph_t{};
+			gps_ephemeris.sat = satno(SYS_GPS, 5);
+			gps_ephemeris.toe = time;
+			gps_ephemeris.toc = time;
+			gps_ephemeris.A = orbit_radius;
+			gps_ephemeris.OMG0 = receiver_longitude - separation;
+
+			// GLONASS satellite behind the Earth
+			auto glonass_ephemeris = geph_t{};
+			glonass_ephemeris.sat = satno(SYS_GLO, 3);
+			glonass_ephemeris.frq = -4;
+			glonass_ephemeris.toe = time;
+			glonass_ephemeris.pos[0] = -25510e3 * std::cos(receiver_longitude);
+			glonass_ephemeris.pos[1] = -25510e3 * std::sin(receiver_longitude);
+			glonass_ephemeris.vel[2] = 3950.0;
+
+			auto nav = std::make_unique<nav_t>();
+			nav->n = nav->nmax = 1;
+			nav->eph = &gps_ephemeris;
+			nav->ng = nav->ngmax = 1;
+			nav->geph = &glonass_ephemeris;
+
+			const auto predictor = ugsdr::AcquisitionAidPredictor(nav.get());
+			const auto aids = predictor.Predict(time, receiver_position);
+			ASSERT_EQ(aids.size(), 1);
+			ASSERT_EQ(static_cast<std::uint32_t>(aids[0].sv), static_cast<std::uint32_t>(ugsdr::Sv(4, ugsdr::Signal::GpsCoarseAcquisition_L1)));
+
+			const auto range = std::sqrt(orbit_radius * orbit_radius + earth_radius * earth_radius - 2 * orbit_radius * earth_radius * std::cos(separation));
+			const auto range_rate = -orbit_radius * earth_radius * std::sin(separation) * (std::sqrt(3.986005e14 / std::pow(orbit_radius, 3)) - earth_rotation) / range;
+			const auto elevation = std::asin((orbit_radius * std::cos(separation) - earth_radius) / range);
+			ASSERT_NEAR(aids[0].range_rate, range_rate, 0.05);
+			ASSERT_NEAR(aids[0].elevation, elevation, 1e-6);
+			ASSERT_GT(ugsdr::GetAidedDoppler(aids[0], 1575.42e6), 1000.0);
+
+			ASSERT_TRUE(predictor.Predict(time, receiver_position, elevation + 1.0 * deg).empty());
+		}
+	}
+
 	namespace CorrelatorTests {
 		template <typename T>
 		class CorrelatorTest : public testing::Test {
@@ -121,6 +329,333 @@ namespace basic_tests {
 			}
 		}
 #endif
+
+		TYPED_TEST(CorrelatorTest, fused_correlator) {
+			using T = typename TestFixture::Type;
+			const auto code = ugsdr::RepeatCodeNTimes(ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<T>(0), 3);
+			const auto signal_length = code.size() / 3;
+			auto signal = std::vector<std::complex<T>>(signal_length);
+			for (std::size_t i = 0; i < signal.size(); ++i)
+				signal[i] = std::complex<T>(code[(i + 5) % signal_length], static_cast<T>(std::sin(0.1 * static_cast<double>(i))));
+
+			const auto taps = std::vector<ugsdr::CorrelatorTap>{
+				{ 0, 0 }, { 4, 100 }, { 5, 1022 }, { 6, 1023 }, { 7, 512 }, { 1000, 24 }, { 2046, 1 }, { 10, 10 }, { 11, 11 }
+			};
+			auto dst = std::vector<ugsdr::SplitCorrelation<T>>(taps.size());
+			auto expected = dst;
+			ugsdr::FusedCorrelator::CorrelateMultiple(std::span<const std::complex<T>>(signal), std::span<const T>(code),
+				std::span<const ugsdr::CorrelatorTap>(taps), std::span(dst));
+			ugsdr::SequentialCorrelator::CorrelateMultiple(std::span<const std::complex<T>>(signal), std::span<const T>(code),
+				std::span<const ugsdr::CorrelatorTap>(taps), std::span(expected));
+
+			for (std::size_t i = 0; i < taps.size(); ++i) {
+				ASSERT_NEAR(dst[i].first.real(), expected[i].first.real(), 1e-3);
+				ASSERT_NEAR(dst[i].first.imag(), expected[i].first.imag(), 1e-3);
+				ASSERT_NEAR(dst[i].second.real(), expected[i].second.real(), 1e-3);
+				ASSERT_NEAR(dst[i].second.imag(), expected[i].second.imag(), 1e-3);
+			}
+			ASSERT_NEAR(dst[2].first.real() + dst[2].second.real(), static_cast<T>(signal_length), 1e-3);
+		}
+
+		TYPED_TEST(CorrelatorTest, fused_correlator_carrier) {
+			using T = typename TestFixture::Type;
+			const auto code = ugsdr::RepeatCodeNTimes(ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<T>(0), 3);
+			const auto signal_length = code.size() / 3;
+			const auto sampling_rate = 1.023e6;
+			const auto frequency = 1234.5;
+			const auto phase = 0.75;
+
+			auto signal = std::vector<std::complex<T>>(code.begin() + 3, code.begin() + 3 + signal_length);
+			ugsdr::SequentialMixer::Translate(signal, sampling_rate, frequency, phase);
+			auto translated_signal = signal;
+			ugsdr::SequentialMixer::Translate(translated_signal, sampling_rate, -frequency, -phase);
+
+			const auto taps = std::vector<ugsdr::CorrelatorTap>{ { 2, 0 }, { 3, 500 }, { 4, 1023 } };
+			auto dst = std::vector<ugsdr::SplitCorrelation<T>>(taps.size());
+			auto expected = dst;
+			ugsdr::FusedCorrelator::CorrelateMultipleWithCarrier(std::span<const std::complex<T>>(signal), std::span<const T>(code),
+				std::span<const ugsdr::CorrelatorTap>(taps), std::span(dst), ugsdr::FusedCorrelator::Carrier{ -phase, -2 * std::numbers::pi * frequency / sampling_rate });
+			ugsdr::SequentialCorrelator::CorrelateMultiple(std::span<const std::complex<T>>(translated_signal), std::span<const T>(code),
+				std::span<const ugsdr::CorrelatorTap>(taps), std::span(expected));
+
+			for (std::size_t i = 0; i < taps.size(); ++i) {
+				ASSERT_NEAR(dst[i].first.real(), expected[i].first.real(), 1e-2);
+				ASSERT_NEAR(dst[i].first.imag(), expected[i].first.imag(), 1e-2);
+				ASSERT_NEAR(dst[i].second.real(), expected[i].second.real(), 1e-2);
+				ASSERT_NEAR(dst[i].second.imag(), expected[i].second.imag(), 1e-2);
+			}
+			ASSERT_NEAR(dst[1].first.real() + dst[1].second.real(), static_cast<T>(signal_length), 1e-2);
+		}
+
+		TYPED_TEST(CorrelatorTest, packed_code) {
+			using T = typename TestFixture::Type;
+			auto code = ugsdr::RepeatCodeNTimes(ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<T>(0), 3);
+			// zero samples of the time-multiplexed codes are kept in a separate plane
+			std::fill(code.begin() + 100, code.begin() + 200, static_cast<T>(0));
+
+			const auto packed_code = ugsdr::PackedCode(code);
+			ASSERT_EQ(packed_code.size(), code.size());
+			ASSERT_TRUE(packed_code.HasZeros());
+			ASSERT_LT(packed_code.GetBytes(), code.size() * sizeof(T) / 8);
+			for (std::size_t i = 0; i < code.size(); ++i)
+				ASSERT_EQ(packed_code.Get<T>(i), code[i]);
+
+			const auto offset = std::size_t{ 37 };
+			const auto signs = packed_code.GetSigns(offset);
+			for (std::size_t i = 0; i < ugsdr::PackedCode::word_bits; ++i)
+				ASSERT_EQ(((signs >> i) & 0x1) != 0, code[offset + i] < 0);
+
+			ASSERT_THROW(ugsdr::PackedCode(std::vector<T>{ 1, -1, 2 }), std::runtime_error);
+		}
+
+		TYPED_TEST(CorrelatorTest, sign_correlator) {
+			using T = typename TestFixture::Type;
+			const auto code = ugsdr::RepeatCodeNTimes(ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<T>(0), 3);
+			const auto signal_length = code.size() / 3;
+			auto signal = std::vector<std::complex<T>>(signal_length);
+			for (std::size_t i = 0; i < signal.size(); ++i)
+				signal[i] = std::complex<T>(code[(i + 5) % signal_length], std::sin(0.1 * static_cast<double>(i)) < 0 ? -1 : 1);
+
+			// the signal is sign quantized already, so the packed correlation is exact
+			const auto taps = std::vector<ugsdr::CorrelatorTap>{
+				{ 0, 0 }, { 4, 100 }, { 5, 1022 }, { 6, 1023 }, { 7, 512 }, { 1000, 24 }, { 2046, 1 }, { 10, 10 }, { 11, 11 }
+			};
+			auto dst = std::vector<ugsdr::SplitCorrelation<T>>(taps.size());
+			auto expected = dst;
+			ugsdr::SignCorrelator::CorrelateMultiple(std::span<const std::complex<T>>(signal), ugsdr::PackedCode(code),
+				std::span<const ugsdr::CorrelatorTap>(taps), std::span(dst));
+			ugsdr::SequentialCorrelator::CorrelateMultiple(std::span<const std::complex<T>>(signal), std::span<const T>(code),
+				std::span<const ugsdr::CorrelatorTap>(taps), std::span(expected));
+
+			for (std::size_t i = 0; i < taps.size(); ++i) {
+				ASSERT_NEAR(dst[i].first.real(), expected[i].first.real(), 1e-3);
+				ASSERT_NEAR(dst[i].first.imag(), expected[i].first.imag(), 1e-3);
+				ASSERT_NEAR(dst[i].second.real(), expected[i].second.real(), 1e-3);
+				ASSERT_NEAR(dst[i].second.imag(), expected[i].second.imag(), 1e-3);
+			}
+		}
+
+		TYPED_TEST(CorrelatorTest, packed_correlator_carrier) {
+			using T = typename TestFixture::Type;
+			const auto code = ugsdr::RepeatCodeNTimes(ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<T>(0), 3);
+			const auto signal_length = code.size() / 3;
+			const auto sampling_rate = 1.023e6;
+			const auto frequency = 1234.5;
+			const auto phase = 0.75;
+
+			auto generator = std::mt19937(42);
+			auto noise = std::normal_distribution<T>(0, 1);
+			auto signal = std::vector<std::complex<T>>(code.begin() + 3, code.begin() + 3 + signal_length);
+			for (auto& el : signal)
+				el += std::complex<T>(noise(generator), noise(generator));
+			ugsdr::SequentialMixer::Translate(signal, sampling_rate, frequency, phase);
+
+			const auto taps = std::vector<ugsdr::CorrelatorTap>{ { 1, 0 }, { 3, 500 }, { 5, 1023 } };
+			auto dst = std::vector<ugsdr::SplitCorrelation<T>>(taps.size());
+			auto expected = dst;
+			ugsdr::PackedCorrelator::CorrelateMultipleWithCarrier(std::span<const std::complex<T>>(signal), ugsdr::PackedCode(code),
+				std::span<const ugsdr::CorrelatorTap>(taps), std::span(dst), ugsdr::PackedCorrelator::Carrier{ -phase, -2 * std::numbers::pi * frequency / sampling_rate });
+			ugsdr::FusedCorrelator::CorrelateMultipleWithCarrier(std::span<const std::complex<T>>(signal), std::span<const T>(code),
+				std::span<const ugsdr::CorrelatorTap>(taps), std::span(expected), ugsdr::FusedCorrelator::Carrier{ -phase, -2 * std::numbers::pi * frequency / sampling_rate });
+
+			// 2-bit quantization of the noisy signal keeps the prompt close to the unquantized one, the off-peak taps stay at the noise level
+			auto get_sum = [](const auto& el) {
+				return el.first + el.second;
+			};
+			ASSERT_NEAR(get_sum(dst[1]).real(), get_sum(expected[1]).real(), 0.15 * get_sum(expected[1]).real());
+			ASSERT_LT(std::abs(get_sum(dst[1]).imag()), 0.1 * static_cast<T>(signal_length));
+			ASSERT_LT(std::abs(get_sum(dst[0])), 0.2 * static_cast<T>(signal_length));
+			ASSERT_LT(std::abs(get_sum(dst[2])), 0.2 * static_cast<T>(signal_length));
+		}
+	}
+
+	namespace DfeTests {
+		template <typename T>
+		class EpochPrefetcherTest : public testing::Test {
+		public:
+			using Type = T;
+		};
+		using EpochPrefetcherTypes = ::testing::Types<float, double>;
+		TYPED_TEST_SUITE(EpochPrefetcherTest, EpochPrefetcherTypes);
+
+		TYPED_TEST(EpochPrefetcherTest, ordered_epochs) {
+			using EpochType = std::vector<typename TestFixture::Type>;
+			constexpr std::size_t first_epoch = 10;
+			constexpr std::size_t epochs_count = 100;
+
+			auto prefetcher = ugsdr::EpochPrefetcher<EpochType>([](std::size_t epoch, EpochType& dst) {
+				std::fill(dst.begin(), dst.end(), static_cast<typename TestFixture::Type>(epoch));
+			}, EpochType(16), first_epoch, epochs_count, 3);
+
+			auto epoch = EpochType(16);
+			for (std::size_t i = first_epoch; i < first_epoch + epochs_count; ++i) {
+				ASSERT_TRUE(prefetcher.Get(i, epoch));
+				ASSERT_EQ(epoch.size(), 16);
+				ASSERT_EQ(epoch.front(), static_cast<typename TestFixture::Type>(i));
+				ASSERT_EQ(epoch.back(), static_cast<typename TestFixture::Type>(i));
+			}
+			ASSERT_FALSE(prefetcher.Get(first_epoch + epochs_count, epoch));
+		}
+
+		TYPED_TEST(EpochPrefetcherTest, out_of_order_epoch) {
+			using EpochType = std::vector<typename TestFixture::Type>;
+
+			auto prefetcher = ugsdr::EpochPrefetcher<EpochType>([](std::size_t epoch, EpochType& dst) {
+				std::fill(dst.begin(), dst.end(), static_cast<typename TestFixture::Type>(epoch));
+			}, EpochType(16), 0, 10, 2);
+
+			auto epoch = EpochType(16);
+			ASSERT_FALSE(prefetcher.Get(5, epoch));
+			ASSERT_TRUE(prefetcher.Get(0, epoch));
+			ASSERT_EQ(epoch.front(), 0);
+		}
+
+		template <typename T>
+		class DfeTest : public testing::Test {
+		public:
+			using Type = T;
+		};
+		using DfeTypes = ::testing::Types<float, double>;
+		TYPED_TEST_SUITE(DfeTest, DfeTypes);
+
+		TYPED_TEST(DfeTest, signal_epoch_table) {
+			auto epoch = ugsdr::SignalEpoch<typename TestFixture::Type>();
+			epoch.Initialize({ ugsdr::Signal::GpsCoarseAcquisition_L1, ugsdr::Signal::Galileo_E1b }, 4092);
+			epoch.Initialize({ ugsdr::Signal::Gps_L5I, ugsdr::Signal::Gps_L5Q }, 10230);
+
+			ASSERT_EQ(&epoch.GetSubband(ugsdr::Signal::GpsCoarseAcquisition_L1), &epoch.GetSubband(ugsdr::Signal::Galileo_E1b));
+			ASSERT_EQ(&epoch.GetSubband(ugsdr::Signal::Gps_L5I), &epoch.GetSubband(ugsdr::Signal::Gps_L5Q));
+			ASSERT_EQ(epoch.GetSubband(ugsdr::Signal::GpsCoarseAcquisition_L1).size(), 4092);
+			ASSERT_EQ(epoch.GetSubband(ugsdr::Signal::Gps_L5I).size(), 10230);
+			ASSERT_FALSE(epoch.HasSignal(ugsdr::Signal::GlonassCivilFdma_L1));
+			ASSERT_THROW(static_cast<void>(epoch.GetSubband(ugsdr::Signal::GlonassCivilFdma_L1)), std::runtime_error);
+
+			auto copy = epoch;
+			ASSERT_EQ(copy.GetSubband(ugsdr::Signal::Gps_L5Q).size(), 10230);
+			ASSERT_NE(&copy.GetSubband(ugsdr::Signal::Gps_L5Q), &epoch.GetSubband(ugsdr::Signal::Gps_L5Q));
+		}
+
+		TYPED_TEST(DfeTest, fixed_point_frontend) {
+			using Type = typename TestFixture::Type;
+			constexpr double sampling_rate = 4.092e6;
+			constexpr std::size_t epochs = 5;
+
+			auto gen = std::mt19937(42);
+			std::vector<char> data(static_cast<std::size_t>(sampling_rate / 1e3) * epochs);
+			for (auto& el : data)
+				el = static_cast<char>(gen());
+			auto signal_parameters = ugsdr::SignalParametersBase<Type>(std::make_shared<ugsdr::MemorySource>(data), ugsdr::FileType::Nt1065GrabberThird, 1200e6, sampling_rate);
+
+			using FloatingPointConfig = ugsdr::ChannelConfig<ugsdr::InterferenceMitigation::Disabled, ugsdr::SequentialMixer, ugsdr::SequentialResampler>;
+			using FixedPointConfig = ugsdr::ChannelConfig<ugsdr::InterferenceMitigation::Disabled, ugsdr::SequentialMixer, ugsdr::SequentialResampler, ugsdr::FrontendPrecision::FixedPoint>;
+
+			// integer ratios go through the integer domain, the others fall back to the floating point mixer and resampler
+			for (auto output_rate : { sampling_rate, sampling_rate / 3, 3.069e6 }) {
+				auto floating_point = ugsdr::DigitalFrontend(ugsdr::MakeChannel<FloatingPointConfig>(signal_parameters, ugsdr::Signal::Gps_L5I, output_rate));
+				auto fixed_point = ugsdr::DigitalFrontend(ugsdr::MakeChannel<FixedPointConfig>(signal_parameters, ugsdr::Signal::Gps_L5I, output_rate));
+
+				for (std::size_t i = 0; i < epochs; ++i) {
+					const auto& expected = floating_point.GetEpoch(i).GetSubband(ugsdr::Signal::Gps_L5I);
+					const auto& actual = fixed_point.GetEpoch(i).GetSubband(ugsdr::Signal::Gps_L5I);
+					ASSERT_EQ(actual.size(), expected.size());
+
+					double error = 0.0;
+					double power = 0.0;
+					for (std::size_t j = 0; j < expected.size(); ++j) {
+						error += std::norm(std::complex<double>(actual[j]) - std::complex<double>(expected[j]));
+						power += std::norm(std::complex<double>(expected[j]));
+					}
+					ASSERT_LT(std::sqrt(error / power), 1e-2);
+				}
+			}
+		}
+
+		TYPED_TEST(DfeTest, streaming_resampler) {
+			using Type = typename TestFixture::Type;
+			constexpr double sampling_rate = 4.092e6;
+			constexpr std::size_t epochs = 8;
+
+			auto gen = std::mt19937(42);
+			std::vector<char> data(static_cast<std::size_t>(sampling_rate / 1e3) * epochs);
+			for (auto& el : data)
+				el = static_cast<char>(gen());
+			auto signal_parameters = ugsdr::SignalParametersBase<Type>(std::make_shared<ugsdr::MemorySource>(data), ugsdr::FileType::Nt1065GrabberThird, 1200e6, sampling_rate);
+
+			using StreamingConfig = ugsdr::ChannelConfig<ugsdr::InterferenceMitigation::Disabled, ugsdr::SequentialMixer, ugsdr::PolyphaseResampler>;
+
+			// rational ratio and the CIC + polyphase decimation
+			for (auto output_rate : { 3.069e6, 1.023e6 }) {
+				const auto samples_per_ms = static_cast<std::size_t>(output_rate / 1e3);
+				auto whole_record = ugsdr::DigitalFrontend(ugsdr::MakeChannel<StreamingConfig>(signal_parameters, ugsdr::Signal::Gps_L5I, output_rate));
+				const auto expected = whole_record.GetSeveralEpochs(0, epochs).GetSubband(ugsdr::Signal::Gps_L5I);
+				ASSERT_EQ(expected.size(), samples_per_ms * epochs);
+
+				// consecutive epochs continue the filter state, the others are restarted from the preceding samples
+				auto dfe = ugsdr::DigitalFrontend(ugsdr::MakeChannel<StreamingConfig>(signal_parameters, ugsdr::Signal::Gps_L5I, output_rate));
+				for (auto epoch : { 0, 1, 2, 6, 3, 4, 7, 5 }) {
+					const auto& actual = dfe.GetEpoch(epoch).GetSubband(ugsdr::Signal::Gps_L5I);
+					ASSERT_EQ(actual.size(), samples_per_ms);
+					for (std::size_t j = 0; j < actual.size(); ++j)
+						ASSERT_NEAR(std::abs(actual[j] - expected[epoch * samples_per_ms + j]), 0.0, 1e-4);
+				}
+
+				// prefetched epochs are swapped into the caller's buffers, the buffers are recycled
+				std::vector<ugsdr::SignalEpoch<Type>> batch(epochs);
+				dfe.StartPrefetch(0, epochs);
+				for (std::size_t epoch = 0; epoch < epochs; ++epoch)
+					dfe.GetEpoch(epoch, batch[epoch]);
+				dfe.StopPrefetch();
+				for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+					const auto& actual = batch[epoch].GetSubband(ugsdr::Signal::Gps_L5I);
+					ASSERT_EQ(actual.size(), samples_per_ms);
+					for (std::size_t j = 0; j < actual.size(); ++j)
+						ASSERT_NEAR(std::abs(actual[j] - expected[epoch * samples_per_ms + j]), 0.0, 1e-4);
+				}
+
+				// moving the front end stops the prefetching, the moved one reads the epochs on its own
+				dfe.StartPrefetch(0, epochs);
+				auto moved = std::move(dfe);
+				for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+					const auto& actual = moved.GetEpoch(epoch).GetSubband(ugsdr::Signal::Gps_L5I);
+					ASSERT_EQ(actual.size(), samples_per_ms);
+					for (std::size_t j = 0; j < actual.size(); ++j)
+						ASSERT_NEAR(std::abs(actual[j] - expected[epoch * samples_per_ms + j]), 0.0, 1e-4);
+				}
+			}
+		}
+
+		TYPED_TEST(DfeTest, real_input) {
+			using Type = typename TestFixture::Type;
+			constexpr double sampling_rate = 4.092e6;
+			constexpr double output_rate = 1.023e6;
+			constexpr std::size_t epochs = 4;
+
+			auto gen = std::mt19937(7);
+			std::vector<char> data(static_cast<std::size_t>(sampling_rate / 1e3) * epochs);
+			for (auto& el : data)
+				el = static_cast<char>(gen());
+			auto signal_parameters = ugsdr::SignalParametersBase<Type>(std::make_shared<ugsdr::MemorySource>(data), ugsdr::FileType::Nt1065GrabberThird, 1200e6, sampling_rate);
+			ASSERT_TRUE(signal_parameters.IsDataReal());
+
+			auto complex_samples = std::vector<std::complex<Type>>();
+			auto real_samples = std::vector<Type>();
+			signal_parameters.GetSeveralMs(0, epochs, complex_samples);
+			signal_parameters.GetSeveralMs(0, epochs, real_samples);
+			ASSERT_EQ(real_samples.size(), complex_samples.size());
+			for (std::size_t i = 0; i < real_samples.size(); ++i)
+				ASSERT_EQ(real_samples[i], complex_samples[i].real());
+
+			// the real samples are mixed without the promotion, the result matches the complex path
+			using RealInputConfig = ugsdr::ChannelConfig<ugsdr::InterferenceMitigation::Disabled, ugsdr::TableMixer, ugsdr::PolyphaseResampler>;
+			auto dfe = ugsdr::DigitalFrontend(ugsdr::MakeChannel<RealInputConfig>(signal_parameters, ugsdr::Signal::Gps_L5I, output_rate));
+			const auto& actual = dfe.GetSeveralEpochs(0, epochs).GetSubband(ugsdr::Signal::Gps_L5I);
+
+			ugsdr::TableMixer::Translate(complex_samples, sampling_rate, 1200e6 - 1176.45e6);
+			ugsdr::PolyphaseResampler::Transform(complex_samples, static_cast<std::size_t>(output_rate), static_cast<std::size_t>(sampling_rate));
+			ASSERT_EQ(actual.size(), complex_samples.size());
+			for (std::size_t i = 0; i < actual.size(); ++i)
+				ASSERT_NEAR(std::abs(actual[i] - complex_samples[i]), 0.0, 1e-4);
+		}
 	}
 
 	namespace DigitalFilterTests {
@@ -307,6 +842,62 @@ namespace basic_tests {
 				ASSERT_TRUE(same_type);
 			}
 		}
+
+		namespace PackedDecoder {
+			template <typename T>
+			class PackedDecoderTest : public testing::Test {
+			public:
+				using Type = T;
+
+				static auto GetPackedData(std::size_t size) {
+					std::vector<std::byte> packed_data(size);
+					auto gen = std::mt19937(42);
+					auto distr = std::uniform_int_distribution<int>(0, 255);
+					for (auto& el : packed_data)
+						el = static_cast<std::byte>(distr(gen));
+					return packed_data;
+				}
+			};
+			using PackedDecoderTypes = ::testing::Types<float, double>;
+			TYPED_TEST_SUITE(PackedDecoderTest, PackedDecoderTypes);
+
+
+			TYPED_TEST(PackedDecoderTest, ntlab_decoder) {
+				using Type = typename TestFixture::Type;
+				const std::size_t samples = 1001;
+				const auto packed_data = TestFixture::GetPackedData(samples);
+
+				auto check_channel = [&]<std::size_t offset>() {
+					auto packed_span = ugsdr::NtlabPackedSpan<offset, Type>(packed_data.data(), samples);
+					std::vector<std::complex<Type>> reference(packed_span.begin(), packed_span.end());
+
+					std::vector<std::complex<Type>> decoded(samples);
+					ugsdr::DecodeNtlabPacked(offset, packed_data.data(), samples, decoded.data());
+					ASSERT_EQ(decoded, reference);
+				};
+				check_channel.template operator()<0>();
+				check_channel.template operator()<2>();
+				check_channel.template operator()<4>();
+				check_channel.template operator()<6>();
+
+				std::vector<std::complex<Type>> decoded(samples);
+				ASSERT_THROW(ugsdr::DecodeNtlabPacked(1, packed_data.data(), samples, decoded.data()), std::runtime_error);
+			}
+			TYPED_TEST(PackedDecoderTest, bbp_decoder) {
+				using Type = typename TestFixture::Type;
+				for (std::size_t samples : { 2000, 1001 }) {
+					const auto packed_data = TestFixture::GetPackedData((samples + 1) / 2);
+					auto packed_span = ugsdr::PackedSpan<Type>(packed_data.data(), samples);
+					std::vector<std::complex<Type>> reference(samples);
+					for (std::size_t i = 0; i < samples; ++i)
+						reference[i] = *(packed_span.begin() + static_cast<std::ptrdiff_t>(i));
+
+					std::vector<std::complex<Type>> decoded(samples);
+					ugsdr::DecodeBbpPacked(packed_data.data(), samples, decoded.data());
+					ASSERT_EQ(decoded, reference);
+				}
+			}
+		}
 	}
 
 	namespace MixerTests {
@@ -377,21 +968,115 @@ namespace basic_tests {
 				ASSERT_NEAR(dst[i].real(), -1.0, 5e-3);
 			
 		}
+
+		template <typename FilterType, typename T>
+		void TestShiftedBatch() {
+			const auto signal = ugsdr::Codegen<ugsdr::GlonassOf>::Get<std::complex<T>>(0);
+			const auto code = ugsdr::Codegen<ugsdr::GlonassOf>::Get<T>(0);
+			const auto code_spectrum = FilterType::PrepareCodeSpectrum(code);
+			const auto signal_spectrum = FilterType::PrepareSignalSpectrum(signal);
+			const std::vector<std::ptrdiff_t> bin_shifts{ -7, 0, 3, 12 };
+
+			std::vector<std::complex<T>> dst;
+			FilterType::FilterShiftedBatch(signal_spectrum, code_spectrum, bin_shifts, dst);
+
+			ASSERT_EQ(dst.size(), bin_shifts.size() * signal.size());
+			for (std::size_t i = 0; i < bin_shifts.size(); ++i) {
+				const auto translated_signal = ugsdr::SequentialMixer::Translate(signal, static_cast<double>(signal.size()), -static_cast<double>(bin_shifts[i]));
+				const auto reference = static_cast<std::vector<std::complex<T>>>(FilterType::FilterOptimized(translated_signal, code_spectrum));
+				for (std::size_t j = 0; j < reference.size(); ++j) {
+					ASSERT_NEAR(dst[i * signal.size() + j].real(), reference[j].real(), 5e-2);
+					ASSERT_NEAR(dst[i * signal.size() + j].imag(), reference[j].imag(), 5e-2);
+				}
+			}
+		}
 		
+		template <typename FilterType, typename T>
+		void TestBatch() {
+			const auto signal = ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<std::complex<T>>(3);
+			const auto signal_spectrum = FilterType::PrepareSignalSpectrum(signal);
+
+			using SpectrumType = std::remove_cvref_t<decltype(FilterType::PrepareCodeSpectrum(ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<T>(0)))>;
+			std::vector<SpectrumType> code_spectra;
+			for (auto sv : { 1, 3, 7, 3 })
+				code_spectra.push_back(FilterType::PrepareCodeSpectrum(ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<T>(sv)));
+			std::vector<const SpectrumType*> code_spectra_ptrs;
+			for (auto& el : code_spectra)
+				code_spectra_ptrs.push_back(&el);
+
+			std::vector<std::complex<T>> dst;
+			FilterType::FilterBatch(signal_spectrum, code_spectra_ptrs, dst);
+
+			ASSERT_EQ(dst.size(), code_spectra.size() * signal.size());
+			for (std::size_t i = 0; i < code_spectra.size(); ++i) {
+				const auto reference = static_cast<std::vector<std::complex<T>>>(FilterType::FilterOptimized(signal, code_spectra[i]));
+				for (std::size_t j = 0; j < reference.size(); ++j) {
+					ASSERT_NEAR(dst[i * signal.size() + j].real(), reference[j].real(), 5e-2);
+					ASSERT_NEAR(dst[i * signal.size() + j].imag(), reference[j].imag(), 5e-2);
+				}
+			}
+		}
+
 		TYPED_TEST(MatchedFilterTest, sequential_matched_filter) {
 			TestMatched<ugsdr::SequentialMatchedFilter, typename TestFixture::Type>();
 		}
 
+		TYPED_TEST(MatchedFilterTest, sequential_matched_filter_shifted_batch) {
+			TestShiftedBatch<ugsdr::SequentialMatchedFilter, typename TestFixture::Type>();
+		}
+
+		TYPED_TEST(MatchedFilterTest, sequential_matched_filter_batch) {
+			TestBatch<ugsdr::SequentialMatchedFilter, typename TestFixture::Type>();
+		}
+
+		TYPED_TEST(MatchedFilterTest, sequential_matched_filter_real) {
+			using T = typename TestFixture::Type;
+			const auto code = ugsdr::Codegen<ugsdr::GlonassOf>::Get<T>(0);
+			const auto code_spectrum = ugsdr::SequentialMatchedFilter::PrepareCodeSpectrum(code);
+
+			// real signal, half spectrum product
+			auto dst = code;
+			ugsdr::SequentialMatchedFilter::FilterOptimized(dst, code_spectrum);
+
+			// the same code through the complex path gives the same correlation
+			auto complex_dst = std::vector<std::complex<T>>(code.begin(), code.end());
+			ugsdr::SequentialMatchedFilter::FilterOptimized(complex_dst, code_spectrum);
+
+			ASSERT_EQ(dst.size(), code.size());
+			ASSERT_NEAR(dst[0], code.size(), 5e-3);
+			ASSERT_NEAR(dst[0], complex_dst[0].real(), 5e-3);
+			for (std::size_t i = 1; i < dst.size(); ++i) {
+				ASSERT_NEAR(dst[i], -1.0, 5e-3);
+				ASSERT_NEAR(dst[i], complex_dst[i].real(), 5e-3);
+			}
+		}
+
 #ifdef HAS_IPP
 		TYPED_TEST(MatchedFilterTest, ipp_matched_filter) {
 			TestMatched<ugsdr::IppMatchedFilter, typename TestFixture::Type>();
 		}
+
+		TYPED_TEST(MatchedFilterTest, ipp_matched_filter_shifted_batch) {
+			TestShiftedBatch<ugsdr::IppMatchedFilter, typename TestFixture::Type>();
+		}
+
+		TYPED_TEST(MatchedFilterTest, ipp_matched_filter_batch) {
+			TestBatch<ugsdr::IppMatchedFilter, typename TestFixture::Type>();
+		}
 #endif
 
 #ifdef HAS_ARRAYFIRE
 		TYPED_TEST(MatchedFilterTest, af_matched_filter) {
 			TestMatched<ugsdr::AfMatchedFilter, typename TestFixture::Type>();
 		}
+
+		TYPED_TEST(MatchedFilterTest, af_matched_filter_shifted_batch) {
+			TestShiftedBatch<ugsdr::AfMatchedFilter, typename TestFixture::Type>();
+		}
+
+		TYPED_TEST(MatchedFilterTest, af_matched_filter_batch) {
+			TestBatch<ugsdr::AfMatchedFilter, typename TestFixture::Type>();
+		}
 #endif
 	}
 
@@ -500,20 +1185,135 @@ namespace basic_tests {
 
 			}
 
+			template <typename DftType, typename T>
+			void TestBatch() {
+				const auto data = GetVector<T>();
+				auto batch = data;
+				for (std::size_t i = 1; i < 3; ++i)
+					batch.insert(batch.end(), data.begin(), data.end());
+
+				DftType::TransformBatch(batch, data.size());
+				const auto reference = static_cast<std::vector<std::complex<T>>>(DftType::Transform(data));
+
+				ASSERT_EQ(batch.size(), 3 * data.size());
+				for (std::size_t i = 0; i < batch.size(); ++i)
+					ASSERT_NEAR(std::abs(batch[i] - reference[i % reference.size()]), 0, 5e-3);
+			}
+
 			TYPED_TEST(DftTest, sequential_dft) {
 				TestPeak<ugsdr::SequentialDft, typename TestFixture::Type>();
 			}
 
+			TYPED_TEST(DftTest, sequential_dft_batch) {
+				TestBatch<ugsdr::SequentialDft, typename TestFixture::Type>();
+			}
+
+			TYPED_TEST(DftTest, sequential_dft_in_place) {
+				using T = typename TestFixture::Type;
+				const auto data = GetVector<T>();
+				const auto reference = static_cast<std::vector<std::complex<T>>>(ugsdr::SequentialDft::Transform(data));
+				const auto inverse_reference = static_cast<std::vector<std::complex<T>>>(ugsdr::SequentialDft::Transform(reference, true));
+
+				// the cached plans are reused for the repeated transforms of the same layout
+				for (std::size_t i = 0; i < 3; ++i) {
+					auto src_dst = data;
+					ugsdr::SequentialDft::Transform(src_dst);
+					for (std::size_t j = 0; j < src_dst.size(); ++j)
+						ASSERT_NEAR(std::abs(src_dst[j] - reference[j]), 0, 5e-3);
+
+					ugsdr::SequentialDft::Transform(src_dst, true);
+					for (std::size_t j = 0; j < src_dst.size(); ++j)
+						ASSERT_NEAR(std::abs(src_dst[j] - inverse_reference[j]), 0, 5e-3);
+				}
+			}
+
+#ifdef HAS_FFTW
+			TEST(DftWisdomTest, sequential_dft_wisdom) {
+				const auto path = std::filesystem::temp_directory_path() / "ugsdr_dft_test_wisdom";
+				for (auto extension : { ".fftw", ".fftwf" }) {
+					auto file = path;
+					file += extension;
+					std::filesystem::remove(file);
+				}
+
+				// the wisdom is written once both precisions have measured plans
+				auto float_data = std::vector<std::complex<float>>(1000);
+				auto double_data = std::vector<std::complex<double>>(1000);
+				ugsdr::SequentialDft::Transform(float_data);
+				ugsdr::SequentialDft::Transform(double_data);
+				ASSERT_TRUE(ugsdr::SequentialDft::ExportWisdom(path));
+				ASSERT_TRUE(ugsdr::SequentialDft::ImportWisdom(path));
+				ASSERT_FALSE(ugsdr::SequentialDft::ImportWisdom(path.string() + "_missing"));
+
+				for (auto extension : { ".fftw", ".fftwf" }) {
+					auto file = path;
+					file += extension;
+					std::filesystem::remove(file);
+				}
+			}
+#endif
+
+			TYPED_TEST(DftTest, sequential_dft_real) {
+				using T = typename TestFixture::Type;
+				const auto data = GetVector<T>();
+				auto real_data = std::vector<T>(data.size());
+				std::transform(data.begin(), data.end(), real_data.begin(), [](auto& val) { return val.real(); });
+
+				auto half_spectrum = std::vector<std::complex<T>>();
+				ugsdr::SequentialDft::TransformReal(real_data, half_spectrum);
+				const auto reference = static_cast<std::vector<std::complex<T>>>(ugsdr::SequentialDft::Transform(std::vector<std::complex<T>>(real_data.begin(), real_data.end())));
+				ASSERT_EQ(half_spectrum.size(), real_data.size() / 2 + 1);
+				for (std::size_t i = 0; i < half_spectrum.size(); ++i)
+					ASSERT_NEAR(std::abs(half_spectrum[i] - reference[i]), 0, 5e-3);
+
+				auto restored = std::vector<T>(real_data.size());
+				ugsdr::SequentialDft::TransformRealInverse(half_spectrum, restored);
+				for (std::size_t i = 0; i < restored.size(); ++i)
+					ASSERT_NEAR(restored[i], real_data[i], 5e-4);
+			}
+
 #ifdef HAS_IPP
 			TYPED_TEST(DftTest, ipp_dft) {
 				TestPeak<ugsdr::IppDft, typename TestFixture::Type>();
 			}
+
+			TYPED_TEST(DftTest, ipp_dft_batch) {
+				TestBatch<ugsdr::IppDft, typename TestFixture::Type>();
+			}
+
+			TYPED_TEST(DftTest, ipp_dft_mixed_sizes) {
+				using T = typename TestFixture::Type;
+				const auto data = GetVector<T>();
+				const auto reference = static_cast<std::vector<std::complex<T>>>(ugsdr::IppDft::Transform(data));
+
+				// the specs of the other sizes, including the power of two FFT ones, are kept alongside
+				for (auto size : { 128, 1024, 4096, 1000 }) {
+					auto vec = std::vector<std::complex<T>>(size, 1);
+					ugsdr::IppDft::Transform(vec);
+					ASSERT_NEAR(std::abs(vec[0]), size, 5e-3);
+				}
+
+				const auto result = static_cast<std::vector<std::complex<T>>>(ugsdr::IppDft::Transform(data));
+				for (std::size_t i = 0; i < result.size(); ++i)
+					ASSERT_NEAR(std::abs(result[i] - reference[i]), 0, 5e-3);
+
+				auto pow2 = std::vector<std::complex<T>>(data.begin(), data.begin() + 512);
+				auto restored = pow2;
+				ugsdr::IppDft::Transform(restored);
+				ugsdr::IppDft::Transform(restored, true);
+				for (std::size_t i = 0; i < pow2.size(); ++i)
+					ASSERT_NEAR(std::abs(restored[i] - pow2[i]), 0, 5e-3);
+			}
 #endif
 
 #ifdef HAS_ARRAYFIRE
 			TYPED_TEST(DftTest, af_dft) {
 				TestPeak<ugsdr::AfDft, typename TestFixture::Type>();
 			}
+
+			TYPED_TEST(DftTest, af_dft_batch) {
+				TestBatch<ugsdr::AfDft, typename TestFixture::Type>();
+			}
 #endif
 		}
 		namespace MaxIndex {
@@ -840,6 +1640,56 @@ namespace basic_tests {
 		}
 #endif
 
+		template <typename T>
+		auto GetTone(double frequency, double sampling_rate, std::size_t samples) {
+			std::vector<T> vec(samples);
+			for (std::size_t i = 0; i < vec.size(); ++i) {
+				const auto phase = 2 * std::numbers::pi * frequency * static_cast<double>(i) / sampling_rate;
+				if constexpr (ugsdr::is_complex_v<T>)
+					vec[i] = T(static_cast<ugsdr::underlying_t<T>>(std::cos(phase)), static_cast<ugsdr::underlying_t<T>>(std::sin(phase)));
+				else
+					vec[i] = static_cast<T>(std::cos(phase));
+			}
+			return vec;
+		}
+
+		TYPED_TEST(ResampleTest, polyphase_resampler) {
+			using Type = typename TestFixture::Type;
+			// interpolation, small rational ratio and the CIC + polyphase decimation
+			const auto rates = std::vector<std::pair<std::size_t, std::size_t>>{ { 3069, 1023 }, { 3000, 4000 }, { 8192, 79500 } };
+			for (auto [new_sampling_rate, old_sampling_rate] : rates) {
+				const auto frequency = 0.02 * static_cast<double>(std::min(new_sampling_rate, old_sampling_rate));
+				const auto data = GetTone<Type>(frequency, static_cast<double>(old_sampling_rate), 4 * old_sampling_rate);
+				const auto result = ugsdr::PolyphaseResampler::Transform(data, new_sampling_rate, old_sampling_rate);
+				const auto reference = GetTone<Type>(frequency, static_cast<double>(new_sampling_rate), 4 * new_sampling_rate);
+
+				ASSERT_EQ(result.size(), reference.size());
+				constexpr std::size_t edge = 32;
+				for (std::size_t i = edge; i < result.size() - edge; ++i)
+					ASSERT_NEAR(std::abs(result[i] - reference[i]), 0.0, 1e-2);
+			}
+		}
+
+		TYPED_TEST(ResampleTest, polyphase_streaming) {
+			using Type = typename TestFixture::Type;
+			const auto data = GetTone<Type>(100.0, 79500.0, 4 * 79500);
+			auto whole = std::vector<Type>();
+			ugsdr::MultistageResampler<Type>(8192, 79500).Process(data, whole);
+
+			auto resampler = ugsdr::MultistageResampler<Type>(8192, 79500);
+			auto streamed = std::vector<Type>();
+			auto block = std::vector<Type>();
+			for (std::size_t offset = 0, block_size = 1; offset < data.size(); offset += block_size, block_size = block_size * 3 + 7) {
+				const auto current_size = std::min(block_size, data.size() - offset);
+				resampler.Process(std::span(data).subspan(offset, current_size), block);
+				streamed.insert(streamed.end(), block.begin(), block.end());
+			}
+
+			ASSERT_EQ(streamed.size(), whole.size());
+			for (std::size_t i = 0; i < whole.size(); ++i)
+				ASSERT_NEAR(std::abs(streamed[i] - whole[i]), 0.0, 1e-5);
+		}
+
 #ifdef HAS_ARRAYFIRE
 		TYPED_TEST(ResampleTest, af_decimator) {
 			TestDecimator<ugsdr::AfDecimator, typename TestFixture::Type>();
@@ -849,4 +1699,302 @@ namespace basic_tests {
 		}
 #endif
 	}
+
+	namespace SignalParametersTests {
+		template <typename T>
+		class StreamingFileTest : public testing::Test {
+		public:
+			using Type = T;
+		};
+		using StreamingFileTypes = ::testing::Types<float, double>;
+		TYPED_TEST_SUITE(StreamingFileTest, StreamingFileTypes);
+
+		TYPED_TEST(StreamingFileTest, streaming_matches_mapped) {
+			using Type = typename TestFixture::Type;
+			constexpr double sampling_rate = 1.023e6;
+			constexpr std::size_t epochs = 50;
+
+			auto path = std::filesystem::temp_directory_path() / "ugsdr_streaming_file_test.bin";
+			{
+				auto gen = std::mt19937(42);
+				auto distr = std::uniform_int_distribution<int>(-128, 127);
+				std::vector<char> data(static_cast<std::size_t>(sampling_rate / 1e3) * 2 * epochs);
+				for (auto& el : data)
+					el = static_cast<char>(distr(gen));
+				std::ofstream(path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+			}
+
+			{
+				auto mapped = ugsdr::SignalParametersBase<Type>(path, ugsdr::FileType::Iq_8_plus_8, 1575.42e6, sampling_rate);
+				auto streaming = ugsdr::SignalParametersBase<Type>(path, ugsdr::FileType::Iq_8_plus_8, 1575.42e6, sampling_rate, ugsdr::StreamingOptions{ 3 });
+				ASSERT_EQ(streaming.GetNumberOfEpochs(), mapped.GetNumberOfEpochs());
+
+				// sequential reads cross the window boundaries, the last ones jump backwards and read more than a window
+				for (auto [ms_offset, ms_cnt] : std::vector<std::pair<std::size_t, std::size_t>>{ {0, 1}, {1, 1}, {2, 2}, {4, 1}, {10, 1}, {5, 7}, {0, epochs} })
+					ASSERT_EQ(streaming.GetSeveralMs(ms_offset, ms_cnt), mapped.GetSeveralMs(ms_offset, ms_cnt));
+				ASSERT_THROW(streaming.GetSeveralMs(epochs, 1), std::runtime_error);
+			}
+			std::filesystem::remove(path);
+		}
+
+#if defined(__unix__) || defined(__APPLE__)
+		TYPED_TEST(StreamingFileTest, stream_source) {
+			using Type = typename TestFixture::Type;
+			constexpr double sampling_rate = 1.023e6;
+			constexpr std::size_t epochs = 50;
+			constexpr auto epoch_size = static_cast<std::size_t>(sampling_rate / 1e3) * 2;
+
+			auto gen = std::mt19937(42);
+			auto distr = std::uniform_int_distribution<int>(-128, 127);
+			std::vector<char> data(epoch_size * epochs);
+			for (auto& el : data)
+				el = static_cast<char>(distr(gen));
+
+			// local socket stands in for the grabber, the ring holds just a few epochs, so the writer is throttled by the reader
+			int descriptors[2] = {};
+			ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors), 0);
+			auto writer = std::thread([&data, fd = descriptors[1]] {
+				for (std::size_t written = 0; written < data.size();) {
+					auto current_write = write(fd, data.data() + written, std::min<std::size_t>(data.size() - written, 1000));
+					if (current_write <= 0)
+						break;
+					written += static_cast<std::size_t>(current_write);
+				}
+				close(fd);
+			});
+
+			auto reference = ugsdr::SignalParametersBase<Type>(std::make_shared<ugsdr::MemorySource>(data), ugsdr::FileType::Iq_8_plus_8, 1575.42e6, sampling_rate);
+			auto stream = ugsdr::SignalParametersBase<Type>(std::make_shared<ugsdr::StreamSource>(descriptors[0], epoch_size * 3 + 100),
+				ugsdr::FileType::Iq_8_plus_8, 1575.42e6, sampling_rate);
+			EXPECT_EQ(reference.GetNumberOfEpochs(), epochs);
+
+			EXPECT_EQ(stream.GetSeveralMs(0, 2), reference.GetSeveralMs(0, 2));
+			EXPECT_EQ(stream.GetSeveralMs(0, 1), reference.GetSeveralMs(0, 1));
+			for (std::size_t i = 1; i < epochs; ++i)
+				EXPECT_EQ(stream.GetOneMs(i), reference.GetOneMs(i));
+			EXPECT_THROW(stream.GetOneMs(0), std::runtime_error);
+			EXPECT_THROW(stream.GetOneMs(epochs), std::runtime_error);
+			writer.join();
+		}
+
+		TYPED_TEST(StreamingFileTest, stream_source_skip_ahead) {
+			using Type = typename TestFixture::Type;
+			constexpr double sampling_rate = 2e6;
+			constexpr std::size_t epochs = 50;
+			constexpr std::size_t epoch_size = static_cast<std::size_t>(sampling_rate / 1e3) * 2;
+
+			auto gen = std::mt19937(7);
+			auto distr = std::uniform_int_distribution<int>(-128, 127);
+			std::vector<char> data(epoch_size * epochs);
+			for (auto& el : data)
+				el = static_cast<char>(distr(gen));
+
+			int descriptors[2] = {};
+			ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors), 0);
+			auto writer = std::thread([&data, fd = descriptors[1]] {
+				for (std::size_t written = 0; written < data.size();) {
+					auto current_write = write(fd, data.data() + written, std::min<std::size_t>(data.size() - written, 1000));
+					if (current_write <= 0)
+						break;
+					written += static_cast<std::size_t>(current_write);
+				}
+				close(fd);
+			});
+
+			auto reference = ugsdr::SignalParametersBase<Type>(std::make_shared<ugsdr::MemorySource>(data), ugsdr::FileType::Iq_8_plus_8, 1575.42e6, sampling_rate);
+			auto stream = ugsdr::SignalParametersBase<Type>(std::make_shared<ugsdr::StreamSource>(descriptors[0], epoch_size * 3 + 100),
+				ugsdr::FileType::Iq_8_plus_8, 1575.42e6, sampling_rate);
+
+			// requests far beyond the ring window skip the samples in between
+			EXPECT_EQ(stream.GetOneMs(0), reference.GetOneMs(0));
+			EXPECT_EQ(stream.GetOneMs(20), reference.GetOneMs(20));
+			EXPECT_THROW(stream.GetOneMs(10), std::runtime_error);
+			EXPECT_EQ(stream.GetSeveralMs(21, 2), reference.GetSeveralMs(21, 2));
+			EXPECT_EQ(stream.GetOneMs(epochs - 1), reference.GetOneMs(epochs - 1));
+			writer.join();
+		}
+#endif
+	}
+
+	namespace TrackingTests {
+		template <typename T>
+		class TrackerTest : public testing::Test {
+		public:
+			using Type = T;
+		};
+		using TrackerTypes = ::testing::Types<float, double>;
+		TYPED_TEST_SUITE(TrackerTest, TrackerTypes);
+
+		TYPED_TEST(TrackerTest, epoch_batch) {
+			using Type = typename TestFixture::Type;
+			constexpr double sampling_rate = 2.046e6;
+			constexpr std::size_t samples_per_ms = 2046;
+			// the last batch is incomplete
+			constexpr std::size_t epochs = 105;
+
+			struct SyntheticSatellite {
+				std::int32_t id = 0;
+				double doppler = 0.0;
+				double delay_chips = 0.0;
+			};
+			const auto satellites = std::vector<SyntheticSatellite>{ { 3, 1200.0, 100.25 }, { 10, -2100.0, 700.5 } };
+
+			std::vector<std::vector<double>> codes;
+			for (const auto& satellite : satellites)
+				codes.push_back(ugsdr::Codegen<ugsdr::GpsL1Ca>::Get<double>(satellite.id));
+
+			auto gen = std::mt19937(5);
+			auto noise = std::normal_distribution<double>(0.0, 8.0);
+			std::vector<char> data(2 * samples_per_ms * epochs);
+			for (std::size_t i = 0; i < samples_per_ms * epochs; ++i) {
+				const auto t = static_cast<double>(i) / sampling_rate;
+				auto sample = std::complex<double>(noise(gen), noise(gen));
+				for (std::size_t j = 0; j < satellites.size(); ++j) {
+					const auto chip = std::fmod(t * 1.023e6 * (1 + satellites[j].doppler / 1575.42e6) - satellites[j].delay_chips + 1023e3, 1023.0);
+					sample += 6.0 * codes[j][static_cast<std::size_t>(chip)] * std::polar(1.0, 2 * std::numbers::pi * satellites[j].doppler * t);
+				}
+				data[2 * i] = static_cast<char>(std::clamp(std::round(sample.real()), -128.0, 127.0));
+				data[2 * i + 1] = static_cast<char>(std::clamp(std::round(sample.imag()), -128.0, 127.0));
+			}
+			auto signal_parameters = ugsdr::SignalParametersBase<Type>(std::make_shared<ugsdr::MemorySource>(data), ugsdr::FileType::Iq_8_plus_8, 1575.42e6, sampling_rate);
+			auto dfe = ugsdr::DigitalFrontend(ugsdr::MakeChannel(signal_parameters, std::vector{ ugsdr::Signal::GpsCoarseAcquisition_L1 }, sampling_rate));
+
+			auto acquisition_results = std::vector<ugsdr::AcquisitionResult<Type>>(satellites.size());
+			for (std::size_t i = 0; i < satellites.size(); ++i) {
+				acquisition_results[i].sv_number = ugsdr::Sv(satellites[i].id, ugsdr::Signal::GpsCoarseAcquisition_L1);
+				acquisition_results[i].doppler = satellites[i].doppler;
+				acquisition_results[i].code_offset = std::round(satellites[i].delay_chips * sampling_rate / 1.023e6);
+			}
+
+			// a join after every epoch and the workers tracking their channels through the batches
+			using SingleEpochConfig = ugsdr::ParametricTrackingParametersConfig<ugsdr::HistoryPolicy::Full, 1>;
+			using BatchConfig = ugsdr::ParametricTrackingParametersConfig<ugsdr::HistoryPolicy::Full, 20>;
+			auto single_epoch = ugsdr::Tracker<SingleEpochConfig, ugsdr::DefaultChannelConfig, Type>(dfe, acquisition_results);
+			single_epoch.Track(epochs);
+			auto batch = ugsdr::Tracker<BatchConfig, ugsdr::DefaultChannelConfig, Type>(dfe, acquisition_results);
+			batch.Track(epochs);
+
+			const auto& expected = single_epoch.GetTrackingParameters();
+			const auto& actual = batch.GetTrackingParameters();
+			ASSERT_EQ(actual.size(), expected.size());
+			for (std::size_t i = 0; i < actual.size(); ++i) {
+				ASSERT_EQ(actual[i].prompt.size(), epochs);
+				ASSERT_TRUE(std::equal(actual[i].early.begin(), actual[i].early.end(), expected[i].early.begin(), expected[i].early.end()));
+				ASSERT_TRUE(std::equal(actual[i].prompt.begin(), actual[i].prompt.end(), expected[i].prompt.begin(), expected[i].prompt.end()));
+				ASSERT_TRUE(std::equal(actual[i].late.begin(), actual[i].late.end(), expected[i].late.begin(), expected[i].late.end()));
+
+				ASSERT_EQ(actual[i].code_phase, expected[i].code_phase);
+				ASSERT_EQ(actual[i].code_frequency, expected[i].code_frequency);
+				ASSERT_EQ(actual[i].carrier_phase, expected[i].carrier_phase);
+				ASSERT_EQ(actual[i].carrier_frequency, expected[i].carrier_frequency);
+				ASSERT_EQ(actual[i].GetEpochsTracked(), epochs);
+			}
+			// both satellites are tracked, not just processed the same way
+			for (const auto& parameters : actual)
+				ASSERT_NEAR(parameters.carrier_frequency, std::find_if(satellites.begin(), satellites.end(), [&parameters](auto& satellite) {
+					return satellite.id == parameters.sv.id;
+				})->doppler, 50.0);
+		}
+
+		template <typename T>
+		class HistoryColumnTest : public testing::Test {
+		public:
+			using Type = T;
+		};
+		using HistoryColumnTypes = ::testing::Types<float, double>;
+		TYPED_TEST_SUITE(HistoryColumnTest, HistoryColumnTypes);
+
+		template <ugsdr::HistoryPolicy policy, typename T>
+		void TestHistoryColumn(std::size_t expected_size) {
+			constexpr std::size_t depth = 64;
+			constexpr std::size_t epochs = 1000;
+			constexpr std::size_t discarded = 10;
+
+			auto column = ugsdr::HistoryColumn<std::complex<T>, policy>();
+			column.SetDepth(depth);
+			for (std::size_t i = 0; i < epochs; ++i)
+				column.push_back({ static_cast<T>(i), -static_cast<T>(i) });
+			column.Discard(discarded);
+			ASSERT_EQ(column.size(), expected_size);
+
+			auto first_value = epochs - column.size();
+			for (std::size_t i = 0; i < column.size(); ++i)
+				ASSERT_EQ(column[i].real(), static_cast<T>(first_value + i));
+
+			std::vector<std::complex<T>> values;
+			column.CopyTo(values);
+			ASSERT_TRUE(std::equal(values.begin(), values.end(), column.begin(), column.end()));
+
+			auto copy = column;
+			ASSERT_TRUE(std::equal(copy.begin(), copy.end(), column.begin(), column.end()));
+		}
+
+		TYPED_TEST(HistoryColumnTest, full_history) {
+			TestHistoryColumn<ugsdr::HistoryPolicy::Full, typename TestFixture::Type>(990);
+		}
+
+		TYPED_TEST(HistoryColumnTest, ring_history) {
+			TestHistoryColumn<ugsdr::HistoryPolicy::Ring, typename TestFixture::Type>(54);
+		}
+
+		TYPED_TEST(HistoryColumnTest, spill_history) {
+			TestHistoryColumn<ugsdr::HistoryPolicy::Spill, typename TestFixture::Type>(990);
+		}
+
+		TYPED_TEST(HistoryColumnTest, spill_history_discard) {
+			using T = typename TestFixture::Type;
+			constexpr std::size_t depth = 64;
+			constexpr std::size_t window = 5 * depth + 10;
+			constexpr std::size_t epochs = 100 * depth;
+
+			auto column = ugsdr::HistoryColumn<std::complex<T>, ugsdr::HistoryPolicy::Spill>();
+			column.SetDepth(depth);
+			// sliding window of the single-pass receiver, the file has to stop growing
+			for (std::size_t i = 0; i < epochs; ++i) {
+				column.push_back({ static_cast<T>(i), -static_cast<T>(i) });
+				if (column.size() > window)
+					column.Discard(column.size() - window);
+			}
+			ASSERT_EQ(column.size(), window);
+			ASSERT_LE(std::filesystem::file_size(column.GetSpillPath()), (window / depth + 2) * depth * sizeof(std::complex<T>));
+
+			for (std::size_t i = 0; i < column.size(); ++i)
+				ASSERT_EQ(column[i].real(), static_cast<T>(epochs - window + i));
+
+			column.Discard(column.size());
+			ASSERT_TRUE(column.empty());
+			column.push_back({ 1, -1 });
+			ASSERT_EQ(column.front().real(), static_cast<T>(1));
+		}
+
+		TYPED_TEST(HistoryColumnTest, spill_history_concurrent_readers) {
+			using T = typename TestFixture::Type;
+			constexpr std::size_t depth = 32;
+			constexpr std::size_t epochs = 40 * depth + 7;
+
+			auto column = ugsdr::HistoryColumn<T, ugsdr::HistoryPolicy::Spill>();
+			column.SetDepth(depth);
+			for (std::size_t i = 0; i < epochs; ++i)
+				column.push_back(static_cast<T>(i));
+
+			// post-processing of several channels, the readers of the same column jump between the spilled chunks
+			std::vector<std::size_t> readers(16);
+			std::iota(readers.begin(), readers.end(), 0);
+			std::atomic<std::size_t> mismatches = 0;
+			std::for_each(std::execution::par, readers.begin(), readers.end(), [&](auto reader) {
+				for (std::size_t i = 0; i < epochs; ++i) {
+					const auto index = (i * 7 + reader * depth) % epochs;
+					if (column[index] != static_cast<T>(index))
+						++mismatches;
+				}
+				std::size_t expected = 0;
+				column.ForEachSpan([&](auto values) {
+					for (auto value : values)
+						if (value != static_cast<T>(expected++))
+							++mismatches;
+				});
+			});
+			ASSERT_EQ(mismatches, 0);
+		}
+	}
 }
@@ -20,6 +20,8 @@
 
 #include "../src/positioning/standalone_rtklib.hpp"
 
+#include "../src/receiver/single_pass_receiver.hpp"
+
 #include <functional>
 #include <type_traits>
 #include <tuple>
@@ -314,7 +316,7 @@ namespace integration_tests {
 			return cnt >= 4;
 		}
 
-		template <typename T, typename TestType = DefaultSamplingRate>
+		template <typename T, typename TestType = DefaultSamplingRate, ugsdr::AcquisitionMode mode = ugsdr::AcquisitionMode::SinglePass>
 		void TestAcquisition(ugsdr::FileType file_type, const std::vector<ugsdr::Signal>& signals, double doppler_range = 5e3) {
 			auto signal_parameters = GetSignalParameters<T>(file_type);
 
@@ -322,9 +324,7 @@ namespace integration_tests {
 				MakeChannel(signal_parameters, signals, signal_parameters.GetSamplingRate())
 			);
 
-			using FseConfig = std::conditional_t<std::is_same_v<TestType, DefaultSamplingRate>, ugsdr::DefaultFseConfig,
-				ugsdr::ParametricFseConfig<TestType::GetValue()>
-			>;
+			using FseConfig = ugsdr::ParametricFseConfig<TestType::GetValue(), mode>;
 
 			auto fse = ugsdr::FastSearchEngineBase<FseConfig, ugsdr::DefaultChannelConfig, T>(digital_frontend, doppler_range, 200);
 			auto acquisition_results = fse.Process(false);
@@ -383,9 +383,51 @@ namespace integration_tests {
 			}
 		}
 
-		template <typename T, typename TestType = DefaultSamplingRate>
+		template <typename T, typename TestType = DefaultSamplingRate, ugsdr::AcquisitionMode mode = ugsdr::AcquisitionMode::SinglePass>
 		void TestAcquisition(ugsdr::FileType file_type, ugsdr::Signal signal, double doppler_range = 5e3) {
-			TestAcquisition<T, TestType>(file_type, std::vector{ signal }, doppler_range);
+			TestAcquisition<T, TestType, mode>(file_type, std::vector{ signal }, doppler_range);
+		}
+
+		template <typename T, typename TestType = DefaultSamplingRate>
+		void TestLongIntegration(ugsdr::FileType file_type, ugsdr::Signal signal, ugsdr::IntegrationMode integration_mode) {
+			auto signal_parameters = GetSignalParameters<T>(file_type);
+
+			auto digital_frontend = ugsdr::DigitalFrontend(
+				MakeChannel(signal_parameters, std::vector{ signal }, signal_parameters.GetSamplingRate())
+			);
+
+			using FseConfig = ugsdr::ParametricFseConfig<TestType::GetValue()>;
+
+			// 10 ms blocks need the finer Doppler grid
+			auto fse = ugsdr::FastSearchEngineBase<FseConfig, ugsdr::DefaultChannelConfig, T>(digital_frontend, 5e3, 50);
+			fse.SetIntegration(10, 4, integration_mode);
+			auto acquisition_results = fse.ProcessLongIntegration();
+
+			std::cout << "\t\tFound " << acquisition_results.size() << " signals" << std::endl;
+			ASSERT_FALSE(acquisition_results.empty());
+			ASSERT_TRUE(VerifyResults(file_type, acquisition_results, signal_parameters.GetSamplingRate()));
+		}
+
+		template <typename T, typename TestType = DefaultSamplingRate>
+		void TestWarmStart(ugsdr::FileType file_type, ugsdr::Signal signal) {
+			auto signal_parameters = GetSignalParameters<T>(file_type);
+
+			auto digital_frontend = ugsdr::DigitalFrontend(
+				MakeChannel(signal_parameters, std::vector{ signal }, signal_parameters.GetSamplingRate())
+			);
+
+			using FseConfig = ugsdr::ParametricFseConfig<TestType::GetValue()>;
+
+			auto fse = ugsdr::FastSearchEngineBase<FseConfig, ugsdr::DefaultChannelConfig, T>(digital_frontend, 5e3, 200);
+			const auto full_search_results = fse.Process(false);
+			ASSERT_FALSE(full_search_results.empty());
+
+			// the previous session of the same site, the Doppler moves by a few Hz within a second
+			auto acquisition_results = fse.ProcessWarmStart(ugsdr::MakeAcquisitionAids(full_search_results), 400, 1000);
+
+			std::cout << "\t\tFound " << acquisition_results.size() << " signals" << std::endl;
+			ASSERT_FALSE(acquisition_results.empty());
+			ASSERT_TRUE(VerifyResults(file_type, acquisition_results, signal_parameters.GetSamplingRate()));
 		}
 
 		TYPED_TEST(AcquisitionTest, iq_8_plus_8_gps) {
@@ -413,6 +455,31 @@ namespace integration_tests {
 				ugsdr::Signal::GpsCoarseAcquisition_L1);
 		}
 
+		TYPED_TEST(AcquisitionTest, nt1065_grabber_gps_two_stage) {
+			TestAcquisition<typename TestFixture::FirstTupleType, typename TestFixture::SecondTupleType, ugsdr::AcquisitionMode::TwoStage>(ugsdr::FileType::Nt1065GrabberFirst,
+				ugsdr::Signal::GpsCoarseAcquisition_L1);
+		}
+
+		TYPED_TEST(AcquisitionTest, real_8_gps_two_stage) {
+			TestAcquisition<typename TestFixture::FirstTupleType, typename TestFixture::SecondTupleType, ugsdr::AcquisitionMode::TwoStage>(ugsdr::FileType::Real_8,
+				ugsdr::Signal::GpsCoarseAcquisition_L1, 6e3);
+		}
+
+		TYPED_TEST(AcquisitionTest, nt1065_grabber_gps_non_coherent) {
+			TestLongIntegration<typename TestFixture::FirstTupleType, typename TestFixture::SecondTupleType>(ugsdr::FileType::Nt1065GrabberFirst,
+				ugsdr::Signal::GpsCoarseAcquisition_L1, ugsdr::IntegrationMode::NonCoherent);
+		}
+
+		TYPED_TEST(AcquisitionTest, nt1065_grabber_gps_differential) {
+			TestLongIntegration<typename TestFixture::FirstTupleType, typename TestFixture::SecondTupleType>(ugsdr::FileType::Nt1065GrabberFirst,
+				ugsdr::Signal::GpsCoarseAcquisition_L1, ugsdr::IntegrationMode::Differential);
+		}
+
+		TYPED_TEST(AcquisitionTest, nt1065_grabber_gps_warm_start) {
+			TestWarmStart<typename TestFixture::FirstTupleType, typename TestFixture::SecondTupleType>(ugsdr::FileType::Nt1065GrabberFirst,
+				ugsdr::Signal::GpsCoarseAcquisition_L1);
+		}
+
 		TYPED_TEST(AcquisitionTest, nt1065_grabber_gln) {
 			TestAcquisition<typename TestFixture::FirstTupleType, typename TestFixture::SecondTupleType>(ugsdr::FileType::Nt1065GrabberSecond,
 				ugsdr::Signal::GlonassCivilFdma_L1);
@@ -480,6 +547,39 @@ namespace integration_tests {
 			ASSERT_LE(offset, 10);
 		}
 		
+		TYPED_TEST(PositioningTest, GPSdata_DiscreteComponents_single_pass) {
+			auto signal_parameters = ugsdr::SignalParametersBase<typename TestFixture::Type>(SIGNAL_DATA_PATH +
+				std::string("GPSdata-DiscreteComponents-fs38_192-if9_55.bin"), 
+				ugsdr::FileType::Real_8, 1575.42e6 + 9.55e6, 38.192e6);
+			auto digital_frontend = ugsdr::DigitalFrontend(
+				MakeChannel(signal_parameters, std::vector{ ugsdr::Signal::GpsCoarseAcquisition_L1 }, 
+					signal_parameters.GetSamplingRate() / 4)
+			);
+			auto fse = ugsdr::FastSearchEngineBase(digital_frontend, 6e3, 200);
+			auto acquisition_results = fse.Process();
+			ASSERT_FALSE(acquisition_results.empty());
+
+			auto receiver = ugsdr::SinglePassReceiver(digital_frontend, acquisition_results);
+			std::vector<ugsdr::PositionSolution> solutions;
+			receiver.SetPositionCallback([&solutions](const ugsdr::PositionSolution& solution) {
+				solutions.push_back(solution);
+			});
+			receiver.Process(signal_parameters.GetNumberOfEpochs());
+			receiver.Flush();
+			ASSERT_TRUE(receiver.IsResolved());
+			ASSERT_FALSE(solutions.empty());
+
+			auto reference_position = std::vector{ -1288161.849718, -4720800.361224, 4079714.93957036 };	// matlab reference
+			auto pos = std::vector{ solutions.back().x, solutions.back().y, solutions.back().z };
+			for (std::size_t i = 0; i < pos.size(); ++i)
+				pos[i] -= reference_position[i];
+			auto offset = std::sqrt(std::accumulate(pos.begin(), pos.end(), 0.0, [](const auto& sum, const auto& val) {
+				return sum + val * val;
+			}));
+			std::cout << "Delta: " << offset << " meters" << std::endl;
+			ASSERT_LE(offset, 10);
+		}
+		
 		TYPED_TEST(PositioningTest, TexCup) {
 			auto signal_parameters = ugsdr::SignalParametersBase<typename TestFixture::Type>(SIGNAL_DATA_PATH + std::string("ntlab.bin"), ugsdr::FileType::Nt1065GrabberFirst, 1590e6, 79.5e6);
 			auto signal_parameters_gln = ugsdr::SignalParametersBase<typename TestFixture::Type>(SIGNAL_DATA_PATH + std::string("ntlab.bin"), ugsdr::FileType::Nt1065GrabberSecond, 1590e6, 79.5e6);